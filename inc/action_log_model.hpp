@@ -0,0 +1,72 @@
+// action_log_model.hpp
+//
+// Model of the action log. Entries are kept in a ring buffer of fixed
+// capacity; the oldest ones are dropped when it is full. append() only
+// queues an entry: queued entries reach the model (and views) together at
+// most once per frame, so logging in a loop costs little more than storing
+// the strings.
+//
+// The log can be written to a file; after exportTo() every later entry is
+// appended to that file as well, including those the ring buffer drops.
+
+#ifndef ACTION_LOG_MODEL_HPP
+#define ACTION_LOG_MODEL_HPP
+
+#include <QAbstractListModel>
+#include <QFile>
+#include <QString>
+#include <QTimer>
+#include <vector>
+
+class ActionLogModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum class Severity { Info, Warning, Error };
+
+    // Role for the Severity of a row (as int)
+    static constexpr int SeverityRole = Qt::UserRole;
+
+    explicit ActionLogModel(int capacity, QObject *parent = nullptr);
+    ~ActionLogModel() override;
+
+    // Queue message; lines of a multi-line message become rows of their own
+    void append(Severity severity, const QString &message);
+
+    // Hand the queued entries to the model now
+    void flush();
+
+    // Write the buffered entries to fileName and keep appending new ones.
+    // Returns false (see lastError()) if the file cannot be written.
+    bool exportTo(const QString &fileName);
+    QString lastError() const { return m_lastError; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private:
+    struct Entry
+    {
+        qint64 time = 0;  // Milliseconds since the epoch
+        Severity severity = Severity::Info;
+        bool continuation = false;  // Further line of the previous entry
+        QString message;
+    };
+
+    const Entry& entryAt(int row) const;
+    void writeEntries(const std::vector<Entry> &entries);
+    void writeEntry(const Entry &entry);
+
+    int m_capacity;
+    std::vector<Entry> m_ring;
+    int m_first = 0;  // Slot of row 0
+    int m_count = 0;
+    std::vector<Entry> m_pending;
+    QTimer m_flushTimer;
+
+    QFile m_logFile;
+    QString m_lastError;
+};
+
+#endif // ACTION_LOG_MODEL_HPP
@@ -0,0 +1,110 @@
+// arxml_compression.hpp
+//
+// Streaming access to plain, gzip (.gz) and zstd (.zst) compressed ARXML
+// files. ArxmlInputStream hands out the uncompressed content in chunks; for
+// compressed files a producer thread decompresses ahead of the consumer into a
+// small bounded queue, so decompression overlaps with parsing without ever
+// holding the whole document. ArxmlOutputStream compresses written data
+// through a fixed-size buffer into a QSaveFile.
+//
+// Codecs are optional at build time (ARXML_HAVE_ZLIB, ARXML_HAVE_ZSTD);
+// opening a file whose codec is missing fails with an error message.
+
+#ifndef ARXML_COMPRESSION_HPP
+#define ARXML_COMPRESSION_HPP
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QSaveFile>
+#include <QString>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <memory>
+
+class QThread;
+
+enum class ArxmlCompression { None, Gzip, Zstd };
+
+// Compression implied by the file name suffix (.gz, .zst)
+ArxmlCompression compressionForFile(const QString &fileName);
+
+// Whether this build can read and write the given compression
+bool isCompressionSupported(ArxmlCompression compression);
+
+class ArxmlInputStream
+{
+public:
+    ArxmlInputStream(const QString &fileName, qint64 chunkSize);
+    ~ArxmlInputStream();
+
+    bool open();
+
+    // Next chunk of uncompressed content; empty at the end or on error.
+    // Blocks while the decompression thread is behind.
+    QByteArray read();
+    bool atEnd() const;
+
+    // Size of the file on disk and how much of it was consumed so far, for
+    // progress reporting
+    qint64 size() const { return m_size; }
+    qint64 bytesConsumed() const { return m_consumed.load(std::memory_order_relaxed); }
+
+    ArxmlCompression compression() const { return m_compression; }
+    bool hasError() const;
+    QString errorString() const;
+
+private:
+    // Runs on the decompression thread until the input ends, fails or the
+    // stream is destroyed
+    void decompress();
+    // Queue a chunk of output; false if the consumer went away
+    bool push(QByteArray chunk);
+    void finish(const QString &error);
+
+    QFile m_file;
+    const qint64 m_chunkSize;
+    qint64 m_size = 0;
+    std::atomic<qint64> m_consumed{0};
+    ArxmlCompression m_compression;
+
+    std::unique_ptr<QThread> m_thread;
+    mutable QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    std::deque<QByteArray> m_queue;
+    bool m_finished = false;
+    bool m_cancelled = false;
+    QString m_error;
+};
+
+class ArxmlOutputStream
+{
+public:
+    explicit ArxmlOutputStream(const QString &fileName);
+    ~ArxmlOutputStream();
+
+    bool open();
+    bool write(const QByteArray &data);
+
+    // Flush the codec and replace the target file
+    bool commit();
+    void cancel();
+
+    QString errorString() const { return m_error; }
+
+private:
+    struct Codec;
+
+    bool writeCompressed(const char *data, qsizetype size, bool finish);
+    bool fail(const QString &error);
+
+    QSaveFile m_file;
+    ArxmlCompression m_compression;
+    std::unique_ptr<Codec> m_codec;
+    QByteArray m_buffer;
+    QString m_error;
+};
+
+#endif // ARXML_COMPRESSION_HPP
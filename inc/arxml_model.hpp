@@ -1,26 +1,96 @@
 // arxml_model.hpp
 //
 // ArxmlModel with SAX-based parsing for improved performance with large files.
-// Uses an internal tree structure for manipulation and QXmlStreamWriter for saving.
+// Names are kept as written (no namespace processing, xmlns declarations are
+// ordinary attributes). Comments and processing instructions inside the root
+// element are kept as markup tokens between the children, and everything
+// else the tree does not model (formatting) stays reachable through byte
+// spans into the source, so unchanged regions are saved verbatim.
+// Uses an internal tree structure for manipulation; saving serializes
+// independent subtrees in parallel.
+//
+// Documents larger than memory can be loaded out-of-core: the identifiables
+// in ELEMENTS lists are then kept as stubs whose content stays in the
+// memory-mapped source file. Stubs are paged in when reached through
+// findElementByIndexPath(), and evictPages() turns unmodified ones back into
+// stubs to stay within a memory limit. A projected load (package paths or
+// element tags) works the same way but only stubs what lies outside the
+// projection, so the parts in use are loaded completely.
 
 #ifndef ARXML_MODEL_HPP
 #define ARXML_MODEL_HPP
 
+#include "arxml_writer.hpp"
+
+#include <QDateTime>
+#include <QReadWriteLock>
 #include <QString>
+#include <QStringList>
 #include <QVariant>
+#include <atomic>
+#include <functional>
+#include <list>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
+class ArxmlSourceMap;
+
+// A comment or processing instruction inside an element (see
+// ArxmlElement::markup)
+struct ArxmlMarkup
+{
+    enum class Kind { Comment, ProcessingInstruction };
+
+    Kind kind = Kind::Comment;
+    size_t before = 0;  // Index of the child it precedes
+    QString text;       // Comment text, or the target of the instruction
+    QString data;       // Data of the instruction
+};
+
 class ArxmlElement
 {
 public:
-    QString tagName;
+    QString tagName;   // Qualified name as written in the source
     QString text;
+    bool cdata = false;  // text was (at least partly) a CDATA section
     std::vector<std::pair<QString, QString>> attributes;
     std::vector<std::shared_ptr<ArxmlElement>> children;
     ArxmlElement* parent = nullptr;
+    // Comments and processing instructions between the children, written
+    // again by full saves; with before == children.size() they follow the
+    // last child (or the text)
+    std::vector<ArxmlMarkup> markup;
+
+    // Edit stamps maintained by ArxmlModel::markModified(). revision changes
+    // when this element itself is edited, subtreeRevision when it or any
+    // descendant is. Both stay 0 for content untouched since loading.
+    quint64 revision = 0;
+    quint64 subtreeRevision = 0;
+
+    // Byte span of the element in the file it was loaded from (or last saved
+    // to incrementally), used by ArxmlModel::saveIncremental() to copy
+    // unmodified content verbatim. The offsets are stored relative to the
+    // ancestors: the position in the file is sourceBegin plus the sourceShift
+    // of every ancestor, so a save moves a copied subtree by updating its top
+    // element alone. Elements created after loading or re-serialized by a
+    // save have no span (sourceStartTag is 0).
+    qint64 sourceBegin = 0;      // '<' of the start tag
+    qint64 sourceEnd = 0;        // Just past the end tag (or "/>")
+    qint64 sourceShift = 0;      // Added to the offsets of all descendants
+    quint32 sourceLead = 0;      // Bytes since the previous sibling or the parent's start tag
+    quint32 sourceStartTag = 0;  // Length of the start tag
+    quint32 sourceTail = 0;      // Bytes from the last child (or start tag) to sourceEnd
+    quint32 sourceAttributesHash = 0;  // Attributes as written in the source start tag
+
+    // Out-of-core stub: children and text are not in memory but only in the
+    // source span; tag name, attributes and the SHORT-NAME are
+    bool stub = false;
+    QString stubShortName;
 
     ArxmlElement() = default;
+
+    bool hasSource() const { return sourceStartTag > 0; }
     
     std::shared_ptr<ArxmlElement> createChild(const QString& name) {
         auto child = std::make_shared<ArxmlElement>();
@@ -58,18 +128,198 @@ public:
     }
 };
 
+// Optional hooks for ArxmlModel::loadFromFile(). Callbacks run on the thread
+// that performs the load, which may be a worker thread.
+struct ArxmlLoadOptions
+{
+    // Called after each chunk of input with the bytes consumed so far and the
+    // file size. Returning false cancels the load.
+    std::function<bool(qint64 bytesRead, qint64 totalBytes)> progress;
+
+    // Keep identifiables as stubs backed by the memory-mapped source file
+    // (see ArxmlModel). Requires an uncompressed UTF-8 file.
+    bool outOfCore = false;
+
+    // Projection: only AR-PACKAGEs at or below one of packagePaths (e.g.
+    // "/Pkg/Interfaces") and, if elementTags is set, only identifiables with
+    // one of those tags are built. Everything else is skipped without
+    // creating elements and kept as stubs, as with outOfCore (same file
+    // requirements). Packages above a selected path keep their sub-packages
+    // but not their own elements. Empty lists select everything.
+    QStringList packagePaths;
+    QStringList elementTags;
+
+    // Called whenever a top-level package (document element / AR-PACKAGES /
+    // AR-PACKAGE) has been parsed completely. The loader never touches that
+    // subtree again, so it can be read from another thread while parsing
+    // continues; only its parent chain is still live. indexPath is the
+    // package's path below the document element and ancestorTags holds the
+    // tag names of the document element and the AR-PACKAGES container.
+    std::function<void(const std::shared_ptr<ArxmlElement>& package,
+                       const QList<int>& indexPath,
+                       const QStringList& ancestorTags)> packageLoaded;
+};
+
+// What a set of edits changed, for updating views: an element's own data
+// (attributes, text), a child inserted or removed at index, or the child
+// list as a whole (several insertions/removals). path is the element's
+// index path after the edits.
+struct ArxmlChange
+{
+    enum class Kind { Content, ChildInserted, ChildRemoved, ChildrenReset };
+
+    Kind kind = Kind::Content;
+    QList<int> path;
+    int index = -1;
+};
+
+// The document as it was when a background save started (see
+// ArxmlModel::beginSave()). The tree stays shared with the model, which
+// copies an element right before it changes it for the first time (edits,
+// paging in, eviction), so taking a snapshot costs nothing and it only holds
+// the elements changed while the save runs.
+class ArxmlSnapshot
+{
+private:
+    friend class ArxmlModel;
+    friend class ArxmlSnapshotReader;
+
+    // Keep elem as it is now for the readers
+    void freeze(const ArxmlElement *elem);
+
+    // Held for reading by the readers while they look at elements and for
+    // writing while a copy is added; m_freezing asks readers to let go
+    QReadWriteLock m_lock;
+    std::atomic<bool> m_freezing{false};
+    std::unordered_map<const ArxmlElement*, std::shared_ptr<const ArxmlElement>> m_frozen;
+};
+
+// Reads the elements of a snapshot on a worker thread. The snapshot stays
+// locked between get() calls and is unlocked every few elements, whenever an
+// edit waits, and on pause().
+class ArxmlSnapshotReader
+{
+public:
+    explicit ArxmlSnapshotReader(ArxmlSnapshot &snapshot);
+    ~ArxmlSnapshotReader();
+    ArxmlSnapshotReader(const ArxmlSnapshotReader &) = delete;
+    ArxmlSnapshotReader &operator=(const ArxmlSnapshotReader &) = delete;
+
+    // elem as it was in the snapshot. The result may only be used until the
+    // next get() or pause().
+    const ArxmlElement &get(const ArxmlElement &elem);
+
+    // Let edits through, e.g. before blocking on output
+    void pause();
+
+private:
+    ArxmlSnapshot &m_snapshot;
+    bool m_locked = false;
+    int m_reads = 0;
+};
+
+// A save started by ArxmlModel::beginSave(). run() writes the snapshot like
+// ArxmlModel::saveIncremental() and may be called on any thread while the
+// model is being edited; ArxmlModel::finishSave() applies the result.
+class ArxmlSaveJob
+{
+public:
+    bool run();
+
+    QString fileName() const { return m_fileName; }
+    QString lastError() const { return m_lastError; }
+
+    // Span changes of a save, applied by finishSave(). Offsets are stored
+    // values (see ArxmlElement::sourceBegin).
+    struct SpanUpdate
+    {
+        enum Kind { Shift, Rewrite, Clear };
+        ArxmlElement *elem;
+        Kind kind;
+        qint64 begin;  // Shift: delta, Rewrite: new sourceBegin
+        qint64 end;
+        quint32 startTag;
+        quint32 tail;
+        quint32 attributesHash;
+        quint32 lead;
+    };
+
+private:
+    friend class ArxmlModel;
+
+    ArxmlSnapshot m_snapshot;
+    QString m_fileName;
+    QString m_lastError;
+
+    // Copied from the model when the save starts
+    std::shared_ptr<ArxmlElement> m_root;
+    QString m_sourcePath;
+    bool m_sourceSpansValid = false;
+    qint64 m_sourceSize = -1;
+    QDateTime m_sourceModified;
+    quint64 m_savedRevision = 0;
+    quint64 m_revision = 0;
+    QByteArray m_prolog;
+    QByteArray m_epilog;
+    std::shared_ptr<const ArxmlSourceMap> m_sourceMap;
+
+    // Result of run()
+    bool m_written = false;
+    bool m_full = false;
+    bool m_spansRecorded = false;  // m_updates cover the whole document
+    std::vector<SpanUpdate> m_updates;
+    std::shared_ptr<const ArxmlSourceMap> m_savedSource;
+
+    // Subtrees the model put into the document while the save ran
+    std::vector<std::shared_ptr<ArxmlElement>> m_inserted;
+};
+
 class ArxmlModel
 {
 public:
     ArxmlModel();
     ~ArxmlModel();
 
-    // Load an ARXML file using SAX parser. Returns true on success.
-    bool loadFromFile(const QString &fileName);
+    // Load an ARXML file using SAX parser; .gz and .zst files are
+    // decompressed on the fly. Returns true on success; a cancelled load
+    // returns false with lastError() set accordingly.
+    bool loadFromFile(const QString &fileName, const ArxmlLoadOptions &options = ArxmlLoadOptions());
 
-    // Save using QXmlStreamWriter. Returns true on success.
+    // Save as indented UTF-8 with LF line endings. The top-level subtrees are
+    // serialized concurrently and streamed in document order to a temporary
+    // file that atomically replaces fileName, compressed if its name ends in
+    // .gz or .zst. Returns true on success.
     bool saveToFile(const QString &fileName) const;
 
+    // Save by streaming unmodified regions of the source file verbatim and
+    // re-serializing only the subtrees edited since the last load or save.
+    // Falls back to writing everything like saveToFile() when the source is
+    // not usable (not UTF-8, compressed, changed on disk, ...). On success
+    // the saved file becomes the new source, unless it is compressed. Sets
+    // lastError() on failure.
+    bool saveIncremental(const QString &fileName);
+
+    // saveIncremental() in the background: beginSave() takes a snapshot of
+    // the document (see ArxmlSnapshot) and returns the job that writes it.
+    // Editing goes on while the job runs; finishSave() then makes the saved
+    // file the new source, rebasing the spans of everything not moved in the
+    // meantime onto it. Edits made during the save stay unsaved. beginSave()
+    // returns nullptr (with lastError() set) while another save is running,
+    // and on Windows for a file still mapped as out-of-core source, which
+    // cannot be replaced there.
+    std::shared_ptr<ArxmlSaveJob> beginSave(const QString &fileName);
+    bool finishSave(ArxmlSaveJob &job);
+
+    // Bytes before and after the document element in the source file
+    // (declaration, comments, processing instructions); empty if the source
+    // was not UTF-8. Full saves write them instead of a fresh declaration.
+    QByteArray prolog() const { return m_prolog; }
+    QByteArray epilog() const { return m_epilog; }
+
+    // Serialize the whole document into memory, e.g. to hand it to an
+    // external tool without a temporary file.
+    QByteArray toByteArray(ArxmlWriter::Format format = ArxmlWriter::Format::Pretty) const;
+
     // Access the root element
     std::shared_ptr<ArxmlElement> rootElement() const { return m_root; }
 
@@ -85,12 +335,190 @@ public:
     // Get index path to element (list of child indices from root)
     QList<int> getElementIndexPath(const ArxmlElement* elem) const;
 
+    // Record an edit of elem (attributes, text or child list). Stamps the
+    // element and all of its ancestors so consumers such as the incremental
+    // validator can tell which subtrees changed since they last looked.
+    void markModified(ArxmlElement* elem);
+
+    // Latest stamp handed out by markModified(); 0 if nothing was edited.
+    quint64 currentRevision() const { return m_revisionCounter; }
+
+    // A subtree outside the document, e.g. held by an undo command. It keeps
+    // the source its spans refer to, so it can be put back after a save.
+    struct DetachedElement
+    {
+        std::shared_ptr<ArxmlElement> element;
+        std::shared_ptr<const ArxmlSourceMap> source;
+        quint64 sourceGeneration = 0;
+        // Paged-in stubs inside, which may be evicted again once put back
+        std::vector<ArxmlElement*> pages;
+    };
+
+    // Edits. Each one stamps the element (markModified), is recorded for
+    // takeChanges() and, inside a transaction, journaled for rollback.
+    void setText(const std::shared_ptr<ArxmlElement> &elem, const QString &text);
+    void setAttribute(const std::shared_ptr<ArxmlElement> &elem, const QString &name, const QString &value);
+    void removeAttribute(const std::shared_ptr<ArxmlElement> &elem, const QString &name);
+
+    // Structural edits. removeChild() takes the subtree out without copying
+    // it; insertChild() puts a detached subtree back, or adds a new one from
+    // createElement(). A subtree detached before the source changed loses
+    // its spans and has its stubs read from the source it came from. Both
+    // return false (with lastError() set) on bad input.
+    DetachedElement createElement(const QString &tagName) const;
+    bool removeChild(const std::shared_ptr<ArxmlElement> &parent, int index, DetachedElement &removed);
+    bool insertChild(const std::shared_ptr<ArxmlElement> &parent, int index, const DetachedElement &child);
+
+    // Group edits: commitTransaction() keeps them, rollbackTransaction()
+    // reverts them in reverse order. Transactions do not nest. A rollback
+    // whose inverse edit fails stops there and returns false with
+    // lastError() set; the edits before that one remain.
+    void beginTransaction();
+    void commitTransaction();
+    bool rollbackTransaction();
+    bool inTransaction() const { return m_inTransaction; }
+
+    // Changes of all edits since the last call, coalesced into the fewest
+    // view updates: one entry per edited element, several structural edits
+    // of one child list become a ChildrenReset, and anything inside a
+    // subtree that is inserted, removed or reset is left out. Structural
+    // entries come first, parents before their descendants.
+    std::vector<ArxmlChange> takeChanges();
+
+    // Out-of-core documents (ArxmlLoadOptions::outOfCore or a projection)
+    bool isOutOfCore() const { return m_sourceMap != nullptr; }
+
+    // Approximate memory held by paged-in stubs, and the limit evictPages()
+    // brings it back to (0: no limit)
+    qint64 pagedBytes() const { return m_pagedBytes; }
+    void setMemoryLimit(qint64 bytes) { m_memoryLimit = bytes; }
+    qint64 memoryLimit() const { return m_memoryLimit; }
+
+    // Turn least recently used paged-in subtrees back into stubs until the
+    // memory limit is met. Subtrees with unsaved edits and the one holding
+    // keep stay. Returns the index paths of the elements that became stubs;
+    // pointers into their subtrees are invalid afterwards.
+    std::vector<QList<int>> evictPages(const ArxmlElement *keep);
+
+    // Index paths of the stubs whose character data (SHORT-NAMEs, values,
+    // references; entity references resolved, tags, attributes and
+    // comments skipped) contains text, ASCII case insensitive. In document
+    // order; nothing is paged in.
+    std::vector<QList<int>> stubsContaining(const QString &text) const;
+
+    // Index paths of the stubs with an element whose tag name ends with
+    // tagSuffix (case sensitive), e.g. "PORT-PROTOTYPE"; nothing is paged in
+    std::vector<QList<int>> stubsWithElement(const QString &tagSuffix) const;
+
+    // Background readers. Work that walks the live tree on a worker thread
+    // (validation, semantic checks) does so inside a ReadAccess, taken with
+    // the editGeneration() of when the work was started. Every change of
+    // the model (edits, paging, loading, span updates of a save) first
+    // interrupts the readers: it waits until they let go, so a reader never
+    // sees a change half done, and cancelled() is true from then on. A
+    // cancelled reader stops early; its owner runs it again later.
+    class ReadAccess
+    {
+    public:
+        ReadAccess(const ArxmlModel &model, quint64 editGeneration);
+        ~ReadAccess();
+        ReadAccess(const ReadAccess &) = delete;
+        ReadAccess &operator=(const ReadAccess &) = delete;
+
+        bool cancelled() const;
+
+    private:
+        const ArxmlModel &m_model;
+        quint64 m_generation;
+    };
+
+    quint64 editGeneration() const { return m_editGeneration.load(); }
+
+    // Cancel the running readers and wait until they stopped, e.g. before
+    // the model is deleted
+    void interruptReaders() const;
+
 private:
     std::shared_ptr<ArxmlElement> m_root;
     QString m_filePath;
     QString m_lastError;
+    quint64 m_revisionCounter = 0;
+
+    // Source of the element spans: valid only if the spans could be recorded
+    // and the file still has the recorded size and modification time
+    bool m_sourceSpansValid = false;
+    qint64 m_sourceSize = -1;
+    QDateTime m_sourceModified;
+    // Edits stamped after this revision are not in the source file yet
+    quint64 m_savedRevision = 0;
+    QByteArray m_prolog;
+    QByteArray m_epilog;
+    // Changes whenever the spans start to refer to another file or become
+    // invalid; detached subtrees from an older generation lose their spans
+    quint64 m_sourceGeneration = 0;
+
+    // Edits since the last takeChanges(); element is the edited element or
+    // the parent of an inserted/removed child
+    struct ChangeRecord
+    {
+        ArxmlChange::Kind kind;
+        std::shared_ptr<ArxmlElement> element;
+        std::shared_ptr<ArxmlElement> child;
+        int index;
+    };
+    std::vector<ChangeRecord> m_changes;
+
+    // Inverse operations of the open transaction
+    struct JournalEntry
+    {
+        enum class Kind { Text, Attribute, Inserted, Removed };
+        Kind kind;
+        std::shared_ptr<ArxmlElement> element;
+        QString name;
+        QString value;         // Previous text or attribute value
+        bool existed = false;  // The attribute was set before
+        int index = -1;
+        DetachedElement removed;
+    };
+    std::vector<JournalEntry> m_journal;
+    bool m_inTransaction = false;
+
+    // Out-of-core paging. Paging in does not change the document, so it is
+    // done from const lookups; m_pages lists paged-in stubs, most recently
+    // used first.
+    std::shared_ptr<const ArxmlSourceMap> m_sourceMap;
+    // Pages are charged with the cost they had when they were paged in, as
+    // saves change their spans
+    struct PageEntry
+    {
+        std::list<ArxmlElement*>::iterator position;
+        qint64 cost = 0;
+    };
+    mutable std::list<ArxmlElement*> m_pages;
+    mutable std::unordered_map<const ArxmlElement*, PageEntry> m_pageIndex;
+    mutable qint64 m_pagedBytes = 0;
+    qint64 m_memoryLimit = 0;
+
+    // Held for reading by each ReadAccess; interruptReaders() moves the
+    // generation on and takes it for writing to wait for them
+    mutable QReadWriteLock m_readersLock;
+    mutable std::atomic<quint64> m_editGeneration{0};
+
+    bool pageIn(ArxmlElement *elem) const;
+    void addPage(ArxmlElement *elem) const;
+    void touchPage(const ArxmlElement *elem) const;
+    // Stop paging elem and the pages inside it; they are added to forgotten
+    void forgetPages(ArxmlElement *elem, std::vector<ArxmlElement*> *forgotten = nullptr) const;
+    // Stubs whose source span (data, size) passes match, scanned in
+    // parallel straight from the mapping
+    std::vector<QList<int>> stubsMatching(const std::function<bool(const char *data, qint64 size)> &match) const;
+
+    void recordSource(const QString &fileName);
     
-    void saveElement(const ArxmlElement& elem, class QXmlStreamWriter& writer, int indent) const;
+    // Background save in progress; edits copy what they change into its
+    // snapshot first
+    std::shared_ptr<ArxmlSaveJob> m_saveJob;
+    void freezeForSave(const ArxmlElement *elem, bool withAncestors) const;
     std::shared_ptr<ArxmlElement> findElementByIndexPathRecursive(
         const std::shared_ptr<ArxmlElement>& elem, 
         const QList<int>& indexPath, 
@@ -0,0 +1,101 @@
+// arxml_pipeline.hpp
+//
+// Streaming transforms for ARXML files too large to load as a tree. A
+// pipeline reads the input with QXmlStreamReader (through ArxmlInputStream,
+// so compressed files work), passes each parse event through a chain of
+// stages that may drop, rewrite or insert events, and writes the result with
+// ArxmlWriter into an ArxmlOutputStream. Memory use is bounded by the input
+// chunk size and the nesting depth, not by the document size.
+//
+// Stages can be created from short textual specs, shared by the Transform
+// dialog and the --transform command line mode:
+//   drop:TAG[,TAG...]            remove elements (and their content) by tag
+//   rename-package:/PATH=NAME    rename a package and rewrite references to it
+//   extract:/PATH                keep only one identifiable and its packages
+
+#ifndef ARXML_PIPELINE_HPP
+#define ARXML_PIPELINE_HPP
+
+#include <QString>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// One parse event flowing through the pipeline
+struct ArxmlEvent
+{
+    enum class Type {
+        StartDocument,
+        EndDocument,
+        StartElement,
+        EndElement,
+        Characters,
+        Comment,
+        ProcessingInstruction,
+        Dtd
+    };
+
+    Type type = Type::Characters;
+    QString name;  // Qualified element name or processing instruction target
+    // Element attributes, or the XML declaration's pseudo-attributes
+    // (version, encoding, standalone) of StartDocument
+    std::vector<std::pair<QString, QString>> attributes;
+    QString text;  // Character data, comment, PI data or DTD
+    bool cdata = false;
+};
+
+// A filter/rewrite step. Stages see events in document order and hand on
+// whatever should reach the output with forward(). Events may be modified
+// in place before forwarding.
+class ArxmlStage
+{
+public:
+    virtual ~ArxmlStage() = default;
+
+    virtual void process(ArxmlEvent &event) = 0;
+
+    // End of input; forward anything still held back. Returns false (with
+    // errorString() set) if the stage could not do its job.
+    virtual bool finish() { return true; }
+
+    QString errorString() const { return m_error; }
+
+protected:
+    void forward(ArxmlEvent &event) { m_next->process(event); }
+
+    QString m_error;
+
+private:
+    friend class ArxmlPipeline;
+    ArxmlStage *m_next = nullptr;
+};
+
+class ArxmlPipeline
+{
+public:
+    using ProgressCallback = std::function<bool(qint64 bytesRead, qint64 totalBytes)>;
+
+    ArxmlPipeline();
+    ~ArxmlPipeline();
+
+    void addStage(std::unique_ptr<ArxmlStage> stage);
+
+    // Create a stage from a spec (see above) and add it. Returns false with
+    // lastError() set if the spec is not understood.
+    bool addStage(const QString &spec);
+
+    // Stream inputFile through all stages into outputFile (which replaces
+    // the target only on success). progress is called after every input
+    // chunk and cancels the run by returning false.
+    bool run(const QString &inputFile, const QString &outputFile,
+             const ProgressCallback &progress = ProgressCallback());
+
+    QString lastError() const { return m_lastError; }
+
+private:
+    std::vector<std::unique_ptr<ArxmlStage>> m_stages;
+    QString m_lastError;
+};
+
+#endif // ARXML_PIPELINE_HPP
@@ -0,0 +1,137 @@
+// arxml_port_index.hpp
+//
+// Index of the port prototypes (P-, R- and PR-PORT-PROTOTYPE) of a document,
+// for the port panels and the port overview. The data is kept as one array
+// per attribute (struct of arrays), so sorting or filtering by one column
+// only touches that column. The COM-SPECs of all ports share one pool; each
+// port refers to a range of it.
+//
+// build() scans the identifiables of the ELEMENTS lists in parallel. After
+// that the index is kept up to date from the change notifications of the
+// model (update()). Rows are unordered; removing a port moves the last row
+// into its place.
+//
+// Out-of-core documents are indexed as far as they are in memory: stubs are
+// skipped, paged-in content is added with addSubtree() and ports of evicted
+// pages are dropped with removeStubbed().
+
+#ifndef ARXML_PORT_INDEX_HPP
+#define ARXML_PORT_INDEX_HPP
+
+#include <QString>
+#include <QtGlobal>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class ArxmlElement;
+class ArxmlModel;
+struct ArxmlChange;
+
+class ArxmlPortIndex
+{
+public:
+    enum class Direction : quint8 { Provided, Required, ProvidedRequired };
+    enum class InterfaceKind : quint8 {
+        Unknown,
+        SenderReceiver,
+        ClientServer,
+        ModeSwitch,
+        Parameter,
+        NvData,
+        Trigger
+    };
+
+    ArxmlPortIndex();
+    ~ArxmlPortIndex();
+
+    void clear();
+
+    // Index all ports below root
+    void build(const std::shared_ptr<ArxmlElement> &root);
+
+    // Bring the index in line with edits, given the result of
+    // ArxmlModel::takeChanges()
+    void update(const ArxmlModel &model, const std::vector<ArxmlChange> &changes);
+
+    // Index (again) the ports in elem's subtree, e.g. after it was paged in
+    void addSubtree(const std::shared_ptr<ArxmlElement> &elem);
+
+    // Drop the ports whose identifiable was turned back into a stub
+    void removeStubbed();
+
+    // Row of port, indexing it first if it is not in the index yet
+    int ensure(const std::shared_ptr<ArxmlElement> &port);
+
+    // Row of port; -1 if it is not indexed
+    int row(const ArxmlElement *port) const;
+
+    // Changes whenever rows are added, removed or re-read
+    quint64 revision() const { return m_revision; }
+
+    // Columns
+    int size() const { return static_cast<int>(m_columns.ports.size()); }
+    const std::shared_ptr<ArxmlElement>& port(int row) const { return m_columns.ports[row]; }
+    const QString& name(int row) const { return m_columns.names[row]; }
+    const QString& component(int row) const { return m_columns.components[row]; }
+    Direction direction(int row) const { return m_columns.directions[row]; }
+    const QString& interfaceRef(int row) const { return m_columns.interfaceRefs[row]; }
+    InterfaceKind interfaceKind(int row) const { return m_columns.interfaceKinds[row]; }
+    // COM-SPECs by kind with their data elements, e.g.
+    // "NONQUEUED-RECEIVER: Speed, Mode; QUEUED-RECEIVER: Event"
+    const QString& comSpecSummary(int row) const { return m_columns.comSpecSummaries[row]; }
+
+    // COM-SPECs of a port with the data element or operation each refers to
+    // (last part of the reference)
+    int comSpecCount(int row) const { return m_columns.comSpecCounts[row]; }
+    const std::shared_ptr<ArxmlElement>& comSpec(int row, int i) const
+    {
+        return m_columns.comSpecs[m_columns.comSpecBegins[row] + i];
+    }
+    const QString& dataElement(int row, int i) const
+    {
+        return m_columns.dataElements[m_columns.comSpecBegins[row] + i];
+    }
+
+    static QString directionName(Direction direction);
+    static QString interfaceKindName(InterfaceKind kind);
+
+private:
+    struct Columns
+    {
+        std::vector<std::shared_ptr<ArxmlElement>> ports;
+        std::vector<const ArxmlElement*> owners;  // Identifiable in ELEMENTS holding the port
+        std::vector<QString> names;
+        std::vector<QString> components;
+        std::vector<Direction> directions;
+        std::vector<QString> interfaceRefs;
+        std::vector<InterfaceKind> interfaceKinds;
+        std::vector<QString> comSpecSummaries;
+        std::vector<int> comSpecBegins;
+        std::vector<int> comSpecCounts;
+
+        // COM-SPEC pool
+        std::vector<std::shared_ptr<ArxmlElement>> comSpecs;
+        std::vector<QString> dataElements;
+
+        // Add a row read from port
+        void append(const std::shared_ptr<ArxmlElement> &port, const ArxmlElement *owner);
+        // Move the last row to row (dropping what was there) and shrink by one
+        void moveLast(int row);
+    };
+
+    // Re-read the row of port, or add it
+    void upsert(const std::shared_ptr<ArxmlElement> &port);
+    void removeRow(int row);
+    // Drop ports that are no longer part of the document below root
+    void pruneDetached(const ArxmlElement *root);
+    void compactComSpecs();
+    void rebuildRowMap();
+
+    Columns m_columns;
+    std::unordered_map<const ArxmlElement*, int> m_rows;
+    int m_unusedComSpecs = 0;  // Pool entries no row refers to any more
+    quint64 m_revision = 0;
+};
+
+#endif // ARXML_PORT_INDEX_HPP
@@ -0,0 +1,94 @@
+// arxml_port_table_model.hpp
+//
+// Table model for the port overview: one row per port of an ArxmlPortIndex.
+// Cells are read from the index columns when the view asks for them; the
+// model itself only holds the order of the visible rows, and the port of
+// each so they can follow it when index rows move.
+//
+// Sorting and the per-column filters run on the thread pool over a
+// snapshot of the columns involved (implicitly shared strings, so taking it
+// copies no text). The view keeps showing the previous rows until the
+// result is in; results of superseded queries are dropped.
+
+#ifndef ARXML_PORT_TABLE_MODEL_HPP
+#define ARXML_PORT_TABLE_MODEL_HPP
+
+#include <QAbstractTableModel>
+#include <QFutureWatcher>
+#include <QStringList>
+#include <memory>
+#include <vector>
+
+class ArxmlElement;
+class ArxmlPortIndex;
+
+class ArxmlPortTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        ComponentColumn,
+        PortColumn,
+        DirectionColumn,
+        InterfaceColumn,
+        KindColumn,
+        ComSpecColumn,
+        ColumnCount
+    };
+
+    explicit ArxmlPortTableModel(const ArxmlPortIndex *index, QObject *parent = nullptr);
+    ~ArxmlPortTableModel() override;
+
+    // Pick up changes of the index (rows added, removed or re-read); keeps
+    // the current sort order and filters
+    void refresh();
+
+    // Show only rows whose column contains text (case insensitive); empty
+    // text clears the filter of that column
+    void setFilter(int column, const QString &text);
+
+    // Port shown in row
+    std::shared_ptr<ArxmlElement> portAt(int row) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+signals:
+    // The rows of the last query are shown
+    void queryFinished(int shownRows, int totalRows);
+
+private:
+    struct QueryResult
+    {
+        quint64 generation = 0;
+        std::vector<int> rows;
+    };
+
+    // Run the current sort and filters; rowSetChanged: rows may come or go
+    // (not just reorder)
+    void startQuery(bool rowSetChanged);
+    void onQueryFinished();
+    // Show rows, the result of the current query
+    void applyRows(std::vector<int> rows);
+    // Remember the port of each row of m_rows
+    void recordPorts();
+
+    const ArxmlPortIndex *m_index;
+    std::vector<int> m_rows;  // Index row of each table row
+    // Port of each table row; index rows are reused when ports go away
+    std::vector<std::weak_ptr<ArxmlElement>> m_ports;
+    quint64 m_revision = 0;   // Index revision m_rows was made for
+    int m_sortColumn = -1;
+    Qt::SortOrder m_sortOrder = Qt::AscendingOrder;
+    QStringList m_filters;
+
+    QFutureWatcher<QueryResult> m_queryWatcher;
+    quint64 m_queryGeneration = 0;
+    bool m_rowSetChanged = false;  // Some pending query changes the row set
+};
+
+#endif // ARXML_PORT_TABLE_MODEL_HPP
@@ -0,0 +1,67 @@
+// arxml_property_table_model.hpp
+//
+// Table model for the standard property table: the attributes of one
+// element and its text, read from the element whenever the view asks.
+// Long texts are shown cut to their first line until the user expands
+// them. Edits are not applied here but reported through attributeEdited()
+// and textEdited(), so they can go through the undo stack.
+
+#ifndef ARXML_PROPERTY_TABLE_MODEL_HPP
+#define ARXML_PROPERTY_TABLE_MODEL_HPP
+
+#include <QAbstractTableModel>
+#include <memory>
+
+class ArxmlElement;
+
+class ArxmlPropertyTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        PropertyColumn,
+        ValueColumn,
+        ColumnCount
+    };
+
+    // Texts longer than this (or with several lines) are shown elided
+    static constexpr int ElideLength = 256;
+
+    explicit ArxmlPropertyTableModel(QObject *parent = nullptr);
+
+    // Show elem; the same element again is refreshed in place
+    void setElement(const std::shared_ptr<ArxmlElement> &elem);
+    const std::shared_ptr<ArxmlElement>& element() const { return m_element; }
+
+    // Pick up edits of the element
+    void refresh();
+
+    bool isTextRow(int row) const;
+
+    // The text is shown cut off; setTextExpanded(true) shows and allows
+    // editing all of it
+    bool isTextElided() const;
+    void setTextExpanded(bool expanded);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+
+signals:
+    void attributeEdited(const QString &name, const QString &value);
+    void textEdited(const QString &text);
+
+private:
+    bool isLongText() const;
+
+    std::shared_ptr<ArxmlElement> m_element;
+    int m_attributeCount = 0;
+    bool m_hasTextRow = false;  // Kept while the text is edited to empty
+    bool m_textExpanded = false;
+};
+
+#endif // ARXML_PROPERTY_TABLE_MODEL_HPP
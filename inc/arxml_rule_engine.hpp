@@ -0,0 +1,113 @@
+// arxml_rule_engine.hpp
+//
+// Pluggable engine for AUTOSAR semantic checks that schema validation cannot
+// express (reference integrity, unique SHORT-NAMEs, COM-SPEC consistency).
+// The engine builds one shared index over the model (AUTOSAR paths, elements
+// by tag, references) and then runs the registered rules concurrently on the
+// global thread pool. Each rule contributes candidate elements which are
+// checked in chunks; findings are merged in rule and document order.
+//
+// Unlike schema validation the rules are not split into cached units: a
+// reference may point anywhere in the document, so every run needs the
+// index of the whole document. A run is interrupted by edits instead.
+
+#ifndef ARXML_RULE_ENGINE_HPP
+#define ARXML_RULE_ENGINE_HPP
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class ArxmlModel;
+class ArxmlElement;
+
+struct ArxmlFinding
+{
+    enum class Severity { Error, Warning };
+
+    Severity severity = Severity::Error;
+    QString rule;
+    QString message;
+    QString path;          // AUTOSAR path of the nearest identifiable element
+    QList<int> indexPath;  // Location in the model, used to jump to the node
+};
+
+// Read-only lookup structures shared by all rules of one run
+class ArxmlRuleIndex
+{
+public:
+    // Stops early, leaving the index incomplete, once cancelled returns true
+    explicit ArxmlRuleIndex(const ArxmlModel &model, const std::function<bool()> &cancelled = {});
+
+    const ArxmlModel &model() const { return m_model; }
+
+    // Resolve an absolute AUTOSAR reference such as /Pkg/Interfaces/If1
+    const ArxmlElement *resolve(const QString &autosarPath) const;
+
+    // AUTOSAR path of the element, or of its nearest identifiable ancestor
+    QString pathOf(const ArxmlElement *elem) const;
+
+    // All elements with the given tag name, in document order
+    const std::vector<const ArxmlElement*> &elementsWithTag(const QString &tagName) const;
+
+    // Reference elements (*-REF, *-TREF) with a path as text
+    const std::vector<const ArxmlElement*> &references() const { return m_references; }
+
+    // Identifiables whose AUTOSAR path was already taken by an earlier one
+    const std::vector<const ArxmlElement*> &duplicatePaths() const { return m_duplicates; }
+
+    // SHORT-NAME text of an identifiable element, empty otherwise
+    static QString shortName(const ArxmlElement *elem);
+
+private:
+    const ArxmlModel &m_model;
+    QHash<QString, const ArxmlElement*> m_byPath;
+    QHash<const ArxmlElement*, QString> m_pathOf;
+    QHash<QString, std::vector<const ArxmlElement*>> m_byTag;
+    std::vector<const ArxmlElement*> m_references;
+    std::vector<const ArxmlElement*> m_duplicates;
+};
+
+// Base class for a semantic rule. A rule names the elements it wants to look
+// at; the engine splits them into chunks and calls checkElement() for each
+// element from worker threads, so implementations must not keep state.
+class ArxmlRule
+{
+public:
+    virtual ~ArxmlRule() = default;
+
+    virtual QString name() const = 0;
+    virtual std::vector<const ArxmlElement*> candidates(const ArxmlRuleIndex &index) const = 0;
+    virtual void checkElement(const ArxmlRuleIndex &index, const ArxmlElement *elem,
+                              std::vector<ArxmlFinding> &findings) const = 0;
+
+protected:
+    // Build a finding located at elem
+    ArxmlFinding makeFinding(const ArxmlRuleIndex &index, const ArxmlElement *elem,
+                             const QString &message,
+                             ArxmlFinding::Severity severity = ArxmlFinding::Severity::Error) const;
+};
+
+class ArxmlRuleEngine
+{
+public:
+    // Registers the built-in rules
+    ArxmlRuleEngine();
+    ~ArxmlRuleEngine();
+
+    void addRule(std::unique_ptr<ArxmlRule> rule);
+
+    // Run all rules against the model and return their findings. Meant for
+    // a worker thread: the model is read inside an ArxmlModel::ReadAccess
+    // and false is returned (findings left empty) if it is changed after
+    // editGeneration.
+    bool run(const ArxmlModel &model, quint64 editGeneration, std::vector<ArxmlFinding> &findings) const;
+
+private:
+    std::vector<std::unique_ptr<ArxmlRule>> m_rules;
+};
+
+#endif // ARXML_RULE_ENGINE_HPP
@@ -0,0 +1,120 @@
+// arxml_undo.hpp
+//
+// Undo commands for edits of an ArxmlModel, for use with QUndoStack.
+// Commands address elements by index path and store only the change itself:
+// the old and new strings (implicitly shared with the document) or the
+// removed subtree, which is detached and kept as is rather than copied. Undo
+// and redo cost O(size of the change), independent of the document size.
+//
+// Commands edit through the ArxmlModel edit functions, so views learn what
+// changed from ArxmlModel::takeChanges().
+
+#ifndef ARXML_UNDO_HPP
+#define ARXML_UNDO_HPP
+
+#include "arxml_model.hpp"
+
+#include <QList>
+#include <QString>
+#include <QUndoCommand>
+#include <memory>
+#include <vector>
+
+class ArxmlEditCommand : public QUndoCommand
+{
+protected:
+    ArxmlEditCommand(ArxmlModel *model, const QList<int> &path, const QString &text);
+
+    // Element at m_path; pages it in for out-of-core documents
+    std::shared_ptr<ArxmlElement> element() const;
+
+    ArxmlModel *m_model;
+    QList<int> m_path;
+};
+
+// Replace the text of an element
+class ArxmlSetTextCommand : public ArxmlEditCommand
+{
+public:
+    ArxmlSetTextCommand(ArxmlModel *model, const QList<int> &path, const QString &text,
+                        const QString &description);
+
+    void redo() override;
+    void undo() override;
+
+private:
+    void apply(const QString &text);
+
+    QString m_oldText;
+    QString m_newText;
+};
+
+// Set an attribute, adding it if the element does not have it yet
+class ArxmlSetAttributeCommand : public ArxmlEditCommand
+{
+public:
+    ArxmlSetAttributeCommand(ArxmlModel *model, const QList<int> &path, const QString &name,
+                             const QString &value, const QString &description);
+
+    void redo() override;
+    void undo() override;
+
+private:
+    QString m_name;
+    QString m_oldValue;
+    QString m_newValue;
+    bool m_existed = false;
+};
+
+// Insert a new element (see ArxmlModel::createElement) as child index of the
+// element at parentPath; index -1 appends
+class ArxmlInsertElementCommand : public ArxmlEditCommand
+{
+public:
+    ArxmlInsertElementCommand(ArxmlModel *model, const QList<int> &parentPath, int index,
+                              const ArxmlModel::DetachedElement &element, const QString &description);
+
+    void redo() override;
+    void undo() override;
+
+private:
+    int m_index;
+    ArxmlModel::DetachedElement m_element;
+};
+
+// Remove child index of the element at parentPath with its subtree
+class ArxmlRemoveElementCommand : public ArxmlEditCommand
+{
+public:
+    ArxmlRemoveElementCommand(ArxmlModel *model, const QList<int> &parentPath, int index,
+                              const QString &description);
+
+    void redo() override;
+    void undo() override;
+
+private:
+    int m_index;
+    ArxmlModel::DetachedElement m_removed;
+};
+
+// Several edits as one undo step. Commands are applied as they are added
+// (e.g. inside an ArxmlModel transaction), so the redo() from
+// QUndoStack::push() does nothing the first time.
+class ArxmlBatchCommand : public QUndoCommand
+{
+public:
+    explicit ArxmlBatchCommand(const QString &text);
+
+    // Apply command and keep it
+    void add(std::unique_ptr<QUndoCommand> command);
+    int count() const { return static_cast<int>(m_commands.size()); }
+
+    void redo() override;
+    void undo() override;
+
+private:
+    std::vector<std::unique_ptr<QUndoCommand>> m_commands;
+    bool m_applied = true;
+};
+
+#endif // ARXML_UNDO_HPP
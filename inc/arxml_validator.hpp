@@ -4,23 +4,104 @@
 // documents against an XSD schema using the external `xmllint` tool. This
 // approach avoids requiring the Qt XmlPatterns module, which may not be
 // available on all platforms, while still providing robust schema
-// validation. The validator writes the current document to a temporary
-// file and executes xmllint via QProcess. Any error output from the
-// process is returned to the caller for display.
+// validation. The validator serializes the document in memory with
+// ArxmlWriter and pipes it to xmllint via QProcess. Any error output from
+// the process is returned to the caller for display.
+//
+// For repeated validation of an edited document the validator splits it into
+// validation units and caches the result of each unit:
+//  - the document skeleton: the root element without its AR-PACKAGES,
+//  - every AR-PACKAGE (at any depth) without the content of its ELEMENTS and
+//    AR-PACKAGES,
+//  - every element inside a package's ELEMENTS.
+// validateIncremental() only checks units that changed since the last run
+// (by revision stamps, and by the start tags and package names they are
+// nested in). Those units are written into a few batch documents, each
+// nesting its units in just the start tags and SHORT-NAMEs of their enclosing
+// elements, and the batches are passed to concurrent xmllint processes.
+// Messages are mapped back to units by line number.
+//
+// validateIncremental() and checkWellFormed() are meant to run on a worker
+// thread: they read the live model inside an ArxmlModel::ReadAccess and give
+// up (returning false) as soon as the model is changed. Only one
+// validateIncremental() may run at a time, and clearCache() must not be
+// called while it does.
+//
+// Without a schema, checkWellFormed() verifies the in-memory tree directly
+// (names, characters, attributes and namespace prefixes) in a single pass,
+// without serializing the document.
 
 #ifndef ARXML_VALIDATOR_HPP
 #define ARXML_VALIDATOR_HPP
 
 #include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 class ArxmlModel;
+class ArxmlElement;
 
 class ArxmlValidator
 {
 public:
+    // Errors of one validation unit
+    struct UnitErrors
+    {
+        QString label;        // AUTOSAR path of the unit (tag name for the skeleton)
+        QList<int> indexPath; // Path of the unit element in the model
+        QString errors;       // xmllint messages, "label:line: ..." per problem
+    };
+
     // Validate the given model against the specified schema file. Returns an
     // empty string on success, or the error output from xmllint on failure.
     QString validate(const ArxmlModel &model, const QString &schemaFile) const;
+
+    // Validate only the units touched since the previous call and reuse the
+    // cached results for the others. errors receives the units with errors,
+    // in document order. Returns false if the model changed after
+    // editGeneration (see ArxmlModel::editGeneration()) or cancel() was
+    // called; errors is left empty then, but the results of the units
+    // checked so far are kept for the next run.
+    bool validateIncremental(const ArxmlModel &model, const QString &schemaFile,
+                             quint64 editGeneration, std::vector<UnitErrors> &errors);
+
+    // Make a running validateIncremental() stop its xmllint processes and
+    // return as soon as possible, e.g. before the model is deleted
+    void cancel() { m_cancelled = true; }
+
+    // Drop all cached unit results (e.g. after a new document was loaded).
+    void clearCache();
+
+    // Check that the model would serialize to well-formed, namespace-valid
+    // XML: legal element/attribute names, legal characters in text and
+    // attribute values, no duplicate attributes and only declared prefixes.
+    // errors receives one line per problem found. Returns false if the model
+    // changed after editGeneration.
+    bool checkWellFormed(const ArxmlModel &model, quint64 editGeneration, QString &errors) const;
+
+private:
+    struct UnitResult
+    {
+        std::weak_ptr<const ArxmlElement> element; // Detects a reused address
+        quint64 revision = 0;
+        size_t context = 0;
+        QString errors;
+    };
+
+    // Run xmllint on document; returns its exit code (-1 if it could not be
+    // run or was stopped because cancelled became true) and the error output
+    // in errors
+    static int runXmllint(const QByteArray &document, const QString &schemaFile, QString &errors,
+                          const std::atomic<bool> *cancelled = nullptr);
+
+    QHash<const ArxmlElement*, UnitResult> m_unitResults;
+    const ArxmlElement *m_cachedRoot = nullptr;
+    QString m_cachedSchema;
+    std::atomic<bool> m_cancelled{false};
 };
 
-#endif // ARXML_VALIDATOR_HPP
\ No newline at end of file
+#endif // ARXML_VALIDATOR_HPP
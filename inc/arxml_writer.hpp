@@ -0,0 +1,163 @@
+// arxml_writer.hpp
+//
+// Direct UTF-8 serializer for ArxmlElement trees. Names, text and attribute
+// values are escaped and encoded from their UTF-16 QString data straight into
+// one growing output buffer, without going through QXmlStreamWriter or a
+// QIODevice. Runs of plain ASCII with nothing to escape (the bulk of ARXML
+// content) are copied eight characters per step with SSE2 where available.
+//
+// Pretty output uses the indented layout of QXmlStreamWriter's auto-formatting
+// (two spaces per level, LF line endings); compact output has no whitespace
+// between tags.
+
+#ifndef ARXML_WRITER_HPP
+#define ARXML_WRITER_HPP
+
+#include <QByteArray>
+#include <QString>
+#include <QStringView>
+#include <functional>
+#include <utility>
+#include <vector>
+
+class ArxmlElement;
+class ArxmlSnapshotReader;
+struct ArxmlMarkup;
+
+class ArxmlWriter
+{
+public:
+    enum class Format { Pretty, Compact };
+
+    // Characters replaced by references: none (CDATA), <>&CR (text) or
+    // additionally quote, LF and tab (attribute values)
+    enum class Escaping { None, Text, Attribute };
+
+    explicit ArxmlWriter(Format format = Format::Pretty);
+
+    Format format() const { return m_format; }
+
+    // Make room for at least size bytes of output
+    void reserve(qsizetype size);
+
+    // Source file of an out-of-core document; the content of stub elements
+    // (ArxmlElement::stub) is copied from its spans. Without a source stubs
+    // are written as empty elements.
+    void setSource(const char *data, qint64 size);
+
+    // Offset of the spans of the elements written next: the sum of the
+    // ArxmlElement::sourceShift of their ancestors
+    void setSourceShift(qint64 shift);
+
+    // Write a tree that is being edited on another thread: writeElement()
+    // and the tag writers read the elements through reader (see
+    // ArxmlSnapshot), which is paused before output goes to the sink
+    void setSnapshot(ArxmlSnapshotReader *reader);
+
+    // Where an element was written; begin and end count from the first byte
+    // of this writer's output (see position()), the rest is laid out like
+    // the source span fields of ArxmlElement
+    struct Span
+    {
+        const ArxmlElement *elem;  // As passed in, not its snapshot view
+        qint64 shift;              // Source shift the element was written with
+        qint64 begin;
+        qint64 end;
+        quint32 lead;
+        quint32 startTag;
+        quint32 tail;
+    };
+
+    // Record a Span for every element written from now on, so a saved file
+    // can be used as source; a start tag written alone is completed by the
+    // matching writeEndTag()
+    void setSpans(std::vector<Span> *spans);
+
+    // Stream instead of collecting everything: pass the buffered output to
+    // sink once it exceeds flushSize (checked after each element) and stub
+    // content straight from the source. flush() hands over the rest.
+    void setSink(std::function<void(const QByteArray &data)> sink, qsizetype flushSize);
+    void flush();
+
+    // <?xml version="1.0" encoding="UTF-8"?>
+    void writeDeclaration();
+
+    // Write elem and its subtree; depth is the nesting level used for the
+    // indentation of pretty output
+    void writeElement(const ArxmlElement &elem, int depth = 0);
+
+    // Start or end tag of elem alone, for partial documents that only
+    // contain some of its children
+    void writeStartTag(const ArxmlElement &elem, int depth = 0);
+    void writeEndTag(const ArxmlElement &elem, int depth = 0);
+
+    // The comments and processing instructions of markup that precede child
+    // before (ArxmlElement::markup), one per line at depth. Goes with
+    // writeStartTag(): call it in front of every child and the end tag.
+    void writeMarkup(const std::vector<ArxmlMarkup> &markup, size_t before, int depth);
+
+    // Character data, escaped or as CDATA section(s)
+    void writeText(const QString &text, bool cdata);
+
+    // Bytes copied as they are, e.g. a preserved prolog
+    void writeRaw(const QByteArray &data);
+
+    // Markup pieces for writing a document from parse events rather than a
+    // tree (see ArxmlPipeline); no indentation is added. writeTagOpen()
+    // leaves the start tag open for the caller to finish with ">" or "/>".
+    void writeTagOpen(const QString &name, const std::vector<std::pair<QString, QString>> &attributes);
+    void writeTagClose(const QString &name);
+    void writeComment(const QString &text);
+    void writeProcessingInstruction(const QString &target, const QString &data);
+
+    // Bytes written so far
+    qsizetype size() const { return m_size; }
+
+    // Bytes written so far, including those already handed out
+    qint64 position() const { return m_written + m_size; }
+
+    // Hand out the output written so far and start over with an empty buffer
+    QByteArray takeData();
+
+private:
+    // Pointer to room for extra more bytes at the end of the output
+    char *reserveTail(qsizetype extra);
+    void writeBytes(const char *data, qsizetype size);
+    void writeIndent(int depth);
+    void writeNewline();
+    // "<tag attr="value"..." without the closing bracket
+    void writeOpenTag(const ArxmlElement &elem, int depth);
+    void writeEncoded(QStringView value, Escaping escaping);
+    void writeStub(const ArxmlElement &elem, int depth, size_t span);
+    void writeMarkupToken(const ArxmlMarkup &token);
+    qint64 indentSize(int depth) const;
+    qint64 newlineSize() const;
+    // Span of an element whose start tag is written next at depth, and its
+    // completion after the line break behind it; tailBegin is where the
+    // content after its last child starts
+    size_t beginSpan(const ArxmlElement &elem, int depth);
+    void endSpan(size_t index, qint64 startTagEnd, qint64 tailBegin);
+    // Where the lead of the next element (or the tail of its parent)
+    // starts: at the line break in front, or before the markup written by
+    // writeMarkup()
+    qint64 takeLeadBegin();
+
+    QByteArray m_buffer;
+    qsizetype m_size = 0;
+    Format m_format;
+    const char *m_source = nullptr;
+    qint64 m_sourceSize = 0;
+    qint64 m_sourceShift = 0;
+    ArxmlSnapshotReader *m_reader = nullptr;
+    // Children of the elements being written, innermost last
+    std::vector<const ArxmlElement*> m_children;
+    std::vector<Span> *m_spans = nullptr;
+    // Spans of the start tags written alone: index and end of the start tag
+    std::vector<std::pair<size_t, qint64>> m_openSpans;
+    qint64 m_leadBegin = -1;
+    qint64 m_written = 0;
+    std::function<void(const QByteArray &data)> m_sink;
+    qsizetype m_flushSize = 0;
+};
+
+#endif // ARXML_WRITER_HPP
@@ -0,0 +1,124 @@
+// bulk_comspec_dialog.hpp
+//
+// Dialog for setting the same COM-SPEC values (queue length, alive timeout,
+// E2E transformation parameters, ...) on many ports at once. A port query
+// selects the COM-SPECs, the preview lists each of them with the changes it
+// would get, and on accept the caller applies assignments() to targets() as
+// one edit batch. The dialog itself does not change the model.
+
+#ifndef BULK_COMSPEC_DIALOG_HPP
+#define BULK_COMSPEC_DIALOG_HPP
+
+#include <QDialog>
+#include <QHash>
+#include <QList>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <vector>
+
+class ArxmlModel;
+class ArxmlElement;
+class QCheckBox;
+class QComboBox;
+class QDialogButtonBox;
+class QLabel;
+class QLineEdit;
+class QTableWidget;
+class QWidget;
+
+class BulkComSpecDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    // COM-SPEC kinds a value applies to
+    enum ComSpecKind {
+        Sender = 0x1,
+        NonqueuedReceiver = 0x2,
+        QueuedReceiver = 0x4,
+        Server = 0x8
+    };
+
+    // A COM-SPEC matched by the query
+    struct Target
+    {
+        QList<int> path;        // Index path of the COM-SPEC element
+        QString port;           // Short-name path of the port
+        QString comSpecTag;
+        QString dataElement;    // Last part of the data element / operation reference
+        int kind = 0;           // ComSpecKind
+        // Text of the elements of the dialog's fields that the COM-SPEC
+        // has, by tag path joined with '/'; kept as values since the page
+        // holding the COM-SPEC may be evicted after the query
+        QHash<QString, QString> current;
+    };
+
+    // A value to set: the element at tagPath below the COM-SPEC gets text
+    // value, created (with missing parents) if necessary
+    struct Assignment
+    {
+        QStringList tagPath;
+        QString value;
+        int kinds = 0;  // ComSpecKinds it applies to
+    };
+
+    explicit BulkComSpecDialog(ArxmlModel *model, QWidget *parent = nullptr);
+    ~BulkComSpecDialog() override;
+
+    const std::vector<Target>& targets() const { return m_targets; }
+    std::vector<Assignment> assignments() const;
+
+    // Number of element edits applying the assignments takes
+    int pendingEditCount() const { return m_pendingEdits; }
+
+    // Index at which a new child with tag belongs among the children of
+    // parent, following the AUTOSAR schema order of COM-SPEC content
+    static int childInsertIndex(const ArxmlElement *parent, const QString &tag);
+
+signals:
+    // The query paged in a stub of an out-of-core document and is done
+    // with it; pages may be evicted now to stay within the memory limit
+    void pageScanned();
+
+private slots:
+    void runQuery();
+    void updatePreview();
+
+private:
+    struct FieldEditor
+    {
+        QCheckBox *enabled = nullptr;
+        QLineEdit *valueEdit = nullptr;   // Numeric values
+        QComboBox *valueCombo = nullptr;  // Boolean values
+        QStringList tagPath;
+        int kinds = 0;
+    };
+
+    void addField(QWidget *parent, const QString &label, const QStringList &tagPath, int kinds, bool boolean);
+    void collectTargets(const std::shared_ptr<ArxmlElement> &elem, QList<int> &path, const QString &namePath);
+    void collectComSpecs(const std::shared_ptr<ArxmlElement> &port, const QList<int> &portPath,
+                         const QString &portName);
+
+    ArxmlModel *m_model;
+    std::vector<Target> m_targets;
+    std::vector<FieldEditor> m_fields;
+    int m_pendingEdits = 0;
+
+    // Query of the last runQuery()
+    QString m_portTag;  // Empty: any port kind
+    QRegularExpression m_portPattern;
+    QRegularExpression m_interfacePattern;
+    QRegularExpression m_dataElementPattern;
+
+    QLineEdit *m_portNameEdit;
+    QComboBox *m_portKindCombo;
+    QLineEdit *m_interfaceEdit;
+    QLineEdit *m_dataElementEdit;
+    QTableWidget *m_previewTable;
+    QLabel *m_summaryLabel;
+    QDialogButtonBox *m_buttons;
+};
+
+#endif // BULK_COMSPEC_DIALOG_HPP
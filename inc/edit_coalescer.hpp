@@ -0,0 +1,49 @@
+// edit_coalescer.hpp
+//
+// Batches per-keystroke edits of a form field into one model mutation.
+// Change handlers call schedule() on every keystroke; the commit function
+// runs once, when typing pauses, when a watched field loses focus or when
+// flush() is called (selection change, save, undo, other edits).
+// Scheduling a different field commits the pending one first, so no typed
+// text is lost.
+
+#ifndef EDIT_COALESCER_HPP
+#define EDIT_COALESCER_HPP
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <functional>
+
+class QWidget;
+
+class EditCoalescer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EditCoalescer(int idleMs, QObject *parent = nullptr);
+
+    // Commit the pending edit when widget loses focus
+    void watch(QWidget *widget);
+
+    // Remember that field key changed; commit replaces any earlier commit
+    // of the same field
+    void schedule(const QString &key, std::function<void()> commit);
+
+    // Run the pending commit now
+    void flush();
+
+    // Drop the pending commit, e.g. after fields were filled in by code
+    void discard();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    QTimer m_idleTimer;
+    QString m_key;
+    std::function<void()> m_commit;
+};
+
+#endif // EDIT_COALESCER_HPP
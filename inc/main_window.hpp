@@ -5,12 +5,19 @@
 #ifndef MAIN_WINDOW_HPP
 #define MAIN_WINDOW_HPP
 
+#include "action_log_model.hpp"
+#include "port_view_cache.hpp"
+
 #include <QMainWindow>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QMutex>
+#include <atomic>
 #include <memory>
+#include <vector>
 
 class QTreeWidget;
 class QTableWidget;
-class QTableWidgetItem;
 class QPushButton;
 class QTreeWidgetItem;
 class QTextEdit;
@@ -26,9 +33,26 @@ class QButtonGroup;
 class QCheckBox;
 class QComboBox;
 class QListWidget;
+class QProgressBar;
+class QUndoStack;
 class ArxmlModel;
+class ArxmlSaveJob;
 class ArxmlValidator;
+class ArxmlRuleEngine;
 class ArxmlElement;
+class ArxmlPipeline;
+class ArxmlEditCommand;
+class ArxmlBatchCommand;
+class EditCoalescer;
+class ArxmlPortIndex;
+class ArxmlPortTableModel;
+class ArxmlPropertyTableModel;
+class QTableView;
+class QModelIndex;
+class QDockWidget;
+class QListView;
+class QSortFilterProxyModel;
+struct ArxmlChange;
 
 class MainWindow : public QMainWindow
 {
@@ -41,18 +65,46 @@ public:
 private slots:
     // File operations
     void openFile();
+    // Open only some packages / element types of a file (projected load)
+    void openFileSubset();
     void saveFile();
     void saveFileAs();
 
+    // Background loading
+    void onLoadFinished();
+    void cancelLoad();
+
+    // Background saving
+    void onSaveFinished();
+
+    // Background document checks
+    void onChecksFinished();
+
+    // Streaming transform of a file on disk (not the open document)
+    void transformFile();
+    void onTransformFinished();
+
+    // Set COM-SPEC values on all ports matching a query, as one edit
+    void bulkEditComSpecs();
+
     // Tree selection
     void onCurrentItemChanged(QTreeWidgetItem *current, QTreeWidgetItem *previous);
+    // Out-of-core documents: build the children of a stub when it is expanded
+    void onItemExpanded(QTreeWidgetItem *item);
     // Search filter
     void onSearchTextChanged(const QString &text);
+    // Out-of-core documents: page in stubs whose source contains the search text
+    void onSearchSubmitted();
+    // Port overview: select the port of the activated row in the tree
+    void onPortOverviewActivated(const QModelIndex &index);
+    // Write the action log to a file chosen by the user
+    void exportActionLog();
     void filterTreeItems(const QString &searchText);
     void showItemAndChildren(QTreeWidgetItem *item);
 
     // Property table edits
-    void onPropertyItemChanged(QTableWidgetItem *item);
+    void onPropertyAttributeEdited(const QString &name, const QString &value);
+    void onPropertyTextEdited(const QString &text);
     // Description text edit
     void onDescriptionTextChanged();
     
@@ -71,6 +123,13 @@ private slots:
     // Validation
     void validateDocument();
 
+    // Undo/redo of document edits
+    void undoEdit();
+    void redoEdit();
+
+    // Messages tab: jump to the element a finding refers to
+    void onMessageActivated(QTreeWidgetItem *item, int column);
+
 private:
     // Build the tree view from the model
     void populateTree();
@@ -79,16 +138,44 @@ private:
     void populatePropertyTable(ArxmlElement* elem);
     
     // Populate standard property table
-    void populateStandardPropertyTable(ArxmlElement* elem);
+    void populateStandardPropertyTable(const std::shared_ptr<ArxmlElement>& elem);
     
     // Populate PORTS-specific tabs
-    void populatePortsTabs(ArxmlElement* elem);
+    void populatePortsTabs(const std::shared_ptr<ArxmlElement>& elem);
+    
+    // Read what the PORTS tabs show for a port from the model
+    PortView extractPortView(const std::shared_ptr<ArxmlElement>& elem);
+    
+    // Show view in the PORTS tabs, touching only widgets that differ
+    void applyPortView(const PortView& view);
+    
+    // Build the PORTS tabs on first use
+    void ensurePortsTabs();
     
     // Setup PORTS tabs configuration
     void setupPortsTabs();
     
-    // Build tree recursively
-    void buildTreeRecursive(const std::shared_ptr<ArxmlElement>& elem, QTreeWidgetItem* parentItem);
+    // Start loading fileName on a worker thread into a fresh model,
+    // optionally restricted to a projection (see ArxmlLoadOptions)
+    void startLoad(const QString& fileName, const QStringList& packagePaths = QStringList(),
+                   const QStringList& elementTags = QStringList());
+
+    // Save a snapshot of the current document to fileName on a worker thread
+    void startSave(const QString& fileName);
+
+    // Show load progress in the status bar (GUI thread)
+    void onLoadProgress(qint64 bytesRead, qint64 totalBytes);
+
+    // Show the packages published by the loader since the last call (GUI thread)
+    void flushLoadedPackages();
+
+    // Leave preview mode: drop preview state and make the view editable again
+    void endLoadPreview();
+
+    // Build tree recursively; indexPath is the path of elem in the model.
+    // Returns the item created for elem.
+    QTreeWidgetItem* buildTreeRecursive(const std::shared_ptr<ArxmlElement>& elem, QTreeWidgetItem* parentItem,
+                                        const QList<int>& indexPath);
     
     // Refresh tree item display from element data
     void refreshTreeItem(QTreeWidgetItem* item, ArxmlElement* elem);
@@ -98,138 +185,257 @@ private:
     
     // Check if element is a PORTS element or child of PORTS
     bool isPortsElement(ArxmlElement* elem) const;
-    // Check if element is R-PORT-PROTOTYPE with SENDER-RECEIVER-INTERFACE
-    bool isRPortPrototypeWithSenderReceiver(ArxmlElement* elem) const;
-    // Check if element is R-PORT-PROTOTYPE with CLIENT-SERVER-INTERFACE
-    bool isRPortPrototypeWithClientServer(ArxmlElement* elem) const;
-    // Check if element is P-PORT-PROTOTYPE with PROVIDED-INTERFACE-TREF DEST="CLIENT-SERVER-INTERFACE" (server port)
-    bool isPPortPrototypeClientServer(ArxmlElement* elem) const;
     
     // Update action log
-    void logAction(const QString& message);
+    void logAction(const QString& message, ActionLogModel::Severity severity = ActionLogModel::Severity::Info);
+
+    // Check the document on a worker: schema validation (or well-formedness
+    // without a schema) and the semantic rules. A run already going on is
+    // followed by another one.
+    struct CheckResult;
+    void startChecks();
+
+    // List schema errors and rule findings in the Messages tab
+    void showCheckResults(const CheckResult& result);
+
+    // Locate the tree item for an element index path (nullptr if not shown)
+    QTreeWidgetItem* findTreeItem(const QList<int>& indexPath) const;
+
+    // Out-of-core documents: evict pages over the memory limit (keeping the
+    // current element) and fold their tree items back into stubs. Waits
+    // while the matches of a search are shown (m_pagedSearch).
+    void evictIdlePages();
+
+    // Apply an edit through the undo stack and log it; inside an edit batch
+    // it becomes part of the batch
+    void pushEdit(ArxmlEditCommand *command);
+
+    // Edit batches: the edits pushed in between run in one model
+    // transaction and become one undo step, one log entry and one view
+    // update. Rolling back reverts them; if that fails part way (logged,
+    // views rebuilt) it returns false.
+    void beginEditBatch(const QString& description);
+    void commitEditBatch();
+    bool rollbackEditBatch();
+
+    // Update the tree for the model changes since the last call
+    void applyModelChanges();
+
+    // Set the element at tagPath below the COM-SPEC at comSpecPath to value,
+    // creating missing elements in schema order (part of the open batch).
+    // False if comSpecPath no longer leads to a comSpecTag element.
+    bool setComSpecValue(const QList<int>& comSpecPath, const QString& comSpecTag, const QStringList& tagPath,
+                         const QString& value);
+
+    // Commit the coalesced keystrokes of the port name / description field
+    // to the element at path
+    void commitPortName(const QList<int>& path);
+    void commitDescription(const QList<int>& path);
+
+    // Bring the tree in line with one coalesced model change
+    void applyChangeToView(const ArxmlChange& change);
+
+    // Replace the child items of item with items for elem's children
+    void buildChildItems(QTreeWidgetItem* item, const std::shared_ptr<ArxmlElement>& elem);
+
+    // Store indexPath on item and the matching paths on its descendants
+    void updateItemPaths(QTreeWidgetItem* item, const QList<int>& indexPath);
 
     // UI members
     QTreeWidget *m_treeWidget;
     QTabWidget *m_propertyTabWidget;
-    QTableWidget *m_propertyTable;  // Standard property table
-    QWidget *m_portsPropertiesTab;  // PORTS Properties tab (form widget)
-    QWidget *m_portsApiOptionsTab;  // PORTS Port API Options tab (form widget)
-    QWidget *m_portsCommSpecTab;    // PORTS Communication Spec tab (form widget)
-    QTextEdit *m_portsDescriptionTab; // PORTS Description tab (text input panel)
+    QTableView *m_propertyTable;  // Standard property table
+    ArxmlPropertyTableModel *m_propertyModel;  // Attributes and text of the selected element
+    QWidget *m_portsPropertiesTab = nullptr;  // PORTS Properties tab (form widget)
+    QWidget *m_portsApiOptionsTab = nullptr;  // PORTS Port API Options tab (form widget)
+    QWidget *m_portsCommSpecTab = nullptr;    // PORTS Communication Spec tab (form widget)
+    QTextEdit *m_portsDescriptionTab = nullptr; // PORTS Description tab (text input panel)
     QTabWidget *m_logTabWidget;  // Tab widget for Action Log and Messages
-    QTextEdit *m_actionLog;
-    QWidget *m_messagesTab;  // Messages tab (placeholder for now)
+    ActionLogModel *m_actionLog;  // Last ActionLogCapacity lines of the action log
+    QListView *m_actionLogView;
+    QSortFilterProxyModel *m_actionLogFilter;  // Severity filter of the view
+    bool m_actionLogFollow = true;  // View was scrolled to the newest line
+    QWidget *m_messagesTab;  // Messages tab (semantic check findings)
+    QTreeWidget *m_messagesList;  // Sortable findings list inside the Messages tab
     
     // Properties tab widgets
-    QLineEdit *m_portNameEdit;
-    QGroupBox *m_portInterfaceGroup;
-    QLineEdit *m_portInterfaceNameEdit;
-    QGroupBox *m_blueprintGroup;
-    QLineEdit *m_blueprintNameEdit;
-    QGroupBox *m_directionGroup;
-    QButtonGroup *m_directionButtonGroup;
-    QRadioButton *m_directionRadio1;
-    QRadioButton *m_directionRadio2;
-    QRadioButton *m_directionRadio3;
+    QLineEdit *m_portNameEdit = nullptr;
+    QGroupBox *m_portInterfaceGroup = nullptr;
+    QLineEdit *m_portInterfaceNameEdit = nullptr;
+    QGroupBox *m_blueprintGroup = nullptr;
+    QLineEdit *m_blueprintNameEdit = nullptr;
+    QGroupBox *m_directionGroup = nullptr;
+    QButtonGroup *m_directionButtonGroup = nullptr;
+    QRadioButton *m_directionRadio1 = nullptr;
+    QRadioButton *m_directionRadio2 = nullptr;
+    QRadioButton *m_directionRadio3 = nullptr;
     
     // Port API Options tab widgets
-    QGroupBox *m_apiOptionsGroup;
-    QCheckBox *m_enableIndirectApiCheck;
-    QCheckBox *m_enableApiUsageByAddressCheck;
-    QCheckBox *m_transformationErrorHandlingCheck;
-    QGroupBox *m_portDefinedArgsGroup;
-    QTableWidget *m_portDefinedArgsTable;
-    QPushButton *m_editArgsButton;
-    QPushButton *m_getFromButton;
-    QPushButton *m_copyToButton;
+    QGroupBox *m_apiOptionsGroup = nullptr;
+    QCheckBox *m_enableIndirectApiCheck = nullptr;
+    QCheckBox *m_enableApiUsageByAddressCheck = nullptr;
+    QCheckBox *m_transformationErrorHandlingCheck = nullptr;
+    QGroupBox *m_portDefinedArgsGroup = nullptr;
+    QTableWidget *m_portDefinedArgsTable = nullptr;
+    QPushButton *m_editArgsButton = nullptr;
+    QPushButton *m_getFromButton = nullptr;
+    QPushButton *m_copyToButton = nullptr;
     
     // Port Communication Spec tab widgets
-    QListWidget *m_commSpecDeElementsList;  // Left panel with De_... elements
-    QTabWidget *m_commSpecSubTabs;  // Right panel sub-tabs (Sender/Receiver ComSpec, Interface Properties, Description)
-    QWidget *m_senderComSpecTab;  // Sender ComSpec sub-tab with form fields
-    QWidget *m_receiverComSpecTab;  // Receiver ComSpec sub-tab with form fields (for R-PORT-PROTOTYPE with SENDER-RECEIVER-INTERFACE)
-    QWidget *m_clientServerComSpecTab;  // Client-Server ComSpec sub-tab (for R-PORT-PROTOTYPE with CLIENT-SERVER-INTERFACE)
-    QWidget *m_serverComSpecTab;  // Server ComSpec sub-tab (for P-PORT-PROTOTYPE with PROVIDED-INTERFACE-TREF DEST="SENDER-RECEIVER-INTERFACE")
-    QWidget *m_interfacePropertiesTab;  // Interface Properties sub-tab
-    QWidget *m_commSpecDescriptionTab;  // Description sub-tab
-    QLabel *m_commSpecNoPropertiesLabel;  // Label shown when no De element is selected
+    QListWidget *m_commSpecDeElementsList = nullptr;  // Left panel with De_... elements
+    QTabWidget *m_commSpecSubTabs = nullptr;  // Right panel sub-tabs (Sender/Receiver ComSpec, Interface Properties, Description)
+    QWidget *m_senderComSpecTab = nullptr;  // Sender ComSpec sub-tab with form fields
+    QWidget *m_receiverComSpecTab = nullptr;  // Receiver ComSpec sub-tab with form fields (for R-PORT-PROTOTYPE with SENDER-RECEIVER-INTERFACE)
+    QWidget *m_clientServerComSpecTab = nullptr;  // Client-Server ComSpec sub-tab (for R-PORT-PROTOTYPE with CLIENT-SERVER-INTERFACE)
+    QWidget *m_serverComSpecTab = nullptr;  // Server ComSpec sub-tab (for P-PORT-PROTOTYPE with PROVIDED-INTERFACE-TREF DEST="SENDER-RECEIVER-INTERFACE")
+    QWidget *m_interfacePropertiesTab = nullptr;  // Interface Properties sub-tab
+    QWidget *m_commSpecDescriptionTab = nullptr;  // Description sub-tab
+    QLabel *m_commSpecNoPropertiesLabel = nullptr;  // Label shown when no De element is selected
     // Receiver ComSpec widgets
-    QLineEdit *m_receiverInitValueEdit;
-    QComboBox *m_receiverInitValueTypeCombo;
-    QPushButton *m_receiverInitValueEditButton;
-    QButtonGroup *m_rxFilterButtonGroup;
-    QRadioButton *m_rxFilterAlwaysRadio;
-    QRadioButton *m_rxFilterMaskedRadio;
-    QCheckBox *m_receiverUsesEndToEndProtectionCheck;
-    QCheckBox *m_handleNeverReceivedCheck;
-    QCheckBox *m_enableUpdateCheck;
-    QLineEdit *m_aliveTimeoutEdit;
-    QLineEdit *m_queueLengthEdit;
-    QGroupBox *m_transformationGroup;
-    QComboBox *m_transformationTypeCombo;
-    QCheckBox *m_transformationDisabledCheck;
-    QLineEdit *m_maxDeltaCounterEdit;
-    QLineEdit *m_maxErrorStateInitEdit;
-    QLineEdit *m_maxErrorStateInvalidEdit;
-    QLineEdit *m_maxErrorStateValidEdit;
-    QLineEdit *m_minOkStateInitEdit;
-    QLineEdit *m_minOkStateInvalidEdit;
-    QLineEdit *m_minOkStateValidEdit;
-    QLineEdit *m_syncCounterInitEdit;
+    QLineEdit *m_receiverInitValueEdit = nullptr;
+    QComboBox *m_receiverInitValueTypeCombo = nullptr;
+    QPushButton *m_receiverInitValueEditButton = nullptr;
+    QButtonGroup *m_rxFilterButtonGroup = nullptr;
+    QRadioButton *m_rxFilterAlwaysRadio = nullptr;
+    QRadioButton *m_rxFilterMaskedRadio = nullptr;
+    QCheckBox *m_receiverUsesEndToEndProtectionCheck = nullptr;
+    QCheckBox *m_handleNeverReceivedCheck = nullptr;
+    QCheckBox *m_enableUpdateCheck = nullptr;
+    QLineEdit *m_aliveTimeoutEdit = nullptr;
+    QLineEdit *m_queueLengthEdit = nullptr;
+    QGroupBox *m_transformationGroup = nullptr;
+    QComboBox *m_transformationTypeCombo = nullptr;
+    QCheckBox *m_transformationDisabledCheck = nullptr;
+    QLineEdit *m_maxDeltaCounterEdit = nullptr;
+    QLineEdit *m_maxErrorStateInitEdit = nullptr;
+    QLineEdit *m_maxErrorStateInvalidEdit = nullptr;
+    QLineEdit *m_maxErrorStateValidEdit = nullptr;
+    QLineEdit *m_minOkStateInitEdit = nullptr;
+    QLineEdit *m_minOkStateInvalidEdit = nullptr;
+    QLineEdit *m_minOkStateValidEdit = nullptr;
+    QLineEdit *m_syncCounterInitEdit = nullptr;
     // Client-Server ComSpec widgets (for R-PORT-PROTOTYPE with CLIENT-SERVER-INTERFACE)
-    QListWidget *m_clientServerDeElementsList;  // Left panel with data elements
-    QGroupBox *m_clientServerTransformationGroup;
-    QComboBox *m_clientServerTransformationTypeCombo;
-    QCheckBox *m_clientServerTransformationDisabledCheck;
-    QLineEdit *m_clientServerMaxDeltaCounterEdit;
-    QLineEdit *m_clientServerMaxErrorStateInitEdit;
-    QLineEdit *m_clientServerMaxErrorStateInvalidEdit;
-    QLineEdit *m_clientServerMaxErrorStateValidEdit;
-    QLineEdit *m_clientServerMaxNoNewOrRepeatedDataEdit;
-    QLineEdit *m_clientServerMinOkStateInitEdit;
-    QLineEdit *m_clientServerMinOkStateInvalidEdit;
-    QLineEdit *m_clientServerMinOkStateValidEdit;
-    QLineEdit *m_clientServerSyncCounterInitEdit;
-    QLineEdit *m_clientServerWindowSizeEdit;
-    QLabel *m_clientServerNoPropertiesLabel;  // Label shown when no De element is selected
+    QListWidget *m_clientServerDeElementsList = nullptr;  // Left panel with data elements
+    QGroupBox *m_clientServerTransformationGroup = nullptr;
+    QComboBox *m_clientServerTransformationTypeCombo = nullptr;
+    QCheckBox *m_clientServerTransformationDisabledCheck = nullptr;
+    QLineEdit *m_clientServerMaxDeltaCounterEdit = nullptr;
+    QLineEdit *m_clientServerMaxErrorStateInitEdit = nullptr;
+    QLineEdit *m_clientServerMaxErrorStateInvalidEdit = nullptr;
+    QLineEdit *m_clientServerMaxErrorStateValidEdit = nullptr;
+    QLineEdit *m_clientServerMaxNoNewOrRepeatedDataEdit = nullptr;
+    QLineEdit *m_clientServerMinOkStateInitEdit = nullptr;
+    QLineEdit *m_clientServerMinOkStateInvalidEdit = nullptr;
+    QLineEdit *m_clientServerMinOkStateValidEdit = nullptr;
+    QLineEdit *m_clientServerSyncCounterInitEdit = nullptr;
+    QLineEdit *m_clientServerWindowSizeEdit = nullptr;
+    QLabel *m_clientServerNoPropertiesLabel = nullptr;  // Label shown when no De element is selected
     // Server ComSpec widgets (for P-PORT-PROTOTYPE with PROVIDED-INTERFACE-TREF DEST="SENDER-RECEIVER-INTERFACE")
-    QLineEdit *m_serverQueueLengthEdit;  // Queue Length field for server ports
+    QLineEdit *m_serverQueueLengthEdit = nullptr;  // Queue Length field for server ports
     // Interface Properties tab widgets
-    QLineEdit *m_interfacePropNameEdit;
-    QGroupBox *m_dataTypeGroup;
-    QLineEdit *m_dataTypeEdit;
-    QPushButton *m_dataTypeButton1;
-    QPushButton *m_dataTypeButton2;
-    QPushButton *m_dataTypeButton3;
-    QLineEdit *m_dataConstraintEdit;
-    QPushButton *m_dataConstraintButton;
-    QCheckBox *m_useQueuedCommCheck;
-    QGroupBox *m_measurementCalibrationGroup;
-    QComboBox *m_calibrationAccessCombo;
-    QGroupBox *m_handleInvalidGroup;
-    QButtonGroup *m_handleInvalidButtonGroup;
-    QRadioButton *m_handleInvalidKeepRadio;
-    QRadioButton *m_handleInvalidReplaceRadio;
-    QRadioButton *m_handleInvalidNoneRadio;
-    QLineEdit *m_initValueEdit;
-    QComboBox *m_initValueTypeCombo;
-    QPushButton *m_initValueEditButton;
-    QCheckBox *m_usesTxAcknowledgeCheck;
-    QLineEdit *m_timeoutEdit;
-    QComboBox *m_timeoutUnitCombo;
-    QCheckBox *m_usesEndToEndProtectionCheck;
+    QLineEdit *m_interfacePropNameEdit = nullptr;
+    QGroupBox *m_dataTypeGroup = nullptr;
+    QLineEdit *m_dataTypeEdit = nullptr;
+    QPushButton *m_dataTypeButton1 = nullptr;
+    QPushButton *m_dataTypeButton2 = nullptr;
+    QPushButton *m_dataTypeButton3 = nullptr;
+    QLineEdit *m_dataConstraintEdit = nullptr;
+    QPushButton *m_dataConstraintButton = nullptr;
+    QCheckBox *m_useQueuedCommCheck = nullptr;
+    QGroupBox *m_measurementCalibrationGroup = nullptr;
+    QComboBox *m_calibrationAccessCombo = nullptr;
+    QGroupBox *m_handleInvalidGroup = nullptr;
+    QButtonGroup *m_handleInvalidButtonGroup = nullptr;
+    QRadioButton *m_handleInvalidKeepRadio = nullptr;
+    QRadioButton *m_handleInvalidReplaceRadio = nullptr;
+    QRadioButton *m_handleInvalidNoneRadio = nullptr;
+    QLineEdit *m_initValueEdit = nullptr;
+    QComboBox *m_initValueTypeCombo = nullptr;
+    QPushButton *m_initValueEditButton = nullptr;
+    QCheckBox *m_usesTxAcknowledgeCheck = nullptr;
+    QLineEdit *m_timeoutEdit = nullptr;
+    QComboBox *m_timeoutUnitCombo = nullptr;
+    QCheckBox *m_usesEndToEndProtectionCheck = nullptr;
     
     QPushButton *m_openButton;
+    QPushButton *m_openSubsetButton;
     QPushButton *m_saveButton;
     QPushButton *m_saveAsButton;
     QPushButton *m_validateButton;
+    QPushButton *m_transformButton;
+    QPushButton *m_bulkComSpecButton;
+    QPushButton *m_undoButton;
+    QPushButton *m_redoButton;
     QLineEdit *m_searchBox;  // Search filter box
+    QProgressBar *m_loadProgressBar;  // Status bar progress while loading
+    QPushButton *m_cancelLoadButton;  // Status bar button to abort loading
 
     // State and helpers
     ArxmlModel *m_model;
     ArxmlValidator *m_validator;
+    ArxmlRuleEngine *m_ruleEngine;
+    QUndoStack *m_undoStack;  // Edits of m_model; cleared when another document is opened
+    std::unique_ptr<ArxmlBatchCommand> m_editBatch;  // Open edit batch, if any
+    EditCoalescer *m_editCoalescer;  // Batches keystrokes in the port form fields
+    std::unique_ptr<ArxmlPortIndex> m_portIndex;  // Ports of m_model, kept up to date on edits
+    PortViewCache m_portViewCache;  // PORTS tab contents of recently selected ports
+    QString m_pagedSearch;  // Search whose matches were paged in; no eviction until it changes
+    QString m_shownPortDescription;  // Text last put into the Description tab
+    PortView::ComSpecTabs m_shownComSpecTabs = PortView::ComSpecTabs::None;
+    ArxmlPortTableModel *m_portTableModel;
+    QDockWidget *m_portDock;  // Port overview: filters, table and row count
+    QTableView *m_portOverview;  // All ports of the document
+    QLabel *m_portCountLabel;
     QString m_currentFileName;
     QString m_schemaFileName;
+
+    // Model being filled by the background load; swapped into m_model when
+    // the load succeeds
+    ArxmlModel *m_loadingModel;
+    QString m_loadingFileName;
+    QFutureWatcher<bool> m_loadWatcher;
+    std::atomic<bool> m_loadCancelRequested{false};
+
+    // Background save: a snapshot of m_model is written while editing goes
+    // on. m_savingModel is the model the snapshot was taken from, reset when
+    // that model is replaced so the result is not applied to another one.
+    std::shared_ptr<ArxmlSaveJob> m_saveJob;
+    ArxmlModel *m_savingModel = nullptr;
+    QString m_savingFileName;
+    QFutureWatcher<bool> m_saveWatcher;
+
+    // Background checks of m_model. Once validation was asked for, the
+    // checks run again whenever edits pause (m_checkTimer); an edit during a
+    // run interrupts it. m_checkingModel is the model being checked, reset
+    // when that model is replaced.
+    QFutureWatcher<std::shared_ptr<CheckResult>> m_checkWatcher;
+    QTimer *m_checkTimer;
+    ArxmlModel *m_checkingModel = nullptr;
+    bool m_liveChecks = false;      // Validate was used on this document
+    bool m_checkPending = false;    // Run again once the current run ends
+    bool m_checkRequested = false;  // Report the next result in the log
+
+    // Background transform; the pipeline streams file to file and never
+    // touches m_model
+    std::shared_ptr<ArxmlPipeline> m_transformPipeline;
+    QString m_transformOutputFileName;
+    QString m_transformStages;  // Last stage list, offered again next time
+    QFutureWatcher<bool> m_transformWatcher;
+
+    // Progressive display while loading: completed top-level packages are
+    // queued by the loader thread and shown read-only in the tree until the
+    // whole document is in
+    struct LoadedPackage
+    {
+        std::shared_ptr<ArxmlElement> element;
+        QList<int> indexPath;
+        QStringList ancestorTags;
+    };
+    QMutex m_loadedPackagesMutex;
+    std::vector<LoadedPackage> m_loadedPackages;  // Guarded by m_loadedPackagesMutex
+    bool m_previewActive = false;
+    QTreeWidgetItem *m_previewContainerItem = nullptr;  // AR-PACKAGES item of the preview
+    QHash<QTreeWidgetItem*, std::shared_ptr<ArxmlElement>> m_previewPackages;
     
     // Mapping of data element names to their COM-SPEC elements (for Communication Spec tab)
     QMap<QString, std::shared_ptr<ArxmlElement>> m_dataElementToComSpec;
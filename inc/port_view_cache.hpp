@@ -0,0 +1,66 @@
+// port_view_cache.hpp
+//
+// What the PORTS tabs show for one port, extracted from the model, and an
+// LRU cache of it for recently selected ports. Entries are keyed by the
+// port element and hold its subtreeRevision, so any edit in the port's
+// subtree makes its entry stale. The cache must be cleared when pages are
+// evicted, since entries refer to COM-SPEC elements of the port.
+
+#ifndef PORT_VIEW_CACHE_HPP
+#define PORT_VIEW_CACHE_HPP
+
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class ArxmlElement;
+
+struct PortView
+{
+    // Sets of sub-tabs of the Communication Spec tab
+    enum class ComSpecTabs { None, Sender, Receiver, ClientServer, Server };
+
+    QString name;
+    QString interfaceName;
+    QString interfaceToolTip;
+    QString directionLabels[3];
+    int checkedDirection = -1;  // Direction radio button; -1 for none
+    QStringList dataElements;   // Of the sender/receiver COM-SPECs
+    std::vector<std::shared_ptr<ArxmlElement>> dataElementComSpecs;
+    QString description;
+    ComSpecTabs comSpecTabs = ComSpecTabs::None;
+};
+
+class PortViewCache
+{
+public:
+    explicit PortViewCache(int capacity);
+
+    // View of port at its current revision; nullptr if not cached
+    const PortView* find(const std::shared_ptr<ArxmlElement> &port);
+
+    // Remember view for port, dropping the least recently used entry if
+    // the cache is full
+    const PortView& insert(const std::shared_ptr<ArxmlElement> &port, PortView view);
+
+    void clear();
+
+private:
+    struct Entry
+    {
+        const ArxmlElement *key = nullptr;
+        std::weak_ptr<ArxmlElement> port;  // Detects a reused address
+        quint64 revision = 0;
+        PortView view;
+    };
+
+    int m_capacity;
+    std::list<Entry> m_entries;  // Most recently used first
+    std::unordered_map<const ArxmlElement*, std::list<Entry>::iterator> m_lookup;
+};
+
+#endif // PORT_VIEW_CACHE_HPP
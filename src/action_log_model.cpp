@@ -0,0 +1,178 @@
+// action_log_model.cpp
+//
+// Ring-buffer action log model
+
+#include "action_log_model.hpp"
+
+#include <QBrush>
+#include <QColor>
+#include <QDateTime>
+#include <QStringView>
+#include <iterator>
+
+namespace {
+
+// One display frame; queued entries wait at most this long
+constexpr int FlushIntervalMs = 16;
+
+QString severityName(ActionLogModel::Severity severity)
+{
+    switch (severity) {
+    case ActionLogModel::Severity::Warning:
+        return QStringLiteral("WARNING");
+    case ActionLogModel::Severity::Error:
+        return QStringLiteral("ERROR");
+    default:
+        return QStringLiteral("INFO");
+    }
+}
+
+} // namespace
+
+ActionLogModel::ActionLogModel(int capacity, QObject *parent)
+    : QAbstractListModel(parent),
+      m_capacity(qMax(1, capacity))
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FlushIntervalMs);
+    connect(&m_flushTimer, &QTimer::timeout, this, &ActionLogModel::flush);
+}
+
+ActionLogModel::~ActionLogModel()
+{
+    // Entries still queued belong in the file
+    if (m_logFile.isOpen()) {
+        writeEntries(m_pending);
+    }
+}
+
+void ActionLogModel::append(Severity severity, const QString &message)
+{
+    const qint64 time = QDateTime::currentMSecsSinceEpoch();
+    bool continuation = false;
+    for (QStringView line : QStringView(message).split(QLatin1Char('\n'))) {
+        m_pending.push_back(Entry{time, severity, continuation, line.toString()});
+        continuation = true;
+    }
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+void ActionLogModel::flush()
+{
+    m_flushTimer.stop();
+    if (m_pending.empty())
+        return;
+
+    std::vector<Entry> batch;
+    batch.swap(m_pending);
+    if (m_logFile.isOpen()) {
+        writeEntries(batch);
+    }
+
+    // Only the newest entries of a batch larger than the buffer are kept
+    const int batchSize = static_cast<int>(batch.size());
+    if (batchSize >= m_capacity) {
+        beginResetModel();
+        m_ring.assign(std::make_move_iterator(batch.end() - m_capacity), std::make_move_iterator(batch.end()));
+        m_first = 0;
+        m_count = m_capacity;
+        endResetModel();
+        return;
+    }
+
+    // The buffer grows up to its capacity before it wraps around, so
+    // m_first is 0 while it is still growing
+    if (m_count + batchSize > static_cast<int>(m_ring.size())) {
+        m_ring.resize(qMin(m_capacity, m_count + batchSize));
+    }
+    const int slots = static_cast<int>(m_ring.size());
+
+    const int dropped = qMax(0, m_count + batchSize - m_capacity);
+    if (dropped > 0) {
+        beginRemoveRows(QModelIndex(), 0, dropped - 1);
+        m_first = (m_first + dropped) % slots;
+        m_count -= dropped;
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), m_count, m_count + batchSize - 1);
+    for (Entry& entry : batch) {
+        m_ring[(m_first + m_count) % slots] = std::move(entry);
+        ++m_count;
+    }
+    endInsertRows();
+}
+
+bool ActionLogModel::exportTo(const QString &fileName)
+{
+    flush();
+    m_logFile.close();
+    m_logFile.setFileName(fileName);
+    if (!m_logFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        m_lastError = m_logFile.errorString();
+        return false;
+    }
+
+    for (int row = 0; row < rowCount(); ++row) {
+        writeEntry(entryAt(row));
+    }
+    m_logFile.flush();
+    return true;
+}
+
+int ActionLogModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_count;
+}
+
+QVariant ActionLogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount())
+        return QVariant();
+
+    const Entry& entry = entryAt(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        if (entry.continuation)
+            return QStringLiteral("           ") + entry.message;
+        return QStringLiteral("[%1] %2")
+            .arg(QDateTime::fromMSecsSinceEpoch(entry.time).toString(QStringLiteral("hh:mm:ss")), entry.message);
+    case Qt::ForegroundRole:
+        if (entry.severity == Severity::Error)
+            return QBrush(QColor(0xc0, 0x00, 0x00));
+        if (entry.severity == Severity::Warning)
+            return QBrush(QColor(0xa0, 0x60, 0x00));
+        return QVariant();
+    case SeverityRole:
+        return static_cast<int>(entry.severity);
+    default:
+        return QVariant();
+    }
+}
+
+const ActionLogModel::Entry& ActionLogModel::entryAt(int row) const
+{
+    return m_ring[(m_first + row) % m_ring.size()];
+}
+
+void ActionLogModel::writeEntries(const std::vector<Entry> &entries)
+{
+    for (const Entry& entry : entries) {
+        writeEntry(entry);
+    }
+    m_logFile.flush();
+}
+
+void ActionLogModel::writeEntry(const Entry &entry)
+{
+    QString line = QDateTime::fromMSecsSinceEpoch(entry.time).toString(QStringLiteral("yyyy-MM-dd hh:mm:ss.zzz"));
+    line += QStringLiteral(" %1 ").arg(severityName(entry.severity), -7);
+    if (entry.continuation) {
+        line += QStringLiteral("  ");
+    }
+    line += entry.message;
+    line += QLatin1Char('\n');
+    m_logFile.write(line.toUtf8());
+}
@@ -0,0 +1,501 @@
+// arxml_compression.cpp
+//
+// Streaming gzip / zstd codecs and the bounded decompression queue.
+
+#include "arxml_compression.hpp"
+
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+
+#ifdef ARXML_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef ARXML_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+// Compressed input is read in pieces of this size
+constexpr qint64 CompressedChunkSize = 256 * 1024;
+
+// Uncompressed chunks the decompression thread may run ahead of the parser
+constexpr size_t MaxQueuedChunks = 4;
+
+// Compressed output is collected in a buffer of this size before writing
+constexpr qsizetype OutputBufferSize = 256 * 1024;
+
+// Input handed to a codec in one call (zlib counts in 32 bits)
+constexpr qsizetype MaxCodecInput = 1 << 30;
+
+QString compressionName(ArxmlCompression compression)
+{
+    switch (compression) {
+    case ArxmlCompression::Gzip: return QStringLiteral("gzip");
+    case ArxmlCompression::Zstd: return QStringLiteral("zstd");
+    case ArxmlCompression::None: break;
+    }
+    return QString();
+}
+
+// The decoders below pull compressed input through readInput() (empty at
+// the end of the file) and hand uncompressed chunks of chunkSize to
+// pushOutput(), which returns false once nobody is reading any more. They
+// return an error message, or an empty string on success or cancellation.
+
+#ifdef ARXML_HAVE_ZLIB
+template <typename ReadInput, typename PushOutput>
+QString inflateGzip(ReadInput readInput, PushOutput pushOutput, qint64 chunkSize)
+{
+    z_stream stream = {};
+    // 32 added to the window bits accepts both gzip and zlib headers
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        return QStringLiteral("Cannot initialize gzip decompression");
+    }
+
+    QByteArray input;
+    QByteArray output(chunkSize, Qt::Uninitialized);
+    qsizetype produced = 0;
+    bool outputPending = false;  // inflate() may hold more output for this input
+    bool memberOpen = false;     // Inside a gzip member that has not ended yet
+    QString error;
+
+    while (true) {
+        if (stream.avail_in == 0 && !outputPending) {
+            input = readInput();
+            if (input.isEmpty()) {
+                break;
+            }
+            stream.next_in = reinterpret_cast<Bytef*>(input.data());
+            stream.avail_in = uInt(input.size());
+            memberOpen = true;
+        }
+
+        stream.next_out = reinterpret_cast<Bytef*>(output.data() + produced);
+        stream.avail_out = uInt(output.size() - produced);
+        const int status = inflate(&stream, Z_NO_FLUSH);
+        produced = output.size() - stream.avail_out;
+
+        if (status == Z_STREAM_END) {
+            // A gzip file may consist of several concatenated members
+            inflateReset(&stream);
+            memberOpen = stream.avail_in > 0;
+        } else if (status != Z_OK && status != Z_BUF_ERROR) {
+            error = QStringLiteral("Corrupt gzip data: %1")
+                        .arg(QString::fromLatin1(stream.msg ? stream.msg : "unknown error"));
+            break;
+        }
+
+        outputPending = produced == output.size();
+        if (outputPending) {
+            if (!pushOutput(std::move(output))) {
+                break;
+            }
+            output = QByteArray(chunkSize, Qt::Uninitialized);
+            produced = 0;
+        }
+    }
+
+    if (error.isEmpty() && memberOpen) {
+        error = QStringLiteral("Unexpected end of gzip data");
+    }
+    if (error.isEmpty() && produced > 0) {
+        output.truncate(produced);
+        pushOutput(std::move(output));
+    }
+    inflateEnd(&stream);
+    return error;
+}
+#endif
+
+#ifdef ARXML_HAVE_ZSTD
+template <typename ReadInput, typename PushOutput>
+QString decompressZstd(ReadInput readInput, PushOutput pushOutput, qint64 chunkSize)
+{
+    ZSTD_DStream *stream = ZSTD_createDStream();
+    if (!stream) {
+        return QStringLiteral("Cannot initialize zstd decompression");
+    }
+    ZSTD_initDStream(stream);
+
+    QByteArray input;
+    QByteArray output(chunkSize, Qt::Uninitialized);
+    ZSTD_inBuffer in = {nullptr, 0, 0};
+    ZSTD_outBuffer out = {output.data(), size_t(output.size()), 0};
+    bool outputPending = false;
+    size_t frameRemaining = 0;  // Non-zero while a frame is incomplete
+    QString error;
+
+    while (true) {
+        if (in.pos == in.size && !outputPending) {
+            input = readInput();
+            if (input.isEmpty()) {
+                break;
+            }
+            in = {input.constData(), size_t(input.size()), 0};
+        }
+
+        const size_t result = ZSTD_decompressStream(stream, &out, &in);
+        if (ZSTD_isError(result)) {
+            error = QStringLiteral("Corrupt zstd data: %1")
+                        .arg(QString::fromLatin1(ZSTD_getErrorName(result)));
+            break;
+        }
+        frameRemaining = result;
+
+        outputPending = out.pos == out.size;
+        if (outputPending) {
+            if (!pushOutput(std::move(output))) {
+                break;
+            }
+            output = QByteArray(chunkSize, Qt::Uninitialized);
+            out = {output.data(), size_t(output.size()), 0};
+        }
+    }
+
+    if (error.isEmpty() && frameRemaining != 0) {
+        error = QStringLiteral("Unexpected end of zstd data");
+    }
+    if (error.isEmpty() && out.pos > 0) {
+        output.truncate(qsizetype(out.pos));
+        pushOutput(std::move(output));
+    }
+    ZSTD_freeDStream(stream);
+    return error;
+}
+#endif
+
+} // namespace
+
+ArxmlCompression compressionForFile(const QString &fileName)
+{
+    if (fileName.endsWith(QLatin1String(".gz"), Qt::CaseInsensitive)) {
+        return ArxmlCompression::Gzip;
+    }
+    if (fileName.endsWith(QLatin1String(".zst"), Qt::CaseInsensitive)) {
+        return ArxmlCompression::Zstd;
+    }
+    return ArxmlCompression::None;
+}
+
+bool isCompressionSupported(ArxmlCompression compression)
+{
+    switch (compression) {
+    case ArxmlCompression::None:
+        return true;
+    case ArxmlCompression::Gzip:
+#ifdef ARXML_HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case ArxmlCompression::Zstd:
+#ifdef ARXML_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+ArxmlInputStream::ArxmlInputStream(const QString &fileName, qint64 chunkSize)
+    : m_file(fileName)
+    , m_chunkSize(chunkSize)
+    , m_compression(compressionForFile(fileName))
+{
+}
+
+ArxmlInputStream::~ArxmlInputStream()
+{
+    if (m_thread) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_cancelled = true;
+            m_notFull.wakeAll();
+        }
+        m_thread->wait();
+    }
+}
+
+bool ArxmlInputStream::open()
+{
+    if (!isCompressionSupported(m_compression)) {
+        m_error = QString("%1 compressed files are not supported by this build: %2")
+                      .arg(compressionName(m_compression), m_file.fileName());
+        return false;
+    }
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = QString("Cannot open file: %1").arg(m_file.fileName());
+        return false;
+    }
+    m_size = m_file.size();
+
+    if (m_compression != ArxmlCompression::None) {
+        m_thread.reset(QThread::create([this]() { decompress(); }));
+        m_thread->start();
+    }
+    return true;
+}
+
+QByteArray ArxmlInputStream::read()
+{
+    if (m_compression == ArxmlCompression::None) {
+        QByteArray chunk = m_file.read(m_chunkSize);
+        m_consumed.store(m_file.pos(), std::memory_order_relaxed);
+        return chunk;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    while (m_queue.empty() && !m_finished) {
+        m_notEmpty.wait(&m_mutex);
+    }
+    if (m_queue.empty()) {
+        return QByteArray();
+    }
+    QByteArray chunk = std::move(m_queue.front());
+    m_queue.pop_front();
+    m_notFull.wakeOne();
+    return chunk;
+}
+
+bool ArxmlInputStream::atEnd() const
+{
+    if (m_compression == ArxmlCompression::None) {
+        return m_file.atEnd();
+    }
+    QMutexLocker locker(&m_mutex);
+    return m_finished && m_queue.empty();
+}
+
+bool ArxmlInputStream::hasError() const
+{
+    QMutexLocker locker(&m_mutex);
+    return !m_error.isEmpty();
+}
+
+QString ArxmlInputStream::errorString() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_error;
+}
+
+void ArxmlInputStream::decompress()
+{
+    auto readInput = [this]() {
+        QByteArray input = m_file.read(CompressedChunkSize);
+        m_consumed.store(m_file.pos(), std::memory_order_relaxed);
+        return input;
+    };
+    auto pushOutput = [this](QByteArray chunk) {
+        return push(std::move(chunk));
+    };
+
+    QString error;
+    switch (m_compression) {
+    case ArxmlCompression::Gzip:
+#ifdef ARXML_HAVE_ZLIB
+        error = inflateGzip(readInput, pushOutput, m_chunkSize);
+#endif
+        break;
+    case ArxmlCompression::Zstd:
+#ifdef ARXML_HAVE_ZSTD
+        error = decompressZstd(readInput, pushOutput, m_chunkSize);
+#endif
+        break;
+    case ArxmlCompression::None:
+        break;
+    }
+    if (error.isEmpty() && m_file.error() != QFileDevice::NoError) {
+        error = QString("Cannot read file: %1").arg(m_file.fileName());
+    }
+    finish(error);
+}
+
+bool ArxmlInputStream::push(QByteArray chunk)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_queue.size() >= MaxQueuedChunks && !m_cancelled) {
+        m_notFull.wait(&m_mutex);
+    }
+    if (m_cancelled) {
+        return false;
+    }
+    m_queue.push_back(std::move(chunk));
+    m_notEmpty.wakeOne();
+    return true;
+}
+
+void ArxmlInputStream::finish(const QString &error)
+{
+    QMutexLocker locker(&m_mutex);
+    m_finished = true;
+    if (!error.isEmpty()) {
+        m_error = QString("%1 (%2)").arg(error, m_file.fileName());
+    }
+    m_notEmpty.wakeAll();
+}
+
+struct ArxmlOutputStream::Codec
+{
+#ifdef ARXML_HAVE_ZLIB
+    z_stream deflateStream = {};
+    bool deflateReady = false;
+#endif
+#ifdef ARXML_HAVE_ZSTD
+    ZSTD_CCtx *zstdContext = nullptr;
+#endif
+
+    ~Codec()
+    {
+#ifdef ARXML_HAVE_ZLIB
+        if (deflateReady) {
+            deflateEnd(&deflateStream);
+        }
+#endif
+#ifdef ARXML_HAVE_ZSTD
+        ZSTD_freeCCtx(zstdContext);
+#endif
+    }
+};
+
+ArxmlOutputStream::ArxmlOutputStream(const QString &fileName)
+    : m_file(fileName)
+    , m_compression(compressionForFile(fileName))
+{
+}
+
+ArxmlOutputStream::~ArxmlOutputStream() = default;
+
+bool ArxmlOutputStream::open()
+{
+    if (!isCompressionSupported(m_compression)) {
+        m_error = QString("%1 compressed files are not supported by this build: %2")
+                      .arg(compressionName(m_compression), m_file.fileName());
+        return false;
+    }
+    if (!m_file.open(QIODevice::WriteOnly)) {
+        m_error = QString("Cannot write file: %1").arg(m_file.fileName());
+        return false;
+    }
+    if (m_compression == ArxmlCompression::None) {
+        return true;
+    }
+
+    m_codec = std::make_unique<Codec>();
+    m_buffer.resize(OutputBufferSize);
+    bool ready = false;
+#ifdef ARXML_HAVE_ZLIB
+    if (m_compression == ArxmlCompression::Gzip) {
+        // 16 added to the window bits selects the gzip format
+        ready = deflateInit2(&m_codec->deflateStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                             15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+        m_codec->deflateReady = ready;
+    }
+#endif
+#ifdef ARXML_HAVE_ZSTD
+    if (m_compression == ArxmlCompression::Zstd) {
+        m_codec->zstdContext = ZSTD_createCCtx();
+        ready = m_codec->zstdContext &&
+                !ZSTD_isError(ZSTD_CCtx_setParameter(m_codec->zstdContext, ZSTD_c_compressionLevel,
+                                                     ZSTD_CLEVEL_DEFAULT));
+    }
+#endif
+    if (!ready) {
+        return fail(QString("Cannot initialize %1 compression").arg(compressionName(m_compression)));
+    }
+    return true;
+}
+
+bool ArxmlOutputStream::write(const QByteArray &data)
+{
+    if (m_compression == ArxmlCompression::None) {
+        if (m_file.write(data) != data.size()) {
+            return fail(QString("Cannot write file: %1").arg(m_file.fileName()));
+        }
+        return true;
+    }
+    return writeCompressed(data.constData(), data.size(), false);
+}
+
+bool ArxmlOutputStream::commit()
+{
+    if (m_compression != ArxmlCompression::None && !writeCompressed(nullptr, 0, true)) {
+        return false;
+    }
+    if (!m_file.commit()) {
+        m_error = QString("Cannot write file: %1").arg(m_file.fileName());
+        return false;
+    }
+    return true;
+}
+
+void ArxmlOutputStream::cancel()
+{
+    m_file.cancelWriting();
+}
+
+bool ArxmlOutputStream::writeCompressed(const char *data, qsizetype size, bool finish)
+{
+    auto flushBuffer = [this](qsizetype length) {
+        return length == 0 || m_file.write(m_buffer.constData(), length) == length;
+    };
+
+#ifdef ARXML_HAVE_ZLIB
+    if (m_compression == ArxmlCompression::Gzip) {
+        z_stream &stream = m_codec->deflateStream;
+        do {
+            const qsizetype piece = std::min(size, MaxCodecInput);
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+            stream.avail_in = uInt(piece);
+            data += piece;
+            size -= piece;
+            const int flush = finish && size == 0 ? Z_FINISH : Z_NO_FLUSH;
+            // Until deflate() leaves room in the buffer it may have more output
+            do {
+                stream.next_out = reinterpret_cast<Bytef*>(m_buffer.data());
+                stream.avail_out = uInt(m_buffer.size());
+                if (deflate(&stream, flush) == Z_STREAM_ERROR) {
+                    return fail(QString("gzip compression failed: %1").arg(m_file.fileName()));
+                }
+                if (!flushBuffer(m_buffer.size() - stream.avail_out)) {
+                    return fail(QString("Cannot write file: %1").arg(m_file.fileName()));
+                }
+            } while (stream.avail_out == 0);
+        } while (size > 0);
+        return true;
+    }
+#endif
+#ifdef ARXML_HAVE_ZSTD
+    if (m_compression == ArxmlCompression::Zstd) {
+        ZSTD_inBuffer in = {data, size_t(size), 0};
+        const ZSTD_EndDirective mode = finish ? ZSTD_e_end : ZSTD_e_continue;
+        bool done = false;
+        while (!done) {
+            ZSTD_outBuffer out = {m_buffer.data(), size_t(m_buffer.size()), 0};
+            const size_t remaining = ZSTD_compressStream2(m_codec->zstdContext, &out, &in, mode);
+            if (ZSTD_isError(remaining)) {
+                return fail(QString("zstd compression failed: %1").arg(m_file.fileName()));
+            }
+            if (!flushBuffer(qsizetype(out.pos))) {
+                return fail(QString("Cannot write file: %1").arg(m_file.fileName()));
+            }
+            done = finish ? remaining == 0 : in.pos == in.size;
+        }
+        return true;
+    }
+#endif
+    Q_UNUSED(data);
+    Q_UNUSED(size);
+    Q_UNUSED(finish);
+    Q_UNUSED(flushBuffer);
+    return fail(QString("%1 compression is not supported by this build").arg(compressionName(m_compression)));
+}
+
+bool ArxmlOutputStream::fail(const QString &error)
+{
+    m_error = error;
+    m_file.cancelWriting();
+    return false;
+}
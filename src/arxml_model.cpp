@@ -1,149 +1,2069 @@
 // arxml_model.cpp
 //
 // SAX-based ARXML parser implementation using QXmlStreamReader for efficient
-// parsing of large documents.
+// parsing of large documents. Saving serializes the top-level subtrees into
+// separate UTF-8 buffers in parallel (see ArxmlWriter) and writes them out
+// sequentially.
 
 #include "arxml_model.hpp"
+#include "arxml_compression.hpp"
 
 #include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
 #include <QXmlStreamReader>
-#include <QXmlStreamWriter>
 #include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <QtConcurrentMap>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <unordered_set>
+
+// Read-only mapping of an out-of-core document's source file. Shared by a
+// model, its save jobs and detached subtrees, so the file stays mapped while
+// any of them may read stubs from it (also after it was replaced on disk by
+// a save).
+class ArxmlSourceMap
+{
+public:
+    static std::shared_ptr<const ArxmlSourceMap> open(const QString &fileName)
+    {
+        std::shared_ptr<ArxmlSourceMap> map(new ArxmlSourceMap(fileName));
+        if (!map->m_file.open(QIODevice::ReadOnly) || map->m_file.size() == 0) {
+            return nullptr;
+        }
+        map->m_size = map->m_file.size();
+        map->m_data = map->m_file.map(0, map->m_size);
+        if (!map->m_data) {
+            return nullptr;
+        }
+        QMutexLocker locker(&registryMutex());
+        registry().push_back(map.get());
+        return map;
+    }
+
+    ~ArxmlSourceMap()
+    {
+        if (m_data) {
+            m_file.unmap(m_data);
+            QMutexLocker locker(&registryMutex());
+            std::vector<const ArxmlSourceMap*> &maps = registry();
+            maps.erase(std::find(maps.begin(), maps.end(), this));
+        }
+    }
+
+    const char *data() const { return reinterpret_cast<const char*>(m_data); }
+    qint64 size() const { return m_size; }
+
+    // Whether fileName is mapped by any map still alive. Windows cannot
+    // replace a mapped file.
+    static bool isMapped(const QString &fileName)
+    {
+        const QFileInfo info(fileName);
+        QMutexLocker locker(&registryMutex());
+        for (const ArxmlSourceMap *map : registry()) {
+            if (QFileInfo(map->m_file.fileName()) == info) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    explicit ArxmlSourceMap(const QString &fileName)
+        : m_file(fileName)
+    {
+    }
+
+    static QMutex &registryMutex()
+    {
+        static QMutex mutex;
+        return mutex;
+    }
+
+    static std::vector<const ArxmlSourceMap*> &registry()
+    {
+        static std::vector<const ArxmlSourceMap*> maps;
+        return maps;
+    }
+
+    QFile m_file;
+    uchar *m_data = nullptr;
+    qint64 m_size = 0;
+};
+
+namespace {
+
+// Bytes handed to the XML reader per step while loading
+constexpr qint64 LoadChunkSize = 1024 * 1024;
+
+// Out-of-core: estimated memory of a paged-in subtree per source byte
+// (UTF-16 strings plus element and allocation overhead)
+constexpr qint64 PageCostFactor = 4;
+
+// Full saves hand output to the file in pieces of this size
+constexpr qsizetype StreamFlushSize = 1024 * 1024;
+
+// Pieces a subtree serialized ahead of the file position may have queued
+constexpr size_t SegmentPipeChunks = 4;
+
+// Elements a snapshot reader looks at before it lets edits in
+constexpr int SnapshotReadsPerLock = 256;
+
+// Translates the reader's character offsets (UTF-16 units) into byte offsets
+// of the UTF-8 input. Offsets are only ever asked for in increasing order, so
+// only the input after the last translated position has to be kept.
+class Utf8OffsetMap
+{
+public:
+    void append(const QByteArray &chunk)
+    {
+        if (!m_started) {
+            m_started = true;
+            // Other encodings announce themselves with a byte order mark;
+            // the reader strips a UTF-8 one, so it takes no character offset
+            if (chunk.startsWith("\xFE\xFF") || chunk.startsWith("\xFF\xFE")) {
+                m_utf8 = false;
+            } else if (chunk.startsWith("\xEF\xBB\xBF")) {
+                m_data = chunk.mid(3);
+                m_dataStart = m_cursorByte = 3;
+                return;
+            }
+        }
+        m_data += chunk;
+    }
+
+    bool isUtf8() const { return m_utf8; }
+
+    qint64 toByteOffset(qint64 charOffset)
+    {
+        while (m_cursorChar < charOffset) {
+            const qsizetype index = m_cursorByte - m_dataStart;
+            if (index >= m_data.size()) {
+                break;
+            }
+            const uchar lead = static_cast<uchar>(m_data[index]);
+            const int length = lead < 0xC0 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+            m_cursorByte += length;
+            m_cursorChar += length == 4 ? 2 : 1;  // Outside the BMP: surrogate pair
+        }
+        return m_cursorByte;
+    }
+
+    // Byte at offset, or 0 if it is no longer (or not yet) available
+    char byteAt(qint64 offset) const
+    {
+        const qint64 index = offset - m_dataStart;
+        return index >= 0 && index < m_data.size() ? m_data[index] : '\0';
+    }
+
+    // Offset of the last '<' in [from, to), or -1
+    qint64 lastTagOpen(qint64 from, qint64 to) const
+    {
+        for (qint64 offset = to - 1; offset >= from && offset >= m_dataStart; --offset) {
+            if (byteAt(offset) == '<') {
+                return offset;
+            }
+        }
+        return -1;
+    }
+
+    // Retained input in [from, to), clamped to what is still available
+    QByteArray bytes(qint64 from, qint64 to) const
+    {
+        const qint64 begin = std::max(from - m_dataStart, qint64(0));
+        const qint64 end = std::min(to - m_dataStart, qint64(m_data.size()));
+        return begin < end ? m_data.mid(begin, end - begin) : QByteArray();
+    }
+
+    qint64 dataStart() const { return m_dataStart; }
+    qint64 dataEnd() const { return m_dataStart + m_data.size(); }
+
+    // Input before offset is not needed any more
+    void discardBefore(qint64 offset)
+    {
+        const qint64 unused = offset - m_dataStart;
+        if (unused > LoadChunkSize) {
+            m_data.remove(0, unused);
+            m_dataStart = offset;
+        }
+    }
+
+private:
+    QByteArray m_data;
+    qint64 m_dataStart = 0;
+    qint64 m_cursorByte = 0;
+    qint64 m_cursorChar = 0;
+    bool m_started = false;
+    bool m_utf8 = true;
+};
+
+// Fingerprint of an element's attributes, to tell at save time whether the
+// source start tag still matches
+quint32 attributesHash(const ArxmlElement &elem)
+{
+    return quint32(qHashRange(elem.attributes.begin(), elem.attributes.end()));
+}
+
+bool isBlank(QStringView text)
+{
+    for (QChar c : text) {
+        if (!c.isSpace()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Turn a clean element with a known span into an out-of-core stub
+void makeStub(ArxmlElement &elem)
+{
+    for (const auto& child : elem.children) {
+        if (child->tagName == QLatin1String("SHORT-NAME")) {
+            elem.stubShortName = child->text.trimmed();
+            break;
+        }
+    }
+    elem.children = std::vector<std::shared_ptr<ArxmlElement>>();
+    elem.markup = std::vector<ArxmlMarkup>();
+    elem.text = QString();
+    elem.stub = true;
+}
+
+// Builds elements from reader tokens below a document node and records their
+// byte spans in the UTF-8 input (see ArxmlElement::sourceBegin). Input is a
+// whole file, or the span of one stub; base is added to the recorded offsets.
+class TreeBuilder
+{
+public:
+    TreeBuilder(const std::shared_ptr<ArxmlElement> &document, qint64 base, bool outOfCore)
+        : m_base(base)
+        , m_outOfCore(outOfCore)
+    {
+        stack.push_back(document);
+        indexStack.push_back(0);
+        cursorStack.push_back(0);
+    }
+
+    void addInput(const QByteArray &chunk)
+    {
+        if (recordSpans) {
+            offsets.append(chunk);
+            recordSpans = offsets.isUtf8();
+        }
+    }
+
+    // Restrict the tree to a projection (see ArxmlLoadOptions::packagePaths)
+    void setProjection(const QStringList &packagePaths, const QStringList &elementTags)
+    {
+        m_packagePaths.clear();
+        for (const QString& path : packagePaths) {
+            QString normalized = path.trimmed();
+            while (normalized.endsWith(QLatin1Char('/'))) {
+                normalized.chop(1);
+            }
+            if (!normalized.startsWith(QLatin1Char('/'))) {
+                normalized.prepend(QLatin1Char('/'));
+            }
+            m_packagePaths.append(normalized);
+        }
+        m_elementTags = elementTags;
+        m_projected = !m_packagePaths.isEmpty() || !m_elementTags.isEmpty();
+    }
+
+    void startElement(const QXmlStreamReader &reader)
+    {
+        if (m_skipDepth > 0) {
+            // Inside a skipped subtree nothing is built; only the stub's
+            // SHORT-NAME is picked up
+            ++m_skipDepth;
+            m_skipShortName = m_skipDepth == 2 && reader.qualifiedName() == QLatin1String("SHORT-NAME");
+            return;
+        }
+
+        auto newElement = std::make_shared<ArxmlElement>();
+        newElement->tagName = reader.qualifiedName().toString();
+        newElement->parent = stack.back().get();
+
+        // Read attributes
+        const QXmlStreamAttributes attrs = reader.attributes();
+        for (const auto& attr : attrs) {
+            newElement->attributes.push_back({
+                attr.qualifiedName().toString(),
+                attr.value().toString()
+            });
+        }
+
+        qint64 startTagEnd = 0;
+        if (recordSpans) {
+            // The tag's '<' is the last one since the previous markup;
+            // attribute values cannot contain a literal '<'
+            startTagEnd = offsets.toByteOffset(reader.characterOffset());
+            const qint64 begin = offsets.lastTagOpen(cursorStack.back(), startTagEnd);
+            if (begin >= 0 && offsets.byteAt(startTagEnd - 1) == '>' &&
+                fitsSpanField(begin - cursorStack.back()) && fitsSpanField(startTagEnd - begin)) {
+                newElement->sourceBegin = m_base + begin;
+                newElement->sourceLead = quint32(begin - cursorStack.back());
+                newElement->sourceStartTag = quint32(startTagEnd - begin);
+                newElement->sourceAttributesHash = attributesHash(*newElement);
+                if (stack.size() == 1) {
+                    prolog = offsets.bytes(offsets.dataStart(), begin);
+                }
+                offsets.discardBefore(startTagEnd);
+            } else {
+                recordSpans = false;
+            }
+        }
+
+        indexStack.push_back(static_cast<int>(stack.back()->children.size()));
+        cursorStack.push_back(startTagEnd);
+        stack.back()->children.push_back(newElement);
+        stack.push_back(newElement);
+
+        if (m_projected) {
+            if (newElement->tagName == QLatin1String("AR-PACKAGE")) {
+                m_packageNames.append(QString());  // Named by its SHORT-NAME
+            } else if (stack[stack.size() - 2]->tagName == QLatin1String("ELEMENTS") &&
+                       !(packageSelected(currentPackagePath()) &&
+                         (m_elementTags.isEmpty() || m_elementTags.contains(newElement->tagName)))) {
+                m_skipDepth = 1;
+            }
+        }
+    }
+
+    // Returns the completed element, or nullptr inside a skipped subtree
+    std::shared_ptr<ArxmlElement> endElement(const QXmlStreamReader &reader)
+    {
+        if (m_skipDepth > 1) {
+            --m_skipDepth;
+            m_skipShortName = false;
+            if (recordSpans) {
+                offsets.discardBefore(offsets.toByteOffset(reader.characterOffset()));
+            }
+            return nullptr;
+        }
+        if (stack.size() <= 1) {
+            return nullptr;
+        }
+
+        const std::shared_ptr<ArxmlElement> finished = stack.back();
+        ArxmlElement *elem = finished.get();
+        const bool skipped = m_skipDepth == 1;
+        m_skipDepth = 0;
+        // Whitespace between child elements is formatting, not text
+        if (isBlank(elem->text)) {
+            elem->text.clear();
+        }
+        qint64 end = 0;
+        if (recordSpans) {
+            end = offsets.toByteOffset(reader.characterOffset());
+            if (offsets.byteAt(end - 1) == '>' && fitsSpanField(end - cursorStack.back())) {
+                elem->sourceEnd = m_base + end;
+                elem->sourceTail = quint32(end - cursorStack.back());
+                offsets.discardBefore(end);
+            } else {
+                recordSpans = false;
+            }
+        }
+
+        // Out-of-core: the identifiables of a package only stay as stubs
+        if (skipped || (m_outOfCore && recordSpans && stack.size() > 2 &&
+                        stack[stack.size() - 2]->tagName == QLatin1String("ELEMENTS"))) {
+            makeStub(*elem);
+            elem->stubShortName = elem->stubShortName.trimmed();
+        }
+
+        stack.pop_back();
+        indexStack.pop_back();
+        cursorStack.pop_back();
+        // The parent's next child (or its tail) starts after this one
+        cursorStack.back() = end;
+
+        if (m_projected) {
+            if (elem->tagName == QLatin1String("AR-PACKAGE")) {
+                m_packageNames.removeLast();
+            } else if (elem->tagName == QLatin1String("SHORT-NAME") &&
+                       stack.back()->tagName == QLatin1String("AR-PACKAGE") &&
+                       m_packageNames.last().isEmpty()) {
+                // The package's path is known now; packages neither in nor
+                // above the projection are skipped from here on
+                m_packageNames.last() = elem->text.trimmed();
+                const QString path = currentPackagePath();
+                if (!packageSelected(path) && !packageAboveSelection(path)) {
+                    m_skipDepth = 1;
+                }
+            }
+        }
+        return finished;
+    }
+
+    void characters(const QXmlStreamReader &reader)
+    {
+        if (m_skipDepth > 0) {
+            if (m_skipShortName) {
+                stack.back()->stubShortName += reader.text();
+            }
+            return;
+        }
+        // Text may arrive in several pieces (entity references, CDATA
+        // sections); only whitespace can appear outside the root
+        if (stack.size() > 1) {
+            stack.back()->text += reader.text();
+            stack.back()->cdata |= reader.isCDATA();
+        }
+    }
+
+    // Comments and processing instructions; outside the document element
+    // they are part of the prolog or epilog
+    void markup(const QXmlStreamReader &reader)
+    {
+        if (m_skipDepth > 0 || stack.size() <= 1) {
+            return;
+        }
+        ArxmlElement &parent = *stack.back();
+        ArxmlMarkup token;
+        token.before = parent.children.size();
+        if (reader.isComment()) {
+            token.text = reader.text().toString();
+        } else {
+            token.kind = ArxmlMarkup::Kind::ProcessingInstruction;
+            token.text = reader.processingInstructionTarget().toString();
+            token.data = reader.processingInstructionData().toString();
+        }
+        parent.markup.push_back(std::move(token));
+    }
+
+    std::vector<std::shared_ptr<ArxmlElement>> stack;
+    // Index of each stack entry within its parent (unused for the document node)
+    std::vector<int> indexStack;
+    // Per open element, where its content after the last child starts
+    std::vector<qint64> cursorStack;
+    Utf8OffsetMap offsets;
+    bool recordSpans = true;
+    QByteArray prolog;  // Input before the document element
+
+private:
+    static bool fitsSpanField(qint64 length)
+    {
+        return length >= 0 && length <= qint64(std::numeric_limits<quint32>::max());
+    }
+
+    QString currentPackagePath() const
+    {
+        return QLatin1Char('/') + m_packageNames.join(QLatin1Char('/'));
+    }
+
+    bool packageSelected(const QString &path) const
+    {
+        if (m_packagePaths.isEmpty()) {
+            return true;
+        }
+        for (const QString& selected : m_packagePaths) {
+            if (path == selected || path.startsWith(selected + QLatin1Char('/'))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool packageAboveSelection(const QString &path) const
+    {
+        for (const QString& selected : m_packagePaths) {
+            if (selected.startsWith(path + QLatin1Char('/'))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const qint64 m_base;
+    const bool m_outOfCore;
+
+    bool m_projected = false;
+    QStringList m_packagePaths;
+    QStringList m_elementTags;
+    QStringList m_packageNames;  // SHORT-NAMEs of the open AR-PACKAGEs
+    // Nesting depth inside the subtree being skipped (0: building)
+    int m_skipDepth = 0;
+    bool m_skipShortName = false;
+};
+
+// Whether fileName can be replaced by a save. Windows refuses to replace a
+// file that is mapped, which the source of an out-of-core document (or of a
+// subtree taken out of one) stays until it is closed.
+bool replaceable(const QString &fileName)
+{
+#ifdef Q_OS_WIN
+    return !ArxmlSourceMap::isMapped(fileName);
+#else
+    Q_UNUSED(fileName);
+    return true;
+#endif
+}
+
+// Sum of the sourceShift of elem's ancestors: added to elem's stored offsets
+// it gives the position of its span in the file
+qint64 inheritedShift(const ArxmlElement *elem)
+{
+    qint64 shift = 0;
+    for (const ArxmlElement *ancestor = elem->parent; ancestor; ancestor = ancestor->parent) {
+        shift += ancestor->sourceShift;
+    }
+    return shift;
+}
+
+// Move the spans of elem and its subtree by delta
+void shiftSpans(ArxmlElement &elem, qint64 delta)
+{
+    elem.sourceBegin += delta;
+    elem.sourceEnd += delta;
+    elem.sourceShift += delta;
+}
+
+// Read the content of a stub from the source span it was loaded from. With
+// keepStubs nested identifiables become stubs again (paging); otherwise the
+// whole subtree is built.
+bool parseStub(ArxmlElement &elem, const ArxmlSourceMap &source, bool keepStubs)
+{
+    const qint64 shift = inheritedShift(&elem);
+    const qint64 begin = elem.sourceBegin + shift;
+    const qint64 end = elem.sourceEnd + shift;
+    if (!elem.hasSource() || begin < 0 || end > source.size()) {
+        return false;
+    }
+
+    // Parse the span on its own; the builder offsets the new spans by its
+    // position in the file, less the shifts that apply to elem's children
+    const QByteArray fragment = QByteArray::fromRawData(source.data() + begin, end - begin);
+    auto document = std::make_shared<ArxmlElement>();
+    TreeBuilder builder(document, begin - shift - elem.sourceShift, keepStubs);
+    builder.addInput(fragment);
+    QXmlStreamReader reader(fragment);
+    reader.setNamespaceProcessing(false);
+    while (!reader.atEnd()) {
+        switch (reader.readNext()) {
+        case QXmlStreamReader::StartElement:
+            builder.startElement(reader);
+            break;
+        case QXmlStreamReader::EndElement:
+            builder.endElement(reader);
+            break;
+        case QXmlStreamReader::Characters:
+            builder.characters(reader);
+            break;
+        case QXmlStreamReader::Comment:
+        case QXmlStreamReader::ProcessingInstruction:
+            builder.markup(reader);
+            break;
+        default:
+            break;
+        }
+    }
+    if (reader.hasError() || !builder.recordSpans || document->children.size() != 1) {
+        return false;
+    }
+
+    ArxmlElement &loaded = *document->children.front();
+    elem.children = std::move(loaded.children);
+    for (const auto& child : elem.children) {
+        child->parent = &elem;
+    }
+    elem.text = loaded.text;
+    elem.cdata = loaded.cdata;
+    elem.markup = std::move(loaded.markup);
+    elem.stub = false;
+    elem.stubShortName.clear();
+    return true;
+}
+
+// Writes a snapshot as the source file with the dirty subtrees spliced in.
+// Span changes are collected and only applied once the file is committed
+// (ArxmlModel::finishSave()). Elements are read through the snapshot, and
+// the reader is paused before every write so edits are not held up by the
+// output.
+class IncrementalSaver
+{
+public:
+    using SpanUpdate = ArxmlSaveJob::SpanUpdate;
+
+    IncrementalSaver(const char *source, qint64 sourceSize, QIODevice &out, quint64 baseline,
+                     ArxmlSnapshotReader &reader, std::vector<SpanUpdate> &updates)
+        : m_source(source), m_sourceSize(sourceSize), m_out(out), m_baseline(baseline),
+          m_reader(reader), m_updates(updates)
+    {
+    }
+
+    bool run(const ArxmlElement &root)
+    {
+        // Prolog and epilog (declaration, comments, trailing whitespace) are
+        // not part of the model and always come from the source
+        const ArxmlElement &elem = m_reader.get(root);
+        if (!elem.hasSource()) {
+            return false;
+        }
+        const qint64 begin = elem.sourceBegin;
+        const qint64 end = elem.sourceEnd;
+        m_reader.pause();
+        return copy(0, begin) && writeElement(root, 0, 0) && copy(end, m_sourceSize);
+    }
+
+    // True if run() failed because the output could not be written (as
+    // opposed to spans that do not match the source)
+    bool outputFailed() const { return m_outputFailed; }
+
+private:
+    bool write(const char *data, qint64 size)
+    {
+        if (m_out.write(data, size) != size) {
+            m_outputFailed = true;
+            return false;
+        }
+        m_outPos += size;
+        return true;
+    }
+
+    bool write(const QByteArray &data)
+    {
+        return write(data.constData(), data.size());
+    }
+
+    bool copy(qint64 begin, qint64 end)
+    {
+        return begin >= 0 && begin <= end && end <= m_sourceSize &&
+               write(m_source + begin, end - begin);
+    }
+
+    // A clean span must still frame a tag in the source, otherwise the spans
+    // do not belong to this file and nothing may be copied
+    bool spanLooksValid(const ArxmlElement &elem, qint64 begin, qint64 end) const
+    {
+        return elem.hasSource() && begin >= 0 && end <= m_sourceSize &&
+               end - begin >= elem.sourceStartTag && end - begin >= elem.sourceTail &&
+               m_source[begin] == '<' && m_source[end - 1] == '>';
+    }
+
+    // Re-serialize elem and its subtree. The indentation of the first line
+    // is only written when the source has none in front of the element.
+    bool writeFresh(const ArxmlElement &elem, int depth, bool indentFirstLine)
+    {
+        ArxmlWriter writer(ArxmlWriter::Format::Pretty);
+        writer.setSnapshot(&m_reader);
+        writer.writeElement(elem, depth);
+        m_reader.pause();
+        const QByteArray data = writer.takeData();
+        const qint64 skip = indentFirstLine ? 0 : qint64(depth) * 2;
+        // The line break after the element belongs to the following content
+        m_updates.push_back({const_cast<ArxmlElement*>(&elem), SpanUpdate::Clear, 0, 0, 0, 0, 0, 0});
+        return write(data.constData() + skip, data.size() - skip - 1);
+    }
+
+    // inherited is the sum of the sourceShift of elem's ancestors
+    bool writeElement(const ArxmlElement &live, int depth, qint64 inherited)
+    {
+        ArxmlElement *target = const_cast<ArxmlElement*>(&live);
+
+        // Everything needed from the element is taken out before the reader
+        // is paused
+        const ArxmlElement &elem = m_reader.get(live);
+        const qint64 begin = elem.sourceBegin + inherited;
+        const qint64 end = elem.sourceEnd + inherited;
+        const quint32 lead = elem.sourceLead;  // Copied along by the parent
+        if (!spanLooksValid(elem, begin, end)) {
+            return false;
+        }
+
+        if (elem.subtreeRevision <= m_baseline) {
+            m_reader.pause();
+            const qint64 delta = m_outPos - begin;
+            if (delta != 0) {
+                m_updates.push_back({target, SpanUpdate::Shift, delta, 0, 0, 0, 0, lead});
+            }
+            return copy(begin, end);
+        }
+
+        // A self-closing tag has no place for content; write it again
+        const bool selfClosing = end - begin == elem.sourceStartTag;
+        if (selfClosing) {
+            m_reader.pause();
+            return writeFresh(live, depth, false);
+        }
+
+        // The start tag is kept as written unless the attributes changed
+        QByteArray startTag;
+        quint32 startTagHash = elem.sourceAttributesHash;
+        if (elem.revision > m_baseline && attributesHash(elem) != elem.sourceAttributesHash) {
+            ArxmlWriter writer(ArxmlWriter::Format::Compact);
+            writer.writeStartTag(elem);
+            startTag = writer.takeData();
+            startTagHash = attributesHash(elem);
+        }
+        const quint32 sourceStartTag = elem.sourceStartTag;
+        const quint32 sourceTail = elem.sourceTail;
+        const qint64 childShift = inherited + elem.sourceShift;
+
+        QByteArray content;
+        std::vector<const ArxmlElement*> children;
+        if (elem.children.empty()) {
+            // Text edit (or all children removed): new content and end tag
+            ArxmlWriter writer(ArxmlWriter::Format::Compact);
+            writer.writeText(elem.text, elem.cdata);
+            writer.writeMarkup(elem.markup, 0, 0);
+            writer.writeEndTag(elem);
+            content = writer.takeData();
+        } else {
+            children.reserve(elem.children.size());
+            for (const auto& child : elem.children) {
+                children.push_back(child.get());
+            }
+        }
+        m_reader.pause();
+
+        const qint64 newBegin = m_outPos;
+        if (!(startTag.isEmpty() ? copy(begin, begin + sourceStartTag) : write(startTag))) {
+            return false;
+        }
+        const quint32 startTagLength = quint32(m_outPos - newBegin);
+
+        if (children.empty()) {
+            if (!write(content)) {
+                return false;
+            }
+            m_updates.push_back({target, SpanUpdate::Rewrite, newBegin - inherited, m_outPos - inherited,
+                                 startTagLength, quint32(content.size()), startTagHash, lead});
+            return true;
+        }
+
+        for (const ArxmlElement *child : children) {
+            const ArxmlElement &childElem = m_reader.get(*child);
+            const bool hasSource = childElem.hasSource();
+            const qint64 childBegin = childElem.sourceBegin + childShift;
+            const quint32 childLead = childElem.sourceLead;
+            m_reader.pause();
+
+            bool ok;
+            if (hasSource) {
+                ok = copy(childBegin - childLead, childBegin) && writeElement(*child, depth + 1, childShift);
+            } else {
+                ok = write("\n", 1) && writeFresh(*child, depth + 1, true);
+            }
+            if (!ok) {
+                return false;
+            }
+        }
+
+        // Whitespace, comments and the end tag after the last child
+        if (!copy(end - sourceTail, end)) {
+            return false;
+        }
+        m_updates.push_back({target, SpanUpdate::Rewrite, newBegin - inherited, m_outPos - inherited,
+                             startTagLength, sourceTail, startTagHash, lead});
+        return true;
+    }
+
+    const char *m_source;
+    qint64 m_sourceSize;
+    QIODevice &m_out;
+    quint64 m_baseline;
+    ArxmlSnapshotReader &m_reader;
+    std::vector<SpanUpdate> &m_updates;
+    qint64 m_outPos = 0;
+    bool m_outputFailed = false;
+};
+
+// One piece of a saved document: either fixed skeleton bytes (elem is null)
+// or a subtree that is serialized on the thread pool into data
+struct SaveSegment
+{
+    const ArxmlElement *elem = nullptr;
+    int depth = 0;
+    qint64 shift = 0;  // sourceShift of elem's ancestors, for its stubs
+    QByteArray data;
+    qint64 at = 0;      // Skeleton position the subtree is written at
+    quint32 lead = 0;   // Bytes of markup the skeleton wrote in front of it
+    qint64 size = 0;    // Bytes the subtree took
+    std::vector<ArxmlWriter::Span> spans;
+};
+
+// The document element and AR-PACKAGES are written in place; every other
+// child of them (the top-level packages, ADMIN-DATA, ...) is an independent
+// segment serialized in parallel
+bool isSplitElement(const ArxmlElement &elem, int depth)
+{
+    return !elem.children.empty() &&
+           (depth == 0 || (depth == 1 && elem.tagName == QLatin1String("AR-PACKAGES")));
+}
+
+// Bounded queue of output pieces between the thread serializing one segment
+// and the thread writing the segments out in document order
+class SegmentPipe
+{
+public:
+    // Blocks while the pipe is full. Once the reader gave up, pieces are
+    // dropped and false is returned.
+    bool push(QByteArray data)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_chunks.size() >= SegmentPipeChunks && !m_aborted) {
+            m_changed.wait(&m_mutex);
+        }
+        if (m_aborted) {
+            return false;
+        }
+        m_chunks.push_back(std::move(data));
+        m_changed.wakeAll();
+        return true;
+    }
+
+    // The segment is complete
+    void finish()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_finished = true;
+        m_changed.wakeAll();
+    }
+
+    // Blocks until a piece is available; false once the segment is complete
+    bool pop(QByteArray &data)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_chunks.empty() && !m_finished) {
+            m_changed.wait(&m_mutex);
+        }
+        if (m_chunks.empty()) {
+            return false;
+        }
+        data = std::move(m_chunks.front());
+        m_chunks.pop_front();
+        m_changed.wakeAll();
+        return true;
+    }
+
+    void abort()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_aborted = true;
+        m_chunks.clear();
+        m_changed.wakeAll();
+    }
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_changed;
+    std::deque<QByteArray> m_chunks;
+    bool m_finished = false;
+    bool m_aborted = false;
+};
+
+// reader is null unless a snapshot is saved
+void planSegments(std::vector<SaveSegment> &segments, ArxmlWriter &skeleton, ArxmlSnapshotReader *reader,
+                  const ArxmlElement &live, int depth, qint64 shift)
+{
+    auto view = [reader](const ArxmlElement &elem) -> const ArxmlElement & {
+        return reader ? reader->get(elem) : elem;
+    };
+
+    skeleton.setSourceShift(shift);
+    skeleton.writeStartTag(live, depth);
+    const ArxmlElement &elem = view(live);
+    const qint64 childShift = shift + elem.sourceShift;
+    std::vector<const ArxmlElement*> children;
+    for (const auto& child : elem.children) {
+        children.push_back(child.get());
+    }
+    for (size_t i = 0; i < children.size(); ++i) {
+        const ArxmlElement *child = children[i];
+        const qint64 markupBegin = skeleton.position();
+        skeleton.writeMarkup(view(live).markup, i, depth + 1);
+        if (isSplitElement(view(*child), depth + 1)) {
+            planSegments(segments, skeleton, reader, *child, depth + 1, childShift);
+            continue;
+        }
+        const quint32 lead = quint32(skeleton.position() - markupBegin);
+        if (skeleton.size() > 0) {
+            segments.push_back({nullptr, 0, 0, skeleton.takeData()});
+        }
+        segments.push_back({child, depth + 1, childShift, QByteArray(), skeleton.position(), lead});
+    }
+    skeleton.writeMarkup(view(live).markup, children.size(), depth + 1);
+    skeleton.writeEndTag(live, depth);
+}
+
+// Hand a document to sink as UTF-8 pieces in order; independent subtrees
+// are serialized concurrently, a bounded amount ahead of sink. A background
+// save reads the tree through its snapshot. With spans, where each element
+// ended up in the output is added to it. Stops and returns false when sink
+// does.
+bool streamDocument(const ArxmlElement *root, const QByteArray &prolog, const QByteArray &epilog,
+                    const ArxmlSourceMap *sourceMap, ArxmlSnapshot *snapshot, ArxmlWriter::Format format,
+                    const std::function<bool(const QByteArray &data)> &sink,
+                    std::vector<ArxmlWriter::Span> *spans = nullptr)
+{
+    // Split the document into skeleton bytes and independent subtrees
+    std::vector<SaveSegment> segments;
+    std::vector<ArxmlWriter::Span> skeletonSpans;
+    const char *source = sourceMap ? sourceMap->data() : nullptr;
+    const qint64 sourceSize = sourceMap ? sourceMap->size() : 0;
+    ArxmlWriter skeleton(format);
+    skeleton.setSource(source, sourceSize);
+    if (prolog.isEmpty()) {
+        skeleton.writeDeclaration();
+    } else {
+        skeleton.writeRaw(prolog);
+    }
+    if (spans) {
+        skeleton.setSpans(&skeletonSpans);
+    }
+    if (root) {
+        std::unique_ptr<ArxmlSnapshotReader> reader;
+        if (snapshot) {
+            reader = std::make_unique<ArxmlSnapshotReader>(*snapshot);
+            skeleton.setSnapshot(reader.get());
+        }
+        const ArxmlElement &rootView = reader ? reader->get(*root) : *root;
+        if (isSplitElement(rootView, 0)) {
+            planSegments(segments, skeleton, reader.get(), *root, 0, 0);
+        } else {
+            skeleton.writeElement(*root, 0);
+        }
+        skeleton.setSnapshot(nullptr);
+    }
+    QByteArray tail = skeleton.takeData();
+    if (!epilog.isEmpty()) {
+        // The epilog starts with the original line break after the root
+        if (tail.endsWith('\n')) {
+            tail.chop(1);
+        }
+        tail += epilog;
+    }
+    segments.push_back({nullptr, 0, 0, std::move(tail)});
+
+    // The subtrees are serialized on a pool of their own, at most one per
+    // thread ahead of the one being written out. Each streams its output
+    // through a bounded pipe, so the memory used does not grow with the
+    // document.
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+    std::vector<std::unique_ptr<SegmentPipe>> pipes(segments.size());
+    size_t next = 0;
+    int inFlight = 0;
+    auto startSegments = [&]() {
+        for (; next < segments.size() && inFlight < pool.maxThreadCount(); ++next) {
+            const SaveSegment &segment = segments[next];
+            if (!segment.elem) {
+                continue;
+            }
+            pipes[next] = std::make_unique<SegmentPipe>();
+            SegmentPipe *pipe = pipes[next].get();
+            const ArxmlElement *elem = segment.elem;
+            const int depth = segment.depth;
+            const qint64 shift = segment.shift;
+            std::vector<ArxmlWriter::Span> *segmentSpans = spans ? &segments[next].spans : nullptr;
+            pool.start([format, source, sourceSize, snapshot, elem, depth, shift, segmentSpans, pipe]() {
+                std::unique_ptr<ArxmlSnapshotReader> reader;
+                ArxmlWriter writer(format);
+                if (snapshot) {
+                    reader = std::make_unique<ArxmlSnapshotReader>(*snapshot);
+                    writer.setSnapshot(reader.get());
+                }
+                writer.setSource(source, sourceSize);
+                writer.setSourceShift(shift);
+                writer.setSpans(segmentSpans);
+                writer.setSink([pipe, source, sourceSize](const QByteArray &data) {
+                    // Stub content points into the mapping, which outlives
+                    // the save; the writer's own buffer is reused
+                    const bool mapped = source && data.constData() >= source
+                                     && data.constData() < source + sourceSize;
+                    pipe->push(mapped ? data : QByteArray(data.constData(), data.size()));
+                }, StreamFlushSize);
+                writer.writeElement(*elem, depth);
+                writer.flush();
+                pipe->finish();
+            });
+            ++inFlight;
+        }
+    };
+
+    bool written = true;
+    startSegments();
+    for (size_t i = 0; i < segments.size() && written; ++i) {
+        SaveSegment &segment = segments[i];
+        if (!segment.elem) {
+            written = sink(segment.data);
+            segment.data = QByteArray();
+            continue;
+        }
+        QByteArray data;
+        while (written && pipes[i]->pop(data)) {
+            segment.size += data.size();
+            written = sink(data);
+        }
+        --inFlight;
+        startSegments();
+    }
+    if (!written) {
+        // Segments still being serialized drop their output
+        for (const auto& pipe : pipes) {
+            if (pipe) {
+                pipe->abort();
+            }
+        }
+    }
+    pool.waitForDone();
+
+    if (written && spans) {
+        // Subtree offsets start at their own first byte, skeleton offsets
+        // leave out the subtrees written in between: a subtree inserted at
+        // a skeleton position comes before an element starting there, but
+        // after one ending there
+        std::vector<std::pair<qint64, qint64>> inserted;  // Position, subtree bytes up to it
+        qint64 subtreeBytes = 0;
+        for (SaveSegment &segment : segments) {
+            if (!segment.elem) {
+                continue;
+            }
+            const qint64 base = segment.at + subtreeBytes;
+            if (!segment.spans.empty()) {
+                // The subtree's lead includes the markup in front of it
+                segment.spans.front().lead += segment.lead;
+            }
+            for (ArxmlWriter::Span span : segment.spans) {
+                span.begin += base;
+                span.end += base;
+                spans->push_back(span);
+            }
+            segment.spans = std::vector<ArxmlWriter::Span>();
+            subtreeBytes += segment.size;
+            inserted.emplace_back(segment.at, subtreeBytes);
+        }
+        auto toOutput = [&inserted](qint64 pos, bool end) {
+            const auto after = end
+                ? std::lower_bound(inserted.begin(), inserted.end(), pos,
+                                   [](const std::pair<qint64, qint64> &entry, qint64 p) { return entry.first < p; })
+                : std::upper_bound(inserted.begin(), inserted.end(), pos,
+                                   [](qint64 p, const std::pair<qint64, qint64> &entry) { return p < entry.first; });
+            return pos + (after == inserted.begin() ? 0 : std::prev(after)->second);
+        };
+        for (ArxmlWriter::Span span : skeletonSpans) {
+            span.begin = toOutput(span.begin, false);
+            span.end = toOutput(span.end, true);
+            spans->push_back(span);
+        }
+    }
+    return written;
+}
+
+// Character data of an XML fragment: markup is skipped, entity and
+// character references are resolved, CDATA sections are taken as they are.
+// Whether a run of it (up to the next tag, comment or PI) contains needle,
+// which is lower case UTF-8; the text is lowered ASCII only.
+bool textContains(const char *data, qint64 size, const QByteArray &needle)
+{
+    auto startsWith = [data, size](qint64 at, const char *prefix) {
+        const qint64 length = qint64(std::strlen(prefix));
+        return at + length <= size && std::memcmp(data + at, prefix, size_t(length)) == 0;
+    };
+    auto find = [data, size](qint64 from, const char *what) {
+        const QByteArray view = QByteArray::fromRawData(data, size);
+        const qsizetype at = view.indexOf(what, from);
+        return at < 0 ? size : qint64(at);
+    };
+
+    QByteArray text;
+    qint64 i = 0;
+    while (i < size) {
+        const char c = data[i];
+        if (c == '<') {
+            if (startsWith(i, "<![CDATA[")) {
+                const qint64 end = find(i + 9, "]]>");
+                text += QByteArray(data + i + 9, end - i - 9).toLower();
+                i = end + 3;
+                continue;
+            }
+            if (text.contains(needle)) {
+                return true;
+            }
+            text.clear();
+            if (startsWith(i, "<!--")) {
+                i = find(i + 4, "-->") + 3;
+            } else if (startsWith(i, "<?")) {
+                i = find(i + 2, "?>") + 2;
+            } else {
+                // A tag; attribute values may hold '>'
+                char quote = 0;
+                for (++i; i < size && (quote || data[i] != '>'); ++i) {
+                    if (quote ? data[i] == quote : (data[i] == '"' || data[i] == '\'')) {
+                        quote = quote ? 0 : data[i];
+                    }
+                }
+                ++i;
+            }
+            continue;
+        }
+        if (c == '&') {
+            // Longest reference is a character reference like &#x10FFFF;
+            const qint64 end = find(i + 1, ";");
+            if (end - i > 10) {
+                text += '&';
+                ++i;
+                continue;
+            }
+            const QByteArray name(data + i + 1, end - i - 1);
+            if (name == "amp") {
+                text += '&';
+            } else if (name == "lt") {
+                text += '<';
+            } else if (name == "gt") {
+                text += '>';
+            } else if (name == "quot") {
+                text += '"';
+            } else if (name == "apos") {
+                text += '\'';
+            } else if (name.startsWith('#')) {
+                bool ok = false;
+                const uint code = name.startsWith("#x") ? name.mid(2).toUInt(&ok, 16) : name.mid(1).toUInt(&ok, 10);
+                if (ok) {
+                    const char32_t ucs4 = code;
+                    text += QString::fromUcs4(&ucs4, 1).toUtf8().toLower();
+                }
+            }
+            i = end + 1;
+            continue;
+        }
+        // Plain run up to the next markup or reference
+        qint64 end = i;
+        while (end < size && data[end] != '<' && data[end] != '&') {
+            ++end;
+        }
+        text += QByteArray(data + i, end - i).toLower();
+        i = end;
+    }
+    return text.contains(needle);
+}
+
+// Whether the fragment has a start tag whose name ends with suffix
+bool hasElementEndingWith(const char *data, qint64 size, const QByteArray &suffix)
+{
+    auto isNameChar = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_' || c == '.' || c == ':';
+    };
+    const QByteArray view = QByteArray::fromRawData(data, size);
+    for (qsizetype at = view.indexOf(suffix); at >= 0; at = view.indexOf(suffix, at + 1)) {
+        const qint64 end = at + suffix.size();
+        if (end < size && isNameChar(data[end])) {
+            continue;
+        }
+        qint64 begin = at;
+        while (begin > 0 && isNameChar(data[begin - 1])) {
+            --begin;
+        }
+        if (begin > 0 && data[begin - 1] == '<') {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
 
 ArxmlModel::ArxmlModel()
     : m_root(std::make_shared<ArxmlElement>())
 {
 }
 
-ArxmlModel::~ArxmlModel() = default;
+ArxmlModel::~ArxmlModel()
+{
+    interruptReaders();
+}
+
+ArxmlModel::ReadAccess::ReadAccess(const ArxmlModel &model, quint64 editGeneration)
+    : m_model(model),
+      m_generation(editGeneration)
+{
+    m_model.m_readersLock.lockForRead();
+}
+
+ArxmlModel::ReadAccess::~ReadAccess()
+{
+    m_model.m_readersLock.unlock();
+}
+
+bool ArxmlModel::ReadAccess::cancelled() const
+{
+    return m_model.m_editGeneration.load() != m_generation;
+}
+
+void ArxmlModel::interruptReaders() const
+{
+    // Readers check cancelled() between units of work and let go; taking
+    // the lock for writing waits for that
+    ++m_editGeneration;
+    m_readersLock.lockForWrite();
+    m_readersLock.unlock();
+}
+
+bool ArxmlModel::loadFromFile(const QString &fileName, const ArxmlLoadOptions &options)
+{
+    m_lastError.clear();
+
+    // Projected loads leave stubs just like out-of-core ones
+    const bool useStubs = options.outOfCore || !options.packagePaths.isEmpty() || !options.elementTags.isEmpty();
+    if (useStubs && compressionForFile(fileName) != ArxmlCompression::None) {
+        m_lastError = QString("Compressed files cannot be opened out-of-core or in part: %1").arg(fileName);
+        return false;
+    }
+    
+    // Compressed files are decompressed on a separate thread while parsing
+    ArxmlInputStream input(fileName, LoadChunkSize);
+    if (!input.open()) {
+        m_lastError = input.errorString();
+        return false;
+    }
+
+    // Reset root; the document node only collects the document element
+    interruptReaders();
+    m_saveJob.reset();  // A running save keeps the old tree
+    m_revisionCounter = 0;
+    ++m_sourceGeneration;
+    m_changes.clear();
+    m_journal.clear();
+    m_inTransaction = false;
+    m_prolog.clear();
+    m_epilog.clear();
+    m_sourceMap.reset();
+    m_pages.clear();
+    m_pageIndex.clear();
+    m_pagedBytes = 0;
+    m_root = std::make_shared<ArxmlElement>();
+    m_root->tagName = "Document";
+    
+    // Input is fed to the reader in chunks so progress can be reported in
+    // bytes and the load can be cancelled between chunks. Without namespace
+    // processing names stay as written and xmlns declarations are reported
+    // as attributes, so nothing of a start tag is lost.
+    QXmlStreamReader reader;
+    reader.setNamespaceProcessing(false);
+    const qint64 totalBytes = input.size();
+    TreeBuilder builder(m_root, 0, options.outOfCore);
+    builder.setProjection(options.packagePaths, options.elementTags);
+    const auto& stack = builder.stack;
+
+    while (true) {
+        QXmlStreamReader::TokenType type = reader.readNext();
+
+        if (type == QXmlStreamReader::Invalid &&
+            reader.error() == QXmlStreamReader::PrematureEndOfDocumentError &&
+            !input.atEnd()) {
+            const QByteArray chunk = input.read();
+            if (chunk.isEmpty()) {
+                break;
+            }
+            builder.addInput(chunk);
+            // Progress is measured in bytes of the file on disk
+            if (options.progress && !options.progress(input.bytesConsumed(), totalBytes)) {
+                m_lastError = QString("Loading cancelled: %1").arg(fileName);
+                m_root = std::make_shared<ArxmlElement>();
+                return false;
+            }
+            reader.addData(chunk);
+            continue;
+        }
+
+        if (type == QXmlStreamReader::Invalid || type == QXmlStreamReader::EndDocument) {
+            break;
+        }
+
+        switch (type) {
+        case QXmlStreamReader::StartDocument: {
+            const QString encoding = reader.documentEncoding().toString();
+            if (!encoding.isEmpty() && encoding.compare(QLatin1String("UTF-8"), Qt::CaseInsensitive) != 0) {
+                builder.recordSpans = false;
+            }
+            break;
+        }
+
+        case QXmlStreamReader::StartElement:
+            builder.startElement(reader);
+            break;
+
+        case QXmlStreamReader::EndElement: {
+            const std::shared_ptr<ArxmlElement> finished = builder.endElement(reader);
+            // Left open: document node, document element, AR-PACKAGES
+            if (options.packageLoaded && finished && stack.size() == 3 &&
+                finished->tagName == QLatin1String("AR-PACKAGE") &&
+                stack[2]->tagName == QLatin1String("AR-PACKAGES")) {
+                options.packageLoaded(finished,
+                                      QList<int>() << builder.indexStack[2]
+                                                   << static_cast<int>(stack[2]->children.size()) - 1,
+                                      QStringList() << stack[1]->tagName << stack[2]->tagName);
+            }
+            break;
+        }
+
+        case QXmlStreamReader::Characters:
+            builder.characters(reader);
+            break;
+
+        case QXmlStreamReader::Comment:
+        case QXmlStreamReader::ProcessingInstruction:
+            builder.markup(reader);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if (input.hasError()) {
+        m_lastError = input.errorString();
+        m_root = std::make_shared<ArxmlElement>();
+        return false;
+    }
+
+    // Fed incrementally, the reader cannot tell that no trailing content
+    // follows the document element and reports a premature end instead.
+    // That is only an error if an element is still open.
+    const bool documentComplete = stack.size() == 1 && !m_root->children.empty();
+    if (reader.hasError() &&
+        !(reader.error() == QXmlStreamReader::PrematureEndOfDocumentError && documentComplete)) {
+        m_lastError = reader.errorString();
+        return false;
+    }
+
+    // The document element becomes the root of the model
+    if (m_root->children.size() != 1) {
+        m_lastError = QString("No document element in %1").arg(fileName);
+        m_root = std::make_shared<ArxmlElement>();
+        return false;
+    }
+    m_root = m_root->children[0];
+    m_root->parent = nullptr;
+
+    const bool recordSpans = builder.recordSpans && m_root->hasSource() && m_root->sourceEnd > m_root->sourceBegin;
+    if (recordSpans) {
+        // Everything after the document element is still in the offset map
+        m_prolog = builder.prolog;
+        m_epilog = builder.offsets.bytes(m_root->sourceEnd, builder.offsets.dataEnd());
+    }
+
+    if (useStubs) {
+        // Stubs were created relying on the spans; without them (or the
+        // mapping) their content is not reachable
+        if (recordSpans) {
+            m_sourceMap = ArxmlSourceMap::open(fileName);
+        }
+        if (!m_sourceMap) {
+            m_lastError = QString("File cannot be opened out-of-core (not UTF-8 or not mappable): %1")
+                              .arg(fileName);
+            m_root = std::make_shared<ArxmlElement>();
+            return false;
+        }
+    }
+
+    m_filePath = fileName;
+    m_savedRevision = 0;
+    m_sourceSpansValid = recordSpans;
+    recordSource(fileName);
+    return true;
+}
+
+void ArxmlSnapshot::freeze(const ArxmlElement *elem)
+{
+    // Copies are only added by the model's thread, which can look them up
+    // without the lock; readers only read elem, so it is copied before
+    // waiting for them
+    if (m_frozen.count(elem)) {
+        return;
+    }
+    auto copy = std::make_shared<const ArxmlElement>(*elem);
+    m_freezing = true;
+    m_lock.lockForWrite();
+    m_frozen.emplace(elem, std::move(copy));
+    m_lock.unlock();
+    m_freezing = false;
+}
+
+ArxmlSnapshotReader::ArxmlSnapshotReader(ArxmlSnapshot &snapshot)
+    : m_snapshot(snapshot)
+{
+}
+
+ArxmlSnapshotReader::~ArxmlSnapshotReader()
+{
+    pause();
+}
+
+const ArxmlElement &ArxmlSnapshotReader::get(const ArxmlElement &elem)
+{
+    // A waiting edit gets in between two elements
+    if (m_locked && (++m_reads >= SnapshotReadsPerLock || m_snapshot.m_freezing.load(std::memory_order_relaxed))) {
+        pause();
+    }
+    if (!m_locked) {
+        m_snapshot.m_lock.lockForRead();
+        m_locked = true;
+        m_reads = 0;
+    }
+    const auto it = m_snapshot.m_frozen.find(&elem);
+    return it != m_snapshot.m_frozen.end() ? *it->second : elem;
+}
+
+void ArxmlSnapshotReader::pause()
+{
+    if (m_locked) {
+        m_snapshot.m_lock.unlock();
+        m_locked = false;
+    }
+}
 
-bool ArxmlModel::loadFromFile(const QString &fileName)
+bool ArxmlSaveJob::run()
 {
     m_lastError.clear();
-    
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        m_lastError = QString("Cannot open file: %1").arg(fileName);
+    m_written = false;
+    m_full = false;
+    m_spansRecorded = false;
+    m_updates.clear();
+
+    // Spans are offsets into uncompressed content and can only be copied
+    // between plain files
+    const QFileInfo sourceInfo(m_sourcePath);
+    const bool sourceUsable = m_root && m_sourceSpansValid && sourceInfo.exists() &&
+                              sourceInfo.size() == m_sourceSize && sourceInfo.lastModified() == m_sourceModified &&
+                              compressionForFile(m_sourcePath) == ArxmlCompression::None &&
+                              compressionForFile(m_fileName) == ArxmlCompression::None;
+    QFile source(m_sourcePath);
+    const qint64 sourceSize = sourceUsable && source.open(QIODevice::ReadOnly) ? source.size() : 0;
+    uchar *mapped = sourceSize > 0 ? source.map(0, sourceSize) : nullptr;
+    if (mapped) {
+        // QSaveFile writes to a temporary file next to the target, so the
+        // source can still be read even when it is the file being replaced
+        QSaveFile out(m_fileName);
+        if (!out.open(QIODevice::WriteOnly)) {
+            source.unmap(mapped);
+            m_lastError = QString("Cannot write file: %1").arg(m_fileName);
+            return false;
+        }
+
+        bool written;
+        bool outputFailed;
+        {
+            ArxmlSnapshotReader reader(m_snapshot);
+            IncrementalSaver saver(reinterpret_cast<const char*>(mapped), sourceSize, out, m_savedRevision,
+                                   reader, m_updates);
+            written = saver.run(*m_root);
+            outputFailed = saver.outputFailed();
+        }
+        source.unmap(mapped);
+        source.close();
+
+        if (written) {
+            if (!out.commit()) {
+                m_lastError = QString("Cannot write file: %1").arg(m_fileName);
+                return false;
+            }
+            // Stubs are paged in from the new file from now on
+            if (m_sourceMap) {
+                m_savedSource = ArxmlSourceMap::open(m_fileName);
+            }
+            m_written = true;
+            return true;
+        }
+        out.cancelWriting();
+        m_updates.clear();
+        if (outputFailed) {
+            m_lastError = QString("Cannot write file: %1").arg(m_fileName);
+            return false;
+        }
+        // Spans did not match the source, write everything instead
+    }
+
+    // Written (and compressed, for .gz / .zst) to a temporary file that
+    // replaces the target only when complete. Where the elements end up is
+    // recorded, so a plain file can be saved incrementally next time.
+    m_full = true;
+    const bool recordSpans = compressionForFile(m_fileName) == ArxmlCompression::None;
+    std::vector<ArxmlWriter::Span> spans;
+    ArxmlOutputStream file(m_fileName);
+    m_written = file.open() &&
+                streamDocument(m_root.get(), m_prolog, m_epilog, m_sourceMap.get(), &m_snapshot,
+                               ArxmlWriter::Format::Pretty,
+                               [&file](const QByteArray &data) { return file.write(data); },
+                               recordSpans ? &spans : nullptr) &&
+                file.commit();
+    if (!m_written) {
+        m_lastError = QString("Cannot write file: %1").arg(m_fileName);
         return false;
     }
+    if (!recordSpans) {
+        return true;
+    }
 
-    // Reset root
-    m_root = std::make_shared<ArxmlElement>();
-    m_root->tagName = "Document";
-    
-    QXmlStreamReader reader(&file);
-    std::vector<std::shared_ptr<ArxmlElement>> stack;
-    stack.push_back(m_root);
+    ArxmlSnapshotReader reader(m_snapshot);
+    m_updates.reserve(spans.size());
+    for (const ArxmlWriter::Span &span : spans) {
+        ArxmlElement *target = const_cast<ArxmlElement*>(span.elem);
+        const ArxmlElement &elem = reader.get(*span.elem);
+        if (!elem.stub) {
+            m_updates.push_back({target, SpanUpdate::Rewrite, span.begin - span.shift, span.end - span.shift,
+                                 span.startTag, span.tail, attributesHash(elem), span.lead});
+        } else if (elem.hasSource() && span.end - span.begin == elem.sourceEnd - elem.sourceBegin) {
+            // Stub content is copied as it was; whatever gets paged in from
+            // it moves along through the shift
+            m_updates.push_back({target, SpanUpdate::Shift, span.begin - span.shift - elem.sourceBegin,
+                                 0, 0, 0, 0, span.lead});
+        } else {
+            m_updates.push_back({target, SpanUpdate::Clear, 0, 0, 0, 0, 0, 0});
+        }
+    }
+    if (m_sourceMap) {
+        m_savedSource = ArxmlSourceMap::open(m_fileName);
+    }
+    m_spansRecorded = true;
+    return true;
+}
 
-    while (!reader.atEnd()) {
-        QXmlStreamReader::TokenType type = reader.readNext();
+bool ArxmlModel::saveToFile(const QString &fileName) const
+{
+    // Written (and compressed, for .gz / .zst) to a temporary file that
+    // replaces the target only when complete
+    if (!replaceable(fileName)) {
+        return false;
+    }
+    ArxmlOutputStream file(fileName);
+    if (!file.open()) {
+        return false;
+    }
 
-        switch (type) {
-        case QXmlStreamReader::StartElement: {
-            auto newElement = std::make_shared<ArxmlElement>();
-            newElement->tagName = reader.name().toString();
-            newElement->parent = stack.back().get();
+    // Streamed, so out-of-core documents need not fit into memory either;
+    // stub content is copied from the mapped source
+    const bool written = streamDocument(m_root.get(), m_prolog, m_epilog, m_sourceMap.get(), nullptr,
+                                        ArxmlWriter::Format::Pretty, [&file](const QByteArray &data) {
+        return file.write(data);
+    });
+    return written && file.commit();
+}
 
-            // Read attributes
-            QXmlStreamAttributes attrs = reader.attributes();
-            for (const auto& attr : attrs) {
-                newElement->attributes.push_back({
-                    attr.name().toString(),
-                    attr.value().toString()
-                });
-            }
+bool ArxmlModel::saveIncremental(const QString &fileName)
+{
+    // A background save without edits in between
+    const std::shared_ptr<ArxmlSaveJob> job = beginSave(fileName);
+    if (!job) {
+        return false;
+    }
+    job->run();
+    return finishSave(*job);
+}
 
-            stack.back()->children.push_back(newElement);
-            stack.push_back(newElement);
-            break;
+std::shared_ptr<ArxmlSaveJob> ArxmlModel::beginSave(const QString &fileName)
+{
+    m_lastError.clear();
+    if (m_saveJob) {
+        m_lastError = QString("Another save of the document is still running");
+        return nullptr;
+    }
+    if (!replaceable(fileName)) {
+        m_lastError = QString("Cannot replace %1 while it is the source of an out-of-core document; "
+                              "save it under another name").arg(fileName);
+        return nullptr;
+    }
+
+    // Nothing is copied now; edits copy what they change from here on
+    auto job = std::make_shared<ArxmlSaveJob>();
+    job->m_fileName = fileName;
+    job->m_root = m_root;
+    job->m_sourcePath = m_filePath;
+    job->m_sourceSpansValid = m_sourceSpansValid;
+    job->m_sourceSize = m_sourceSize;
+    job->m_sourceModified = m_sourceModified;
+    job->m_savedRevision = m_savedRevision;
+    job->m_revision = m_revisionCounter;
+    job->m_prolog = m_prolog;
+    job->m_epilog = m_epilog;
+    job->m_sourceMap = m_sourceMap;
+    m_saveJob = job;
+    return job;
+}
+
+bool ArxmlModel::finishSave(ArxmlSaveJob &job)
+{
+    // Edits need not be copied any more. The job keeps the copies made so
+    // far, and with them the elements the span updates may still refer to.
+    const bool current = m_saveJob.get() == &job;
+    if (current) {
+        m_saveJob.reset();
+    }
+    if (!job.m_written) {
+        m_lastError = job.m_lastError;
+        return false;
+    }
+    if (!current) {
+        return true;  // Another document was loaded meanwhile
+    }
+    interruptReaders();
+
+    auto invalidateSpans = [this]() {
+        m_sourceSpansValid = false;
+        ++m_sourceGeneration;
+    };
+    if (job.m_full && !job.m_spansRecorded) {
+        // The spans describe the old file, which the full save may have replaced
+        invalidateSpans();
+        return true;
+    }
+    if (m_sourceMap && !job.m_savedSource) {
+        // The new file cannot be mapped: keep the old mapping and the spans
+        // that refer to it
+        invalidateSpans();
+        return true;
+    }
+
+    // Whether elem is still part of the document, outside the subtrees in
+    // moved
+    std::unordered_set<const ArxmlElement*> moved;
+    auto inDocument = [this, &moved](const ArxmlElement *elem) {
+        for (; elem; elem = elem->parent) {
+            if (moved.count(elem)) {
+                return false;
+            }
+            if (elem == m_root.get()) {
+                return true;
+            }
         }
+        return false;
+    };
 
-        case QXmlStreamReader::EndElement:
-            if (!stack.empty()) {
-                stack.pop_back();
+    // Subtrees put into the document during the save still have their spans
+    // in the old file, relative to ancestors that are rebased now; they are
+    // written anew next time, with their stubs read from the old source
+    for (const auto& inserted : job.m_inserted) {
+        if (!inDocument(inserted.get())) {
+            continue;
+        }
+        // Without spans its pages cannot be read again
+        forgetPages(inserted.get());
+        std::vector<ArxmlElement*> stack{inserted.get()};
+        while (!stack.empty()) {
+            ArxmlElement *elem = stack.back();
+            stack.pop_back();
+            if (elem->stub && (!m_sourceMap || !parseStub(*elem, *m_sourceMap, false))) {
+                invalidateSpans();
+                return true;
             }
-            break;
+            elem->sourceStartTag = 0;
+            for (const auto& child : elem->children) {
+                stack.push_back(child.get());
+            }
+        }
+        moved.insert(inserted.get());
+    }
 
-        case QXmlStreamReader::Characters:
-            if (!reader.isWhitespace() && !stack.empty()) {
-                QString text = reader.text().toString();
-                if (!text.trimmed().isEmpty()) {
-                    stack.back()->text = text;
+    // Subtrees removed during the save keep the old file's spans, which
+    // their DetachedElement refers to
+    for (const ArxmlSaveJob::SpanUpdate& update : job.m_updates) {
+        if (!inDocument(update.elem)) {
+            continue;
+        }
+        switch (update.kind) {
+        case ArxmlSaveJob::SpanUpdate::Shift:
+            // A copied subtree moved as a whole; its descendants follow
+            // through sourceShift
+            shiftSpans(*update.elem, update.begin);
+            update.elem->sourceLead = update.lead;
+            break;
+        case ArxmlSaveJob::SpanUpdate::Rewrite:
+            update.elem->sourceBegin = update.begin;
+            update.elem->sourceEnd = update.end;
+            update.elem->sourceStartTag = update.startTag;
+            update.elem->sourceTail = update.tail;
+            update.elem->sourceAttributesHash = update.attributesHash;
+            update.elem->sourceLead = update.lead;
+            break;
+        case ArxmlSaveJob::SpanUpdate::Clear: {
+            // Re-serialized subtrees lost their relation to the file
+            std::vector<ArxmlElement*> stack{update.elem};
+            while (!stack.empty()) {
+                ArxmlElement *elem = stack.back();
+                stack.pop_back();
+                elem->sourceStartTag = 0;
+                for (const auto& child : elem->children) {
+                    stack.push_back(child.get());
                 }
             }
             break;
+        }
+        }
+    }
 
-        default:
-            break;
+    if (job.m_savedSource) {
+        m_sourceMap = job.m_savedSource;
+    }
+    m_sourceSpansValid = true;
+    ++m_sourceGeneration;
+    m_filePath = job.m_fileName;
+    // Edits made while the save ran are newer than the snapshot
+    m_savedRevision = job.m_revision;
+    recordSource(job.m_fileName);
+    return true;
+}
+
+void ArxmlModel::recordSource(const QString &fileName)
+{
+    const QFileInfo info(fileName);
+    m_sourceSize = info.size();
+    m_sourceModified = info.lastModified();
+}
+
+QByteArray ArxmlModel::toByteArray(ArxmlWriter::Format format) const
+{
+    QByteArray document;
+    streamDocument(m_root.get(), m_prolog, m_epilog, m_sourceMap.get(), nullptr, format,
+                   [&document](const QByteArray &data) {
+        document += data;
+        return true;
+    });
+    return document;
+}
+
+void ArxmlModel::markModified(ArxmlElement* elem)
+{
+    if (!elem) {
+        return;
+    }
+
+    interruptReaders();
+    freezeForSave(elem, true);
+    const quint64 stamp = ++m_revisionCounter;
+    elem->revision = stamp;
+
+    // Propagate to the ancestors so a whole untouched subtree can be skipped
+    // by comparing a single stamp
+    for (ArxmlElement* current = elem; current; current = current->parent) {
+        current->subtreeRevision = stamp;
+    }
+}
+
+void ArxmlModel::freezeForSave(const ArxmlElement *elem, bool withAncestors) const
+{
+    if (!m_saveJob) {
+        return;
+    }
+    // Stamps change along the parent chain, so edits take it along
+    do {
+        m_saveJob->m_snapshot.freeze(elem);
+        elem = elem->parent;
+    } while (withAncestors && elem);
+}
+
+ArxmlModel::DetachedElement ArxmlModel::createElement(const QString &tagName) const
+{
+    DetachedElement created;
+    created.element = std::make_shared<ArxmlElement>();
+    created.element->tagName = tagName;
+    created.sourceGeneration = m_sourceGeneration;
+    return created;
+}
+
+void ArxmlModel::setText(const std::shared_ptr<ArxmlElement> &elem, const QString &text)
+{
+    interruptReaders();
+    freezeForSave(elem.get(), true);
+    if (m_inTransaction) {
+        m_journal.push_back({JournalEntry::Kind::Text, elem, QString(), elem->text});
+    }
+    elem->text = text;
+    markModified(elem.get());
+    m_changes.push_back({ArxmlChange::Kind::Content, elem, nullptr, -1});
+}
+
+void ArxmlModel::setAttribute(const std::shared_ptr<ArxmlElement> &elem, const QString &name, const QString &value)
+{
+    interruptReaders();
+    if (m_inTransaction) {
+        JournalEntry entry{JournalEntry::Kind::Attribute, elem, name};
+        for (const auto& attr : elem->attributes) {
+            if (attr.first == name) {
+                entry.value = attr.second;
+                entry.existed = true;
+                break;
+            }
         }
+        m_journal.push_back(std::move(entry));
     }
+    freezeForSave(elem.get(), true);
+    elem->setAttribute(name, value);
+    markModified(elem.get());
+    m_changes.push_back({ArxmlChange::Kind::Content, elem, nullptr, -1});
+}
 
-    file.close();
+void ArxmlModel::removeAttribute(const std::shared_ptr<ArxmlElement> &elem, const QString &name)
+{
+    auto& attrs = elem->attributes;
+    auto it = std::find_if(attrs.begin(), attrs.end(),
+                           [&name](const std::pair<QString, QString>& attr) { return attr.first == name; });
+    if (it == attrs.end()) {
+        return;
+    }
+    interruptReaders();
+    if (m_inTransaction) {
+        m_journal.push_back({JournalEntry::Kind::Attribute, elem, name, it->second, true});
+    }
+    freezeForSave(elem.get(), true);
+    attrs.erase(it);
+    markModified(elem.get());
+    m_changes.push_back({ArxmlChange::Kind::Content, elem, nullptr, -1});
+}
 
-    if (reader.hasError()) {
-        m_lastError = reader.errorString();
+bool ArxmlModel::removeChild(const std::shared_ptr<ArxmlElement> &parent, int index, DetachedElement &removed)
+{
+    if (!parent || index < 0 || index >= static_cast<int>(parent->children.size())) {
+        m_lastError = QString("No child element at index %1").arg(index);
         return false;
     }
 
-    // Move root element's children to be root-level
-    if (!m_root->children.empty()) {
-        auto firstChild = m_root->children[0];
-        if (firstChild->children.empty() && firstChild->text.isEmpty() &&
-            !firstChild->attributes.empty()) {
-            // This is likely the root element with namespace declarations
-            m_root = firstChild;
-        } else if (m_root->children.size() == 1) {
-            // Single root element
-            m_root = m_root->children[0];
-            m_root->parent = nullptr;
+    interruptReaders();
+    removed.element = parent->children[index];
+    removed.source = m_sourceMap;
+    removed.sourceGeneration = m_sourceGeneration;
+    freezeForSave(parent.get(), true);
+    freezeForSave(removed.element.get(), false);
+    // Outside the document the ancestors' shifts no longer apply; the
+    // subtree takes them along
+    shiftSpans(*removed.element, inheritedShift(removed.element.get()));
+    parent->children.erase(parent->children.begin() + index);
+    // Markup in front of the removed child now precedes the next one
+    for (ArxmlMarkup& token : parent->markup) {
+        if (token.before > size_t(index)) {
+            --token.before;
         }
     }
+    removed.element->parent = nullptr;
+    // Pages inside the subtree must not be evicted while it is detached
+    removed.pages.clear();
+    forgetPages(removed.element.get(), &removed.pages);
+    markModified(parent.get());
 
-    m_filePath = fileName;
+    if (m_inTransaction) {
+        JournalEntry entry{JournalEntry::Kind::Removed, parent};
+        entry.index = index;
+        entry.removed = removed;
+        m_journal.push_back(std::move(entry));
+    }
+    m_changes.push_back({ArxmlChange::Kind::ChildRemoved, parent, removed.element, index});
     return true;
 }
 
-bool ArxmlModel::saveToFile(const QString &fileName) const
+bool ArxmlModel::insertChild(const std::shared_ptr<ArxmlElement> &parent, int index, const DetachedElement &child)
 {
-    QFile file(fileName);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (!parent || !child.element || index < 0 || index > static_cast<int>(parent->children.size())) {
+        m_lastError = QString("Cannot insert element at index %1").arg(index);
         return false;
     }
+    interruptReaders();
 
-    QXmlStreamWriter writer(&file);
-    writer.setAutoFormatting(true);
-    writer.setAutoFormattingIndent(2);
-    writer.writeStartDocument();
+    if (child.sourceGeneration != m_sourceGeneration) {
+        // The spans point into a file that was replaced since; read stubs
+        // from the source they came from and write the subtree anew
+        std::vector<ArxmlElement*> stack{child.element.get()};
+        while (!stack.empty()) {
+            ArxmlElement *elem = stack.back();
+            stack.pop_back();
+            if (elem->stub && (!child.source || !parseStub(*elem, *child.source, false))) {
+                m_lastError = QString("Cannot read '%1' back from its source file").arg(elem->tagName);
+                return false;
+            }
+            elem->sourceStartTag = 0;
+            for (const auto& grandChild : elem->children) {
+                stack.push_back(grandChild.get());
+            }
+        }
+    } else {
+        // Its pages can be evicted again like any other
+        for (ArxmlElement *page : child.pages) {
+            if (!m_pageIndex.count(page)) {
+                addPage(page);
+            }
+        }
+    }
 
-    if (m_root) {
-        saveElement(*m_root, writer, 0);
+    freezeForSave(parent.get(), true);
+    freezeForSave(child.element.get(), false);
+    if (m_saveJob) {
+        m_saveJob->m_inserted.push_back(child.element);
+    }
+    // The new ancestors' shifts apply from now on
+    shiftSpans(*child.element, -(inheritedShift(parent.get()) + parent->sourceShift));
+    child.element->parent = parent.get();
+    // Markup stays with the child it preceded, and after the last one
+    for (ArxmlMarkup& token : parent->markup) {
+        if (token.before > size_t(index) || token.before == parent->children.size()) {
+            ++token.before;
+        }
     }
+    parent->children.insert(parent->children.begin() + index, child.element);
+    markModified(parent.get());
 
-    writer.writeEndDocument();
-    file.close();
+    if (m_inTransaction) {
+        JournalEntry entry{JournalEntry::Kind::Inserted, parent};
+        entry.index = index;
+        m_journal.push_back(std::move(entry));
+    }
+    m_changes.push_back({ArxmlChange::Kind::ChildInserted, parent, child.element, index});
     return true;
 }
 
-void ArxmlModel::saveElement(const ArxmlElement& elem, QXmlStreamWriter& writer, int indent) const
+void ArxmlModel::beginTransaction()
+{
+    m_journal.clear();
+    m_inTransaction = true;
+}
+
+void ArxmlModel::commitTransaction()
 {
-    writer.writeStartElement(elem.tagName);
+    m_journal.clear();
+    m_inTransaction = false;
+}
 
-    // Write attributes
-    for (const auto& attr : elem.attributes) {
-        writer.writeAttribute(attr.first, attr.second);
+bool ArxmlModel::rollbackTransaction()
+{
+    // The inverse edits are ordinary edits (recorded as changes), just not
+    // journaled again
+    m_inTransaction = false;
+    std::vector<JournalEntry> journal;
+    journal.swap(m_journal);
+    for (auto it = journal.rbegin(); it != journal.rend(); ++it) {
+        switch (it->kind) {
+        case JournalEntry::Kind::Text:
+            setText(it->element, it->value);
+            break;
+        case JournalEntry::Kind::Attribute:
+            if (it->existed) {
+                setAttribute(it->element, it->name, it->value);
+            } else {
+                removeAttribute(it->element, it->name);
+            }
+            break;
+        case JournalEntry::Kind::Inserted: {
+            // Later inverses rely on the child lists being restored, so
+            // going on after a failure would edit the wrong elements
+            DetachedElement inserted;
+            if (!removeChild(it->element, it->index, inserted)) {
+                m_lastError = QString("Rollback failed: %1").arg(m_lastError);
+                return false;
+            }
+            break;
+        }
+        case JournalEntry::Kind::Removed:
+            if (!insertChild(it->element, it->index, it->removed)) {
+                m_lastError = QString("Rollback failed: %1").arg(m_lastError);
+                return false;
+            }
+            break;
+        }
     }
+    return true;
+}
+
+std::vector<ArxmlChange> ArxmlModel::takeChanges()
+{
+    std::vector<ChangeRecord> records;
+    records.swap(m_changes);
 
-    // Write text content
-    if (!elem.text.isEmpty() && elem.children.empty()) {
-        writer.writeCharacters(elem.text);
+    // Child lists edited once are reported edit by edit, the others reset
+    std::unordered_map<const ArxmlElement*, int> structuralEdits;
+    for (const ChangeRecord& record : records) {
+        if (record.kind != ArxmlChange::Kind::Content) {
+            ++structuralEdits[record.element.get()];
+        }
+    }
+    std::unordered_set<const ArxmlElement*> inserted;
+    for (const ChangeRecord& record : records) {
+        if (record.kind == ArxmlChange::Kind::ChildInserted && structuralEdits[record.element.get()] == 1) {
+            inserted.insert(record.child.get());
+        }
     }
 
-    // Write child elements
-    for (const auto& child : elem.children) {
-        saveElement(*child, writer, indent + 1);
+    // Views build inserted subtrees and reset child lists from scratch, so
+    // changes inside them need no update of their own; neither do changes
+    // in subtrees that are no longer part of the document
+    auto covered = [&](const ArxmlElement *elem) {
+        for (const ArxmlElement *node = elem; ; node = node->parent) {
+            if (inserted.count(node)) {
+                return true;
+            }
+            if (node != elem) {
+                auto it = structuralEdits.find(node);
+                if (it != structuralEdits.end() && it->second > 1) {
+                    return true;
+                }
+            }
+            if (!node->parent) {
+                return node != m_root.get();
+            }
+        }
+    };
+
+    // Paths are looked up once per element, child indices once per parent
+    std::unordered_map<const ArxmlElement*, QList<int>> paths;
+    std::unordered_map<const ArxmlElement*, std::unordered_map<const ArxmlElement*, int>> childIndices;
+    std::function<QList<int>(const ArxmlElement*)> pathOf = [&](const ArxmlElement *elem) {
+        if (!elem->parent) {
+            return QList<int>();
+        }
+        auto found = paths.find(elem);
+        if (found != paths.end()) {
+            return found->second;
+        }
+        const ArxmlElement *parent = elem->parent;
+        auto& indices = childIndices[parent];
+        if (indices.empty()) {
+            for (size_t i = 0; i < parent->children.size(); ++i) {
+                indices.emplace(parent->children[i].get(), static_cast<int>(i));
+            }
+        }
+        QList<int> path = pathOf(parent);
+        path.append(indices[elem]);
+        paths.emplace(elem, path);
+        return path;
+    };
+
+    std::vector<ArxmlChange> structural;
+    std::vector<ArxmlChange> content;
+    // Content and child list of one element are reported separately
+    std::unordered_set<const ArxmlElement*> reportedContent;
+    std::unordered_set<const ArxmlElement*> reportedStructure;
+    for (const ChangeRecord& record : records) {
+        const ArxmlElement *elem = record.element.get();
+        const bool isContent = record.kind == ArxmlChange::Kind::Content;
+        auto& reported = isContent ? reportedContent : reportedStructure;
+        if (reported.count(elem) || covered(elem)) {
+            continue;
+        }
+        reported.insert(elem);
+
+        ArxmlChange change;
+        change.path = pathOf(elem);
+        if (isContent) {
+            content.push_back(change);
+        } else {
+            const bool single = structuralEdits[elem] == 1;
+            change.kind = single ? record.kind : ArxmlChange::Kind::ChildrenReset;
+            change.index = single ? record.index : -1;
+            structural.push_back(change);
+        }
     }
 
-    writer.writeEndElement();
+    std::stable_sort(structural.begin(), structural.end(), [](const ArxmlChange& a, const ArxmlChange& b) {
+        return a.path.size() < b.path.size();
+    });
+    structural.insert(structural.end(), content.begin(), content.end());
+    return structural;
 }
 
 std::shared_ptr<ArxmlElement> ArxmlModel::findElementByIndexPath(const QList<int>& indexPath) const
@@ -160,7 +2080,15 @@ std::shared_ptr<ArxmlElement> ArxmlModel::findElementByIndexPathRecursive(
     const QList<int>& indexPath,
     int depth) const
 {
-    if (!elem || depth >= indexPath.size()) {
+    if (!elem) {
+        return elem;
+    }
+    // Out-of-core: stubs on the way (and the target itself) are paged in
+    if (elem->stub && !pageIn(elem.get())) {
+        return nullptr;
+    }
+    touchPage(elem.get());
+    if (depth >= indexPath.size()) {
         return elem; // Return current element if we've reached the end
     }
     
@@ -172,6 +2100,161 @@ std::shared_ptr<ArxmlElement> ArxmlModel::findElementByIndexPathRecursive(
     return findElementByIndexPathRecursive(elem->children[childIndex], indexPath, depth + 1);
 }
 
+bool ArxmlModel::pageIn(ArxmlElement *elem) const
+{
+    if (!m_sourceMap) {
+        return false;
+    }
+    interruptReaders();
+    freezeForSave(elem, false);
+    if (!parseStub(*elem, *m_sourceMap, true)) {
+        return false;
+    }
+
+    addPage(elem);
+    return true;
+}
+
+void ArxmlModel::addPage(ArxmlElement *elem) const
+{
+    m_pages.push_front(elem);
+    const qint64 cost = (elem->sourceEnd - elem->sourceBegin) * PageCostFactor;
+    m_pageIndex[elem] = {m_pages.begin(), cost};
+    m_pagedBytes += cost;
+}
+
+void ArxmlModel::touchPage(const ArxmlElement *elem) const
+{
+    auto it = m_pageIndex.find(elem);
+    if (it != m_pageIndex.end()) {
+        m_pages.splice(m_pages.begin(), m_pages, it->second.position);
+    }
+}
+
+void ArxmlModel::forgetPages(ArxmlElement *elem, std::vector<ArxmlElement*> *forgotten) const
+{
+    // elem and every page nested in it
+    std::vector<ArxmlElement*> stack{elem};
+    while (!stack.empty()) {
+        ArxmlElement *current = stack.back();
+        stack.pop_back();
+        auto it = m_pageIndex.find(current);
+        if (it != m_pageIndex.end()) {
+            m_pages.erase(it->second.position);
+            m_pagedBytes -= it->second.cost;
+            m_pageIndex.erase(it);
+            if (forgotten) {
+                forgotten->push_back(current);
+            }
+        }
+        for (const auto& child : current->children) {
+            stack.push_back(child.get());
+        }
+    }
+}
+
+std::vector<QList<int>> ArxmlModel::evictPages(const ArxmlElement *keep)
+{
+    std::vector<QList<int>> evicted;
+    if (m_memoryLimit <= 0) {
+        return evicted;
+    }
+
+    auto isInside = [](const ArxmlElement *elem, const ArxmlElement *ancestor) {
+        for (; elem; elem = elem->parent) {
+            if (elem == ancestor) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // From the least recently used end; only content that is unchanged in
+    // the mapped source can be read again later
+    auto it = m_pages.end();
+    while (m_pagedBytes > m_memoryLimit && it != m_pages.begin()) {
+        --it;
+        ArxmlElement *page = *it;
+        if (!page->hasSource() || page->subtreeRevision > m_savedRevision || isInside(keep, page)) {
+            continue;
+        }
+        interruptReaders();
+        evicted.push_back(getElementIndexPath(page));
+        forgetPages(page);
+        freezeForSave(page, false);
+        makeStub(*page);
+        // Nested pages went with it, start over at the end of the list
+        it = m_pages.end();
+    }
+    return evicted;
+}
+
+std::vector<QList<int>> ArxmlModel::stubsContaining(const QString &text) const
+{
+    if (text.isEmpty()) {
+        return {};
+    }
+    const QByteArray needle = text.toUtf8().toLower();
+    return stubsMatching([&needle](const char *data, qint64 size) {
+        return textContains(data, size, needle);
+    });
+}
+
+std::vector<QList<int>> ArxmlModel::stubsWithElement(const QString &tagSuffix) const
+{
+    if (tagSuffix.isEmpty()) {
+        return {};
+    }
+    const QByteArray suffix = tagSuffix.toUtf8();
+    return stubsMatching([&suffix](const char *data, qint64 size) {
+        return hasElementEndingWith(data, size, suffix);
+    });
+}
+
+std::vector<QList<int>> ArxmlModel::stubsMatching(const std::function<bool(const char *data, qint64 size)> &match) const
+{
+    std::vector<QList<int>> paths;
+    if (!m_sourceMap || !m_root) {
+        return paths;
+    }
+
+    struct Candidate
+    {
+        const ArxmlElement *stub;
+        qint64 begin;  // Span in the file
+        qint64 end;
+        bool match;
+    };
+    std::vector<Candidate> candidates;
+    // Elements with the sum of their ancestors' shifts
+    std::vector<std::pair<const ArxmlElement*, qint64>> stack{{m_root.get(), 0}};
+    while (!stack.empty()) {
+        const auto [elem, shift] = stack.back();
+        stack.pop_back();
+        if (elem->stub && elem->hasSource()) {
+            candidates.push_back({elem, elem->sourceBegin + shift, elem->sourceEnd + shift, false});
+        }
+        for (auto child = elem->children.rbegin(); child != elem->children.rend(); ++child) {
+            stack.emplace_back(child->get(), shift + elem->sourceShift);
+        }
+    }
+
+    const ArxmlSourceMap *source = m_sourceMap.get();
+    QtConcurrent::blockingMap(candidates, [source, &match](Candidate &candidate) {
+        if (candidate.begin < 0 || candidate.end > source->size()) {
+            return;
+        }
+        candidate.match = match(source->data() + candidate.begin, candidate.end - candidate.begin);
+    });
+
+    for (const Candidate& candidate : candidates) {
+        if (candidate.match) {
+            paths.push_back(getElementIndexPath(candidate.stub));
+        }
+    }
+    return paths;
+}
+
 QList<int> ArxmlModel::getElementIndexPath(const ArxmlElement* elem) const
 {
     QList<int> indexPath;
@@ -0,0 +1,660 @@
+// arxml_pipeline.cpp
+//
+// Reader loop, built-in stages and the writer sink of the streaming
+// transform pipeline.
+
+#include "arxml_pipeline.hpp"
+#include "arxml_compression.hpp"
+#include "arxml_writer.hpp"
+
+#include <QSet>
+#include <QStringList>
+#include <QXmlStreamReader>
+
+namespace {
+
+// Uncompressed input handed to the reader at a time
+constexpr qint64 PipelineChunkSize = 1024 * 1024;
+
+// Output is passed on to the file once the writer buffer holds this much
+constexpr qsizetype PipelineFlushSize = 1024 * 1024;
+
+bool isBlank(const QString &text)
+{
+    for (QChar c : text) {
+        if (!c.isSpace()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isReferenceTag(const QString &tagName)
+{
+    return tagName.endsWith(QLatin1String("-REF")) || tagName.endsWith(QLatin1String("-TREF"));
+}
+
+// Removes elements with the given tags, including their content and the
+// indentation in front of them
+class DropElementsStage : public ArxmlStage
+{
+public:
+    explicit DropElementsStage(const QStringList &tagNames)
+        : m_tagNames(tagNames.begin(), tagNames.end())
+    {
+    }
+
+    void process(ArxmlEvent &event) override
+    {
+        if (m_skipDepth > 0) {
+            if (event.type == ArxmlEvent::Type::StartElement) {
+                ++m_skipDepth;
+            } else if (event.type == ArxmlEvent::Type::EndElement) {
+                --m_skipDepth;
+            }
+            return;
+        }
+
+        // Whitespace is held back until it is clear whether it indents a
+        // dropped element
+        if (event.type == ArxmlEvent::Type::Characters && !event.cdata && isBlank(event.text)) {
+            flushWhitespace();
+            m_whitespace = std::move(event);
+            m_hasWhitespace = true;
+            return;
+        }
+        if (event.type == ArxmlEvent::Type::StartElement && m_tagNames.contains(event.name)) {
+            m_hasWhitespace = false;
+            m_skipDepth = 1;
+            return;
+        }
+        flushWhitespace();
+        forward(event);
+    }
+
+    bool finish() override
+    {
+        flushWhitespace();
+        return true;
+    }
+
+private:
+    void flushWhitespace()
+    {
+        if (m_hasWhitespace) {
+            m_hasWhitespace = false;
+            forward(m_whitespace);
+        }
+    }
+
+    QSet<QString> m_tagNames;
+    int m_skipDepth = 0;
+    ArxmlEvent m_whitespace;
+    bool m_hasWhitespace = false;
+};
+
+// Renames the package at an AUTOSAR path and rewrites all references into it
+class RenamePackageStage : public ArxmlStage
+{
+public:
+    RenamePackageStage(const QString &packagePath, const QString &newName)
+        : m_oldPath(packagePath)
+        , m_newName(newName)
+    {
+        m_newPath = packagePath.left(packagePath.lastIndexOf(QLatin1Char('/')) + 1) + newName;
+    }
+
+    void process(ArxmlEvent &event) override
+    {
+        switch (event.type) {
+        case ArxmlEvent::Type::StartElement:
+            // Elements inherit their parent's path until their SHORT-NAME
+            m_paths.push_back(m_paths.empty() ? QString() : m_paths.back());
+            m_collecting = event.name == QLatin1String("SHORT-NAME") || isReferenceTag(event.name);
+            m_text.clear();
+            m_textIsCdata = false;
+            forward(event);
+            return;
+
+        case ArxmlEvent::Type::Characters:
+            // Names and references are collected whole, they may arrive in pieces
+            if (m_collecting) {
+                m_text += event.text;
+                m_textIsCdata |= event.cdata;
+                return;
+            }
+            forward(event);
+            return;
+
+        case ArxmlEvent::Type::EndElement:
+            if (m_collecting) {
+                m_collecting = false;
+                ArxmlEvent text;
+                text.type = ArxmlEvent::Type::Characters;
+                text.text = event.name == QLatin1String("SHORT-NAME") ? shortName(m_text)
+                                                                      : reference(m_text);
+                text.cdata = m_textIsCdata;
+                if (!text.text.isEmpty()) {
+                    forward(text);
+                }
+            }
+            m_paths.pop_back();
+            forward(event);
+            return;
+
+        default:
+            forward(event);
+            return;
+        }
+    }
+
+private:
+    // m_paths ends with [owner, SHORT-NAME] when a name is complete
+    QString shortName(const QString &text)
+    {
+        if (m_paths.size() < 2) {
+            return text;
+        }
+        QString &ownerPath = m_paths[m_paths.size() - 2];
+        ownerPath += QLatin1Char('/');
+        ownerPath += text.trimmed();
+        return ownerPath == m_oldPath ? m_newName : text;
+    }
+
+    QString reference(const QString &text) const
+    {
+        const QString target = text.trimmed();
+        if (target == m_oldPath) {
+            return m_newPath;
+        }
+        if (target.startsWith(m_oldPath) && target.at(m_oldPath.size()) == QLatin1Char('/')) {
+            return m_newPath + target.mid(m_oldPath.size());
+        }
+        return text;
+    }
+
+    QString m_oldPath;
+    QString m_newName;
+    QString m_newPath;
+    std::vector<QString> m_paths;  // AUTOSAR path of each open element
+    bool m_collecting = false;
+    QString m_text;
+    bool m_textIsCdata = false;
+};
+
+// Keeps only the identifiable at an AUTOSAR path, its content, and the
+// enclosing elements (with their SHORT-NAMEs) needed to reach it. Whether an
+// element is on the path is only known after its SHORT-NAME, so the start of
+// each open element is held back until then.
+class ExtractElementStage : public ArxmlStage
+{
+public:
+    explicit ExtractElementStage(const QString &path)
+        : m_target(path)
+    {
+    }
+
+    void process(ArxmlEvent &event) override
+    {
+        if (m_skipDepth > 0) {
+            if (event.type == ArxmlEvent::Type::StartElement) {
+                ++m_skipDepth;
+            } else if (event.type == ArxmlEvent::Type::EndElement) {
+                --m_skipDepth;
+            }
+            return;
+        }
+
+        if (m_passDepth > 0) {
+            if (event.type == ArxmlEvent::Type::StartElement) {
+                ++m_passDepth;
+            } else if (event.type == ArxmlEvent::Type::EndElement && --m_passDepth == 0) {
+                m_frames.pop_back();
+            }
+            forward(event);
+            return;
+        }
+
+        switch (event.type) {
+        case ArxmlEvent::Type::StartElement:
+            if (event.name == QLatin1String("SHORT-NAME") && !m_frames.empty() && !m_frames.back().named) {
+                Frame &owner = m_frames.back();
+                takeLead(owner);
+                owner.held.push_back(std::move(event));
+                m_inShortName = true;
+                m_shortName.clear();
+                return;
+            }
+            m_frames.emplace_back();
+            m_frames.back().path = m_frames.size() > 1 ? m_frames[m_frames.size() - 2].path : QString();
+            takeLead(m_frames.back());
+            m_frames.back().held.push_back(std::move(event));
+            return;
+
+        case ArxmlEvent::Type::Characters:
+            if (m_inShortName) {
+                m_shortName += event.text;
+                m_frames.back().held.push_back(std::move(event));
+            } else if (isBlank(event.text)) {
+                // Kept as indentation of the next element that is written
+                m_lead = std::move(event);
+                m_hasLead = true;
+            }
+            return;
+
+        case ArxmlEvent::Type::EndElement:
+            if (m_inShortName) {
+                m_inShortName = false;
+                m_frames.back().held.push_back(std::move(event));
+                identify();
+                return;
+            }
+            if (m_frames.back().open) {
+                if (m_hasLead) {
+                    forward(m_lead);
+                }
+                forward(event);
+            }
+            m_hasLead = false;
+            m_frames.pop_back();
+            return;
+
+        default:
+            // Prolog and epilog pass, anything else outside the target is dropped
+            if (m_frames.empty()) {
+                forward(event);
+            }
+            return;
+        }
+    }
+
+    bool finish() override
+    {
+        if (!m_found) {
+            m_error = QString("No element at %1").arg(m_target);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct Frame
+    {
+        std::vector<ArxmlEvent> held;  // Not yet written: start tag, SHORT-NAME
+        QString path;                  // AUTOSAR path, inherited until named
+        bool named = false;
+        bool open = false;             // Start tag written
+    };
+
+    void takeLead(Frame &frame)
+    {
+        if (m_hasLead) {
+            m_hasLead = false;
+            frame.held.push_back(std::move(m_lead));
+        }
+    }
+
+    // The innermost frame's SHORT-NAME is complete: keep, hold or drop it
+    void identify()
+    {
+        Frame &frame = m_frames.back();
+        frame.named = true;
+        frame.path += QLatin1Char('/');
+        frame.path += m_shortName.trimmed();
+
+        if (frame.path == m_target) {
+            for (Frame& open : m_frames) {
+                for (ArxmlEvent& held : open.held) {
+                    forward(held);
+                }
+                open.held.clear();
+                open.open = true;
+            }
+            m_found = true;
+            m_passDepth = 1;
+        } else if (!m_target.startsWith(frame.path + QLatin1Char('/'))) {
+            // Not on the way to the target; skip the rest of it
+            m_frames.pop_back();
+            m_skipDepth = 1;
+        }
+    }
+
+    QString m_target;
+    std::vector<Frame> m_frames;
+    int m_passDepth = 0;  // Open elements inside the target, itself included
+    int m_skipDepth = 0;  // Open elements inside a dropped element, itself included
+    bool m_inShortName = false;
+    QString m_shortName;
+    ArxmlEvent m_lead;
+    bool m_hasLead = false;
+    bool m_found = false;
+};
+
+// Last stage: serializes events and passes the bytes to the output stream.
+// Formatting inside the document element comes from the character events;
+// declaration, comments and PIs outside it are put on lines of their own.
+// The declaration is the input's own, with the encoding the output is
+// actually written in.
+class WriterStage : public ArxmlStage
+{
+public:
+    explicit WriterStage(ArxmlOutputStream &output)
+        : m_output(output)
+        , m_writer(ArxmlWriter::Format::Compact)
+    {
+    }
+
+    void process(ArxmlEvent &event) override
+    {
+        if (m_failed) {
+            return;
+        }
+
+        switch (event.type) {
+        case ArxmlEvent::Type::StartDocument:
+            writeDeclaration(event.attributes);
+            break;
+        case ArxmlEvent::Type::StartElement:
+            closeStartTag();
+            m_writer.writeTagOpen(event.name, event.attributes);
+            m_startTagOpen = true;
+            ++m_depth;
+            break;
+        case ArxmlEvent::Type::EndElement:
+            // Elements without content stay self-closing
+            if (m_startTagOpen) {
+                m_writer.writeRaw(QByteArrayLiteral("/>"));
+                m_startTagOpen = false;
+            } else {
+                m_writer.writeTagClose(event.name);
+            }
+            endTopLevel(--m_depth);
+            break;
+        case ArxmlEvent::Type::Characters:
+            if (m_depth > 0 && !event.text.isEmpty()) {
+                closeStartTag();
+                m_writer.writeText(event.text, event.cdata);
+            }
+            break;
+        case ArxmlEvent::Type::Comment:
+            closeStartTag();
+            m_writer.writeComment(event.text);
+            endTopLevel(m_depth);
+            break;
+        case ArxmlEvent::Type::ProcessingInstruction:
+            closeStartTag();
+            m_writer.writeProcessingInstruction(event.name, event.text);
+            endTopLevel(m_depth);
+            break;
+        case ArxmlEvent::Type::Dtd:
+            m_writer.writeRaw(event.text.toUtf8());
+            endTopLevel(m_depth);
+            break;
+        case ArxmlEvent::Type::EndDocument:
+            break;
+        }
+
+        if (m_writer.size() >= PipelineFlushSize) {
+            flush();
+        }
+    }
+
+    bool finish() override
+    {
+        flush();
+        return !m_failed;
+    }
+
+    bool failed() const { return m_failed; }
+
+private:
+    void writeDeclaration(const std::vector<std::pair<QString, QString>> &attributes)
+    {
+        if (attributes.empty()) {
+            return;
+        }
+        QString declaration = QStringLiteral("<?xml");
+        for (const auto& [name, value] : attributes) {
+            QString written = value;
+            if (name == QLatin1String("encoding") &&
+                value.compare(QLatin1String("UTF-8"), Qt::CaseInsensitive) != 0) {
+                written = QStringLiteral("UTF-8");
+            }
+            declaration += QStringLiteral(" %1=\"%2\"").arg(name, written);
+        }
+        declaration += QStringLiteral("?>\n");
+        m_writer.writeRaw(declaration.toUtf8());
+    }
+
+    void closeStartTag()
+    {
+        if (m_startTagOpen) {
+            m_writer.writeRaw(QByteArrayLiteral(">"));
+            m_startTagOpen = false;
+        }
+    }
+
+    void endTopLevel(int depth)
+    {
+        if (depth == 0) {
+            m_writer.writeRaw(QByteArrayLiteral("\n"));
+        }
+    }
+
+    void flush()
+    {
+        if (!m_failed && m_writer.size() > 0 && !m_output.write(m_writer.takeData())) {
+            m_failed = true;
+            m_error = m_output.errorString();
+        }
+    }
+
+    ArxmlOutputStream &m_output;
+    ArxmlWriter m_writer;
+    int m_depth = 0;
+    bool m_startTagOpen = false;
+    bool m_failed = false;
+};
+
+} // namespace
+
+ArxmlPipeline::ArxmlPipeline() = default;
+
+ArxmlPipeline::~ArxmlPipeline() = default;
+
+void ArxmlPipeline::addStage(std::unique_ptr<ArxmlStage> stage)
+{
+    m_stages.push_back(std::move(stage));
+}
+
+bool ArxmlPipeline::addStage(const QString &spec)
+{
+    const int colon = spec.indexOf(QLatin1Char(':'));
+    const QString kind = spec.left(colon).trimmed();
+    const QString argument = colon >= 0 ? spec.mid(colon + 1).trimmed() : QString();
+
+    if (kind == QLatin1String("drop")) {
+        QStringList tagNames;
+        for (const QString& tagName : argument.split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+            tagNames << tagName.trimmed();
+        }
+        if (!tagNames.isEmpty()) {
+            addStage(std::make_unique<DropElementsStage>(tagNames));
+            return true;
+        }
+    } else if (kind == QLatin1String("rename-package")) {
+        const int equals = argument.indexOf(QLatin1Char('='));
+        const QString path = argument.left(equals).trimmed();
+        const QString newName = equals >= 0 ? argument.mid(equals + 1).trimmed() : QString();
+        if (path.startsWith(QLatin1Char('/')) && path.size() > 1 && !newName.isEmpty() &&
+            !newName.contains(QLatin1Char('/'))) {
+            addStage(std::make_unique<RenamePackageStage>(path, newName));
+            return true;
+        }
+    } else if (kind == QLatin1String("extract")) {
+        if (argument.startsWith(QLatin1Char('/')) && argument.size() > 1) {
+            addStage(std::make_unique<ExtractElementStage>(argument));
+            return true;
+        }
+    }
+
+    m_lastError = QString("Invalid transform stage: %1").arg(spec);
+    return false;
+}
+
+bool ArxmlPipeline::run(const QString &inputFile, const QString &outputFile,
+                        const ProgressCallback &progress)
+{
+    m_lastError.clear();
+
+    ArxmlInputStream input(inputFile, PipelineChunkSize);
+    if (!input.open()) {
+        m_lastError = input.errorString();
+        return false;
+    }
+    ArxmlOutputStream output(outputFile);
+    if (!output.open()) {
+        m_lastError = output.errorString();
+        return false;
+    }
+
+    WriterStage writer(output);
+    for (size_t i = 0; i < m_stages.size(); ++i) {
+        m_stages[i]->m_next = i + 1 < m_stages.size() ? m_stages[i + 1].get() : &writer;
+    }
+    ArxmlStage *first = m_stages.empty() ? static_cast<ArxmlStage*>(&writer) : m_stages.front().get();
+
+    QXmlStreamReader reader;
+    reader.setNamespaceProcessing(false);
+    ArxmlEvent event;
+    int depth = 0;
+    bool documentElement = false;
+
+    while (true) {
+        const QXmlStreamReader::TokenType type = reader.readNext();
+
+        if (type == QXmlStreamReader::Invalid &&
+            reader.error() == QXmlStreamReader::PrematureEndOfDocumentError &&
+            !input.atEnd()) {
+            if (writer.failed()) {
+                break;
+            }
+            const QByteArray chunk = input.read();
+            if (chunk.isEmpty()) {
+                break;
+            }
+            if (progress && !progress(input.bytesConsumed(), input.size())) {
+                output.cancel();
+                m_lastError = QString("Transform cancelled: %1").arg(inputFile);
+                return false;
+            }
+            reader.addData(chunk);
+            continue;
+        }
+
+        if (type == QXmlStreamReader::Invalid || type == QXmlStreamReader::EndDocument) {
+            break;
+        }
+
+        event.attributes.clear();
+        event.cdata = false;
+        switch (type) {
+        case QXmlStreamReader::StartDocument:
+            // The declaration's pseudo-attributes, none without one
+            event.type = ArxmlEvent::Type::StartDocument;
+            if (!reader.documentVersion().isEmpty()) {
+                event.attributes.emplace_back(QStringLiteral("version"), reader.documentVersion().toString());
+            }
+            if (!reader.documentEncoding().isEmpty()) {
+                event.attributes.emplace_back(QStringLiteral("encoding"), reader.documentEncoding().toString());
+            }
+            if (reader.hasStandaloneDeclaration()) {
+                event.attributes.emplace_back(QStringLiteral("standalone"),
+                                              reader.isStandaloneDocument() ? QStringLiteral("yes")
+                                                                            : QStringLiteral("no"));
+            }
+            break;
+        case QXmlStreamReader::StartElement:
+            event.type = ArxmlEvent::Type::StartElement;
+            event.name = reader.qualifiedName().toString();
+            for (const auto& attr : reader.attributes()) {
+                event.attributes.emplace_back(attr.qualifiedName().toString(), attr.value().toString());
+            }
+            documentElement = true;
+            ++depth;
+            break;
+        case QXmlStreamReader::EndElement:
+            event.type = ArxmlEvent::Type::EndElement;
+            event.name = reader.qualifiedName().toString();
+            --depth;
+            break;
+        case QXmlStreamReader::Characters:
+            event.type = ArxmlEvent::Type::Characters;
+            event.text = reader.text().toString();
+            event.cdata = reader.isCDATA();
+            break;
+        case QXmlStreamReader::Comment:
+            event.type = ArxmlEvent::Type::Comment;
+            event.text = reader.text().toString();
+            break;
+        case QXmlStreamReader::ProcessingInstruction:
+            event.type = ArxmlEvent::Type::ProcessingInstruction;
+            event.name = reader.processingInstructionTarget().toString();
+            event.text = reader.processingInstructionData().toString();
+            break;
+        case QXmlStreamReader::DTD:
+            event.type = ArxmlEvent::Type::Dtd;
+            event.text = reader.text().toString();
+            break;
+        default:
+            continue;
+        }
+        first->process(event);
+    }
+
+    // A failed write stops reading early; the parser state says nothing then
+    if (writer.failed()) {
+        output.cancel();
+        m_lastError = writer.errorString();
+        return false;
+    }
+    if (input.hasError()) {
+        output.cancel();
+        m_lastError = input.errorString();
+        return false;
+    }
+    // Fed incrementally, the reader reports a premature end even after a
+    // complete document (see ArxmlModel::loadFromFile)
+    if (reader.hasError() &&
+        !(reader.error() == QXmlStreamReader::PrematureEndOfDocumentError && depth == 0)) {
+        output.cancel();
+        m_lastError = QString("%1 (line %2)").arg(reader.errorString()).arg(reader.lineNumber());
+        return false;
+    }
+    if (!documentElement) {
+        output.cancel();
+        m_lastError = QString("No document element in %1").arg(inputFile);
+        return false;
+    }
+
+    event = ArxmlEvent();
+    event.type = ArxmlEvent::Type::EndDocument;
+    first->process(event);
+    for (const auto& stage : m_stages) {
+        if (!stage->finish()) {
+            output.cancel();
+            m_lastError = stage->errorString();
+            return false;
+        }
+    }
+    if (!writer.finish()) {
+        output.cancel();
+        m_lastError = writer.errorString();
+        return false;
+    }
+    if (!output.commit()) {
+        m_lastError = output.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,487 @@
+// arxml_port_index.cpp
+//
+// Struct-of-arrays index of the port prototypes of a document
+
+#include "arxml_port_index.hpp"
+#include "arxml_model.hpp"
+
+#include <QtConcurrentMap>
+#include <iterator>
+
+namespace {
+
+bool isPort(const ArxmlElement *elem)
+{
+    return elem->tagName.endsWith(QStringLiteral("PORT-PROTOTYPE"), Qt::CaseInsensitive);
+}
+
+bool hasTag(const ArxmlElement *elem, const char *tag)
+{
+    return elem->tagName.compare(QLatin1String(tag), Qt::CaseInsensitive) == 0;
+}
+
+QString shortName(const ArxmlElement *elem)
+{
+    if (elem->stub)
+        return elem->stubShortName;
+    for (const auto& child : elem->children) {
+        if (hasTag(child.get(), "SHORT-NAME")) {
+            return child->text;
+        }
+    }
+    return QString();
+}
+
+// The identifiable in an ELEMENTS list that holds elem, if any
+const ArxmlElement* ownerOf(const ArxmlElement *elem)
+{
+    for (; elem && elem->parent; elem = elem->parent) {
+        if (hasTag(elem->parent, "ELEMENTS")) {
+            return elem;
+        }
+    }
+    return nullptr;
+}
+
+// The ports in elem's subtree; stubs are skipped
+void collectPorts(const std::shared_ptr<ArxmlElement> &elem, std::vector<std::shared_ptr<ArxmlElement>> &ports)
+{
+    if (elem->stub)
+        return;
+    if (isPort(elem.get())) {
+        ports.push_back(elem);
+        return;
+    }
+    for (const auto& child : elem->children) {
+        collectPorts(child, ports);
+    }
+}
+
+std::shared_ptr<ArxmlElement> sharedElement(ArxmlElement *elem)
+{
+    if (elem->parent) {
+        for (const auto& sibling : elem->parent->children) {
+            if (sibling.get() == elem) {
+                return sibling;
+            }
+        }
+    }
+    return nullptr;
+}
+
+ArxmlPortIndex::InterfaceKind interfaceKindOf(const QString &dest)
+{
+    using Kind = ArxmlPortIndex::InterfaceKind;
+    if (dest.compare(QStringLiteral("SENDER-RECEIVER-INTERFACE"), Qt::CaseInsensitive) == 0)
+        return Kind::SenderReceiver;
+    if (dest.compare(QStringLiteral("CLIENT-SERVER-INTERFACE"), Qt::CaseInsensitive) == 0)
+        return Kind::ClientServer;
+    if (dest.compare(QStringLiteral("MODE-SWITCH-INTERFACE"), Qt::CaseInsensitive) == 0)
+        return Kind::ModeSwitch;
+    if (dest.compare(QStringLiteral("PARAMETER-INTERFACE"), Qt::CaseInsensitive) == 0)
+        return Kind::Parameter;
+    if (dest.compare(QStringLiteral("NV-DATA-INTERFACE"), Qt::CaseInsensitive) == 0)
+        return Kind::NvData;
+    if (dest.compare(QStringLiteral("TRIGGER-INTERFACE"), Qt::CaseInsensitive) == 0)
+        return Kind::Trigger;
+    return Kind::Unknown;
+}
+
+// Pool entries below which compaction is not worth it
+constexpr int MinCompactComSpecs = 1024;
+
+} // namespace
+
+void ArxmlPortIndex::Columns::append(const std::shared_ptr<ArxmlElement> &port, const ArxmlElement *owner)
+{
+    ports.push_back(port);
+    owners.push_back(owner);
+    names.push_back(shortName(port.get()));
+    // Ports sit in the PORTS list of their component type
+    const ArxmlElement *component = port->parent ? port->parent->parent : nullptr;
+    components.push_back(component ? shortName(component) : QString());
+
+    if (port->tagName.startsWith(QStringLiteral("PR-"), Qt::CaseInsensitive)) {
+        directions.push_back(Direction::ProvidedRequired);
+    } else if (port->tagName.startsWith(QStringLiteral("P-"), Qt::CaseInsensitive)) {
+        directions.push_back(Direction::Provided);
+    } else {
+        directions.push_back(Direction::Required);
+    }
+
+    QString interfaceRef;
+    InterfaceKind kind = InterfaceKind::Unknown;
+    QString summary;
+    QString summaryKind;
+    int summaryNames = 0;
+    const int begin = static_cast<int>(comSpecs.size());
+    for (const auto& child : port->children) {
+        if (child->tagName.endsWith(QStringLiteral("INTERFACE-TREF"), Qt::CaseInsensitive)) {
+            interfaceRef = child->text;
+            for (const auto& attr : child->attributes) {
+                if (attr.first.compare(QStringLiteral("DEST"), Qt::CaseInsensitive) == 0) {
+                    kind = interfaceKindOf(attr.second);
+                    break;
+                }
+            }
+        } else if (hasTag(child.get(), "PROVIDED-COM-SPECS") || hasTag(child.get(), "REQUIRED-COM-SPECS")) {
+            for (const auto& comSpec : child->children) {
+                QString dataElement;
+                for (const auto& ref : comSpec->children) {
+                    if (hasTag(ref.get(), "DATA-ELEMENT-REF") || hasTag(ref.get(), "OPERATION-REF")) {
+                        dataElement = ref->text.section(QLatin1Char('/'), -1);
+                        break;
+                    }
+                }
+                comSpecs.push_back(comSpec);
+                dataElements.push_back(dataElement);
+
+                // COM-SPECs of one kind are usually listed together
+                QString comSpecKind = comSpec->tagName;
+                if (comSpecKind.endsWith(QStringLiteral("-COM-SPEC"), Qt::CaseInsensitive)) {
+                    comSpecKind.chop(9);
+                }
+                if (comSpecKind != summaryKind) {
+                    if (!summary.isEmpty()) {
+                        summary += QStringLiteral("; ");
+                    }
+                    summary += comSpecKind;
+                    summaryKind = comSpecKind;
+                    summaryNames = 0;
+                }
+                if (!dataElement.isEmpty()) {
+                    summary += summaryNames++ == 0 ? QStringLiteral(": ") : QStringLiteral(", ");
+                    summary += dataElement;
+                }
+            }
+        }
+    }
+    interfaceRefs.push_back(interfaceRef);
+    interfaceKinds.push_back(kind);
+    comSpecSummaries.push_back(summary);
+    comSpecBegins.push_back(begin);
+    comSpecCounts.push_back(static_cast<int>(comSpecs.size()) - begin);
+}
+
+void ArxmlPortIndex::Columns::moveLast(int row)
+{
+    const size_t last = ports.size() - 1;
+    if (static_cast<size_t>(row) != last) {
+        ports[row] = std::move(ports[last]);
+        owners[row] = owners[last];
+        names[row] = std::move(names[last]);
+        components[row] = std::move(components[last]);
+        directions[row] = directions[last];
+        interfaceRefs[row] = std::move(interfaceRefs[last]);
+        interfaceKinds[row] = interfaceKinds[last];
+        comSpecSummaries[row] = std::move(comSpecSummaries[last]);
+        comSpecBegins[row] = comSpecBegins[last];
+        comSpecCounts[row] = comSpecCounts[last];
+    }
+    ports.pop_back();
+    owners.pop_back();
+    names.pop_back();
+    components.pop_back();
+    directions.pop_back();
+    interfaceRefs.pop_back();
+    interfaceKinds.pop_back();
+    comSpecSummaries.pop_back();
+    comSpecBegins.pop_back();
+    comSpecCounts.pop_back();
+}
+
+ArxmlPortIndex::ArxmlPortIndex() = default;
+
+ArxmlPortIndex::~ArxmlPortIndex() = default;
+
+void ArxmlPortIndex::clear()
+{
+    m_columns = Columns();
+    m_rows.clear();
+    m_unusedComSpecs = 0;
+    ++m_revision;
+}
+
+void ArxmlPortIndex::build(const std::shared_ptr<ArxmlElement> &root)
+{
+    clear();
+    if (!root)
+        return;
+
+    // One unit of work per identifiable in an ELEMENTS list; the packages
+    // around them are walked here
+    struct Unit
+    {
+        std::shared_ptr<ArxmlElement> elem;
+        Columns columns;
+    };
+    std::vector<Unit> units;
+    std::vector<std::shared_ptr<ArxmlElement>> stack{root};
+    while (!stack.empty()) {
+        const std::shared_ptr<ArxmlElement> elem = std::move(stack.back());
+        stack.pop_back();
+        if (elem->stub)
+            continue;
+        if (isPort(elem.get())) {
+            m_columns.append(elem, ownerOf(elem.get()));
+        } else if (hasTag(elem.get(), "ELEMENTS")) {
+            for (const auto& child : elem->children) {
+                units.push_back({child, Columns()});
+            }
+        } else {
+            stack.insert(stack.end(), elem->children.rbegin(), elem->children.rend());
+        }
+    }
+
+    QtConcurrent::blockingMap(units, [](Unit &unit) {
+        std::vector<std::shared_ptr<ArxmlElement>> ports;
+        collectPorts(unit.elem, ports);
+        for (const auto& port : ports) {
+            unit.columns.append(port, unit.elem.get());
+        }
+    });
+
+    // Concatenate in document order
+    size_t rows = m_columns.ports.size();
+    size_t pool = m_columns.comSpecs.size();
+    for (const Unit& unit : units) {
+        rows += unit.columns.ports.size();
+        pool += unit.columns.comSpecs.size();
+    }
+    Columns& all = m_columns;
+    all.ports.reserve(rows);
+    all.owners.reserve(rows);
+    all.names.reserve(rows);
+    all.components.reserve(rows);
+    all.directions.reserve(rows);
+    all.interfaceRefs.reserve(rows);
+    all.interfaceKinds.reserve(rows);
+    all.comSpecSummaries.reserve(rows);
+    all.comSpecBegins.reserve(rows);
+    all.comSpecCounts.reserve(rows);
+    all.comSpecs.reserve(pool);
+    all.dataElements.reserve(pool);
+    for (Unit& unit : units) {
+        Columns& part = unit.columns;
+        const int offset = static_cast<int>(all.comSpecs.size());
+        auto move = [](auto &to, auto &from) {
+            to.insert(to.end(), std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+        };
+        move(all.ports, part.ports);
+        move(all.owners, part.owners);
+        move(all.names, part.names);
+        move(all.components, part.components);
+        move(all.directions, part.directions);
+        move(all.interfaceRefs, part.interfaceRefs);
+        move(all.interfaceKinds, part.interfaceKinds);
+        move(all.comSpecSummaries, part.comSpecSummaries);
+        for (int begin : part.comSpecBegins) {
+            all.comSpecBegins.push_back(begin + offset);
+        }
+        move(all.comSpecCounts, part.comSpecCounts);
+        move(all.comSpecs, part.comSpecs);
+        move(all.dataElements, part.dataElements);
+    }
+
+    rebuildRowMap();
+    ++m_revision;
+}
+
+void ArxmlPortIndex::update(const ArxmlModel &model, const std::vector<ArxmlChange> &changes)
+{
+    bool removed = false;
+    for (const ArxmlChange& change : changes) {
+        const std::shared_ptr<ArxmlElement> elem = model.findElementByIndexPath(change.path);
+        if (!elem)
+            continue;
+
+        // Edits inside a port only change that port's row
+        ArxmlElement *port = elem.get();
+        while (port && !isPort(port)) {
+            port = port->parent;
+        }
+        if (port) {
+            if (auto shared = port == elem.get() ? elem : sharedElement(port)) {
+                upsert(shared);
+            }
+            continue;
+        }
+
+        switch (change.kind) {
+        case ArxmlChange::Kind::Content:
+            // A renamed component type shows in the rows of its ports
+            if (hasTag(elem.get(), "SHORT-NAME") && elem->parent) {
+                if (auto renamed = sharedElement(elem->parent)) {
+                    addSubtree(renamed);
+                }
+            }
+            break;
+        case ArxmlChange::Kind::ChildInserted:
+            if (change.index >= 0 && change.index < static_cast<int>(elem->children.size())) {
+                addSubtree(elem->children[change.index]);
+            }
+            break;
+        case ArxmlChange::Kind::ChildRemoved:
+            removed = true;
+            break;
+        case ArxmlChange::Kind::ChildrenReset:
+            removed = true;
+            addSubtree(elem);
+            break;
+        }
+    }
+
+    if (removed) {
+        pruneDetached(model.rootElement().get());
+    }
+}
+
+void ArxmlPortIndex::addSubtree(const std::shared_ptr<ArxmlElement> &elem)
+{
+    if (!elem)
+        return;
+
+    std::vector<std::shared_ptr<ArxmlElement>> ports;
+    collectPorts(elem, ports);
+    for (const auto& port : ports) {
+        upsert(port);
+    }
+}
+
+void ArxmlPortIndex::removeStubbed()
+{
+    // Going backwards, the row moved into a removed one was checked already
+    for (int row = size() - 1; row >= 0; --row) {
+        const ArxmlElement *owner = m_columns.owners[row];
+        if (owner && owner->stub) {
+            removeRow(row);
+        }
+    }
+}
+
+int ArxmlPortIndex::ensure(const std::shared_ptr<ArxmlElement> &port)
+{
+    const int existing = row(port.get());
+    if (existing >= 0)
+        return existing;
+    upsert(port);
+    return size() - 1;
+}
+
+int ArxmlPortIndex::row(const ArxmlElement *port) const
+{
+    auto it = m_rows.find(port);
+    return it != m_rows.end() ? it->second : -1;
+}
+
+QString ArxmlPortIndex::directionName(Direction direction)
+{
+    switch (direction) {
+    case Direction::Provided:
+        return QStringLiteral("Provided");
+    case Direction::Required:
+        return QStringLiteral("Required");
+    case Direction::ProvidedRequired:
+        return QStringLiteral("Provided/Required");
+    }
+    return QString();
+}
+
+QString ArxmlPortIndex::interfaceKindName(InterfaceKind kind)
+{
+    switch (kind) {
+    case InterfaceKind::SenderReceiver:
+        return QStringLiteral("Sender-Receiver");
+    case InterfaceKind::ClientServer:
+        return QStringLiteral("Client-Server");
+    case InterfaceKind::ModeSwitch:
+        return QStringLiteral("Mode-Switch");
+    case InterfaceKind::Parameter:
+        return QStringLiteral("Parameter");
+    case InterfaceKind::NvData:
+        return QStringLiteral("NV-Data");
+    case InterfaceKind::Trigger:
+        return QStringLiteral("Trigger");
+    case InterfaceKind::Unknown:
+        break;
+    }
+    return QString();
+}
+
+void ArxmlPortIndex::upsert(const std::shared_ptr<ArxmlElement> &port)
+{
+    ++m_revision;
+    m_columns.append(port, ownerOf(port.get()));
+
+    auto it = m_rows.find(port.get());
+    if (it == m_rows.end()) {
+        m_rows.emplace(port.get(), size() - 1);
+        return;
+    }
+
+    // Replace the old row by the one just appended; its COM-SPECs stay in
+    // the pool until the next compaction
+    m_unusedComSpecs += m_columns.comSpecCounts[it->second];
+    m_columns.moveLast(it->second);
+    compactComSpecs();
+}
+
+void ArxmlPortIndex::removeRow(int row)
+{
+    ++m_revision;
+    m_unusedComSpecs += m_columns.comSpecCounts[row];
+    m_rows.erase(m_columns.ports[row].get());
+    const int last = size() - 1;
+    if (row != last) {
+        m_rows[m_columns.ports[last].get()] = row;
+    }
+    m_columns.moveLast(row);
+    compactComSpecs();
+}
+
+void ArxmlPortIndex::pruneDetached(const ArxmlElement *root)
+{
+    // Removed subtrees are still alive (held by undo commands), so their
+    // parent chains can be followed
+    for (int row = size() - 1; row >= 0; --row) {
+        const ArxmlElement *top = m_columns.ports[row].get();
+        while (top->parent) {
+            top = top->parent;
+        }
+        if (top != root) {
+            removeRow(row);
+        }
+    }
+}
+
+void ArxmlPortIndex::compactComSpecs()
+{
+    const int pool = static_cast<int>(m_columns.comSpecs.size());
+    if (m_unusedComSpecs < MinCompactComSpecs || m_unusedComSpecs * 2 < pool)
+        return;
+
+    std::vector<std::shared_ptr<ArxmlElement>> comSpecs;
+    std::vector<QString> dataElements;
+    comSpecs.reserve(pool - m_unusedComSpecs);
+    dataElements.reserve(pool - m_unusedComSpecs);
+    for (int row = 0; row < size(); ++row) {
+        const int begin = m_columns.comSpecBegins[row];
+        m_columns.comSpecBegins[row] = static_cast<int>(comSpecs.size());
+        for (int i = 0; i < m_columns.comSpecCounts[row]; ++i) {
+            comSpecs.push_back(std::move(m_columns.comSpecs[begin + i]));
+            dataElements.push_back(std::move(m_columns.dataElements[begin + i]));
+        }
+    }
+    m_columns.comSpecs = std::move(comSpecs);
+    m_columns.dataElements = std::move(dataElements);
+    m_unusedComSpecs = 0;
+}
+
+void ArxmlPortIndex::rebuildRowMap()
+{
+    m_rows.clear();
+    m_rows.reserve(m_columns.ports.size());
+    for (int row = 0; row < size(); ++row) {
+        m_rows.emplace(m_columns.ports[row].get(), row);
+    }
+}
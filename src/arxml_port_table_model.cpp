@@ -0,0 +1,299 @@
+// arxml_port_table_model.cpp
+//
+// Port overview table model over ArxmlPortIndex
+
+#include "arxml_port_table_model.hpp"
+#include "arxml_port_index.hpp"
+
+#include <QStringView>
+#include <QtConcurrentRun>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// Interface name without its package, without copying it
+QStringView lastPathPart(const QString &reference)
+{
+    return QStringView(reference).mid(reference.lastIndexOf(QLatin1Char('/')) + 1);
+}
+
+QString columnText(const ArxmlPortIndex &index, int column, int row)
+{
+    switch (column) {
+    case ArxmlPortTableModel::ComponentColumn:
+        return index.component(row);
+    case ArxmlPortTableModel::PortColumn:
+        return index.name(row);
+    case ArxmlPortTableModel::DirectionColumn:
+        return ArxmlPortIndex::directionName(index.direction(row));
+    case ArxmlPortTableModel::InterfaceColumn:
+        return index.interfaceRef(row);  // Full reference; shown by its last part
+    case ArxmlPortTableModel::KindColumn:
+        return ArxmlPortIndex::interfaceKindName(index.interfaceKind(row));
+    case ArxmlPortTableModel::ComSpecColumn:
+        return index.comSpecSummary(row);
+    default:
+        return QString();
+    }
+}
+
+// The columns a query needs, taken on the GUI thread
+struct QuerySnapshot
+{
+    int rowCount = 0;
+    std::vector<QString> columns[ArxmlPortTableModel::ColumnCount];  // Only those sorted or filtered by
+    QStringList filters;
+    int sortColumn = -1;
+    Qt::SortOrder sortOrder = Qt::AscendingOrder;
+
+    QStringView text(int column, int row) const
+    {
+        const QString& value = columns[column][row];
+        return column == ArxmlPortTableModel::InterfaceColumn ? lastPathPart(value) : QStringView(value);
+    }
+};
+
+std::vector<int> runQuery(const QuerySnapshot &snapshot)
+{
+    std::vector<int> rows;
+    rows.reserve(snapshot.rowCount);
+    for (int row = 0; row < snapshot.rowCount; ++row) {
+        bool match = true;
+        for (int column = 0; column < snapshot.filters.size() && match; ++column) {
+            const QString& filter = snapshot.filters[column];
+            match = filter.isEmpty() || snapshot.text(column, row).contains(filter, Qt::CaseInsensitive);
+        }
+        if (match) {
+            rows.push_back(row);
+        }
+    }
+
+    // Ties keep index order
+    if (snapshot.sortColumn >= 0) {
+        const int column = snapshot.sortColumn;
+        const bool ascending = snapshot.sortOrder == Qt::AscendingOrder;
+        std::stable_sort(rows.begin(), rows.end(), [&snapshot, column, ascending](int a, int b) {
+            const int result = snapshot.text(column, a).compare(snapshot.text(column, b), Qt::CaseInsensitive);
+            return ascending ? result < 0 : result > 0;
+        });
+    }
+    return rows;
+}
+
+} // namespace
+
+ArxmlPortTableModel::ArxmlPortTableModel(const ArxmlPortIndex *index, QObject *parent)
+    : QAbstractTableModel(parent),
+      m_index(index),
+      m_revision(index->revision())
+{
+    for (int column = 0; column < ColumnCount; ++column) {
+        m_filters << QString();
+    }
+    connect(&m_queryWatcher, &QFutureWatcher<QueryResult>::finished, this, &ArxmlPortTableModel::onQueryFinished);
+    startQuery(true);
+}
+
+ArxmlPortTableModel::~ArxmlPortTableModel()
+{
+    m_queryWatcher.waitForFinished();
+}
+
+void ArxmlPortTableModel::refresh()
+{
+    if (m_revision == m_index->revision())
+        return;
+    m_revision = m_index->revision();
+
+    // Removing a port moves another one into its index row: follow each
+    // shown port to its row now and drop those that are gone, so until the
+    // query is in every row still shows the port it showed before
+    std::vector<int> rows;
+    std::vector<std::weak_ptr<ArxmlElement>> ports;
+    rows.reserve(m_rows.size());
+    ports.reserve(m_ports.size());
+    for (const std::weak_ptr<ArxmlElement>& weak : m_ports) {
+        const std::shared_ptr<ArxmlElement> port = weak.lock();
+        const int row = port ? m_index->row(port.get()) : -1;
+        if (row >= 0) {
+            rows.push_back(row);
+            ports.push_back(weak);
+        }
+    }
+    if (rows.size() != m_rows.size()) {
+        beginResetModel();
+        m_rows = std::move(rows);
+        m_ports = std::move(ports);
+        endResetModel();
+    } else {
+        m_rows = std::move(rows);
+    }
+    startQuery(true);
+}
+
+void ArxmlPortTableModel::setFilter(int column, const QString &text)
+{
+    if (column < 0 || column >= ColumnCount || m_filters[column] == text)
+        return;
+    m_filters[column] = text;
+    startQuery(true);
+}
+
+std::shared_ptr<ArxmlElement> ArxmlPortTableModel::portAt(int row) const
+{
+    if (row < 0 || row >= static_cast<int>(m_rows.size()) || m_rows[row] >= m_index->size())
+        return nullptr;
+    return m_index->port(m_rows[row]);
+}
+
+int ArxmlPortTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(m_rows.size());
+}
+
+int ArxmlPortTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant ArxmlPortTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= static_cast<int>(m_rows.size()))
+        return QVariant();
+
+    const int row = m_rows[index.row()];
+    if (row >= m_index->size())
+        return QVariant();
+
+    if (role == Qt::DisplayRole) {
+        if (index.column() == InterfaceColumn) {
+            return lastPathPart(m_index->interfaceRef(row)).toString();
+        }
+        return columnText(*m_index, index.column(), row);
+    }
+    if (role == Qt::ToolTipRole && index.column() == InterfaceColumn) {
+        return m_index->interfaceRef(row);
+    }
+    return QVariant();
+}
+
+QVariant ArxmlPortTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QVariant();
+
+    switch (section) {
+    case ComponentColumn:
+        return tr("SWC");
+    case PortColumn:
+        return tr("Port");
+    case DirectionColumn:
+        return tr("Direction");
+    case InterfaceColumn:
+        return tr("Interface");
+    case KindColumn:
+        return tr("Kind");
+    case ComSpecColumn:
+        return tr("ComSpecs");
+    default:
+        return QVariant();
+    }
+}
+
+void ArxmlPortTableModel::sort(int column, Qt::SortOrder order)
+{
+    if (column == m_sortColumn && order == m_sortOrder)
+        return;
+    m_sortColumn = column;
+    m_sortOrder = order;
+    startQuery(false);
+}
+
+void ArxmlPortTableModel::startQuery(bool rowSetChanged)
+{
+    m_rowSetChanged = m_rowSetChanged || rowSetChanged;
+    const quint64 generation = ++m_queryGeneration;  // Drops the result of a running query
+
+    const bool filtered = std::any_of(m_filters.begin(), m_filters.end(),
+                                      [](const QString& filter) { return !filter.isEmpty(); });
+    if (!filtered && m_sortColumn < 0) {
+        // Index order needs no worker
+        std::vector<int> rows(m_index->size());
+        std::iota(rows.begin(), rows.end(), 0);
+        applyRows(std::move(rows));
+        return;
+    }
+
+    auto snapshot = std::make_shared<QuerySnapshot>();
+    snapshot->rowCount = m_index->size();
+    snapshot->filters = m_filters;
+    snapshot->sortColumn = m_sortColumn;
+    snapshot->sortOrder = m_sortOrder;
+    for (int column = 0; column < ColumnCount; ++column) {
+        if (m_filters[column].isEmpty() && column != m_sortColumn)
+            continue;
+        std::vector<QString>& values = snapshot->columns[column];
+        values.reserve(snapshot->rowCount);
+        for (int row = 0; row < snapshot->rowCount; ++row) {
+            values.push_back(columnText(*m_index, column, row));
+        }
+    }
+
+    m_queryWatcher.setFuture(QtConcurrent::run([snapshot, generation]() {
+        return QueryResult{generation, runQuery(*snapshot)};
+    }));
+}
+
+void ArxmlPortTableModel::onQueryFinished()
+{
+    QueryResult result = m_queryWatcher.result();
+    if (result.generation != m_queryGeneration)
+        return;  // Superseded; the newer query is on its way
+    applyRows(std::move(result.rows));
+}
+
+void ArxmlPortTableModel::applyRows(std::vector<int> rows)
+{
+    if (rows == m_rows) {
+        // Same rows in the same order; only their content may have changed
+        if (!m_rows.empty()) {
+            emit dataChanged(index(0, 0), index(rowCount() - 1, ColumnCount - 1));
+        }
+    } else if (m_rowSetChanged) {
+        beginResetModel();
+        m_rows = std::move(rows);
+        recordPorts();
+        endResetModel();
+    } else {
+        // Reordered only: persistent indexes (selection, current row)
+        // follow their port
+        emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+        const QModelIndexList before = persistentIndexList();
+        std::vector<int> position(m_index->size(), -1);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            position[rows[i]] = static_cast<int>(i);
+        }
+        QModelIndexList after;
+        after.reserve(before.size());
+        for (const QModelIndex& old : before) {
+            const int row = position[m_rows[old.row()]];
+            after << (row >= 0 ? createIndex(row, old.column()) : QModelIndex());
+        }
+        m_rows = std::move(rows);
+        recordPorts();
+        changePersistentIndexList(before, after);
+        emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+    }
+    m_rowSetChanged = false;
+    emit queryFinished(rowCount(), m_index->size());
+}
+
+void ArxmlPortTableModel::recordPorts()
+{
+    m_ports.clear();
+    m_ports.reserve(m_rows.size());
+    for (int row : m_rows) {
+        m_ports.push_back(m_index->port(row));
+    }
+}
@@ -0,0 +1,165 @@
+// arxml_property_table_model.cpp
+//
+// Property table model over the attributes and text of an ArxmlElement
+
+#include "arxml_property_table_model.hpp"
+#include "arxml_model.hpp"
+
+#include <QStringView>
+
+ArxmlPropertyTableModel::ArxmlPropertyTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+void ArxmlPropertyTableModel::setElement(const std::shared_ptr<ArxmlElement> &elem)
+{
+    if (elem == m_element) {
+        refresh();
+        return;
+    }
+
+    beginResetModel();
+    m_element = elem;
+    m_attributeCount = elem ? static_cast<int>(elem->attributes.size()) : 0;
+    m_hasTextRow = elem && !elem->text.isEmpty();
+    m_textExpanded = false;
+    endResetModel();
+}
+
+void ArxmlPropertyTableModel::refresh()
+{
+    if (!m_element)
+        return;
+
+    const int attributeCount = static_cast<int>(m_element->attributes.size());
+    const bool hasTextRow = m_hasTextRow || !m_element->text.isEmpty();
+    if (attributeCount != m_attributeCount || hasTextRow != m_hasTextRow) {
+        beginResetModel();
+        m_attributeCount = attributeCount;
+        m_hasTextRow = hasTextRow;
+        endResetModel();
+        return;
+    }
+    if (rowCount() > 0) {
+        emit dataChanged(index(0, 0), index(rowCount() - 1, ColumnCount - 1));
+    }
+}
+
+bool ArxmlPropertyTableModel::isTextRow(int row) const
+{
+    return m_hasTextRow && row == m_attributeCount;
+}
+
+bool ArxmlPropertyTableModel::isLongText() const
+{
+    const QString& text = m_element->text;
+    return text.size() > ElideLength || text.contains(QLatin1Char('\n'));
+}
+
+bool ArxmlPropertyTableModel::isTextElided() const
+{
+    return m_hasTextRow && !m_textExpanded && isLongText();
+}
+
+void ArxmlPropertyTableModel::setTextExpanded(bool expanded)
+{
+    if (expanded == m_textExpanded)
+        return;
+    m_textExpanded = expanded;
+    if (m_hasTextRow) {
+        emit dataChanged(index(m_attributeCount, ValueColumn), index(m_attributeCount, ValueColumn));
+    }
+}
+
+int ArxmlPropertyTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_attributeCount + (m_hasTextRow ? 1 : 0);
+}
+
+int ArxmlPropertyTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant ArxmlPropertyTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!m_element || !index.isValid() || index.row() >= rowCount())
+        return QVariant();
+
+    // Attributes may have been removed by an edit not refreshed yet
+    if (!isTextRow(index.row()) && index.row() >= static_cast<int>(m_element->attributes.size()))
+        return QVariant();
+
+    if (role == Qt::DisplayRole || role == Qt::EditRole) {
+        if (!isTextRow(index.row())) {
+            const auto& attr = m_element->attributes[index.row()];
+            return index.column() == PropertyColumn ? attr.first : attr.second;
+        }
+        if (index.column() == PropertyColumn)
+            return tr("Text");
+        if (!isTextElided())
+            return m_element->text;
+
+        // First line, cut to ElideLength characters; the text itself is
+        // not copied
+        QStringView text(m_element->text);
+        const qsizetype lineEnd = text.indexOf(QLatin1Char('\n'));
+        QStringView shown = text.left(qMin<qsizetype>(lineEnd < 0 ? text.size() : lineEnd, ElideLength));
+        return tr("%1 [%n character(s)]", nullptr, static_cast<int>(text.size()))
+            .arg(shown.toString() + QChar(0x2026));
+    }
+    if (role == Qt::ToolTipRole && isTextRow(index.row()) && index.column() == ValueColumn && isTextElided()) {
+        return tr("Double-click to show all %n character(s)", nullptr, static_cast<int>(m_element->text.size()));
+    }
+    return QVariant();
+}
+
+QVariant ArxmlPropertyTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QVariant();
+
+    switch (section) {
+    case PropertyColumn:
+        return tr("Property");
+    case ValueColumn:
+        return tr("Value");
+    default:
+        return QVariant();
+    }
+}
+
+Qt::ItemFlags ArxmlPropertyTableModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+
+    Qt::ItemFlags result = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    // An elided text is not edited, it would be replaced by what is shown
+    if (index.column() == ValueColumn && !(isTextRow(index.row()) && isTextElided())) {
+        result |= Qt::ItemIsEditable;
+    }
+    return result;
+}
+
+bool ArxmlPropertyTableModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!m_element || role != Qt::EditRole || !(flags(index) & Qt::ItemIsEditable))
+        return false;
+
+    const QString newValue = value.toString();
+    if (isTextRow(index.row())) {
+        if (newValue == m_element->text)
+            return false;
+        emit textEdited(newValue);
+    } else {
+        if (index.row() >= static_cast<int>(m_element->attributes.size()))
+            return false;
+        const auto& attr = m_element->attributes[index.row()];
+        if (newValue == attr.second)
+            return false;
+        emit attributeEdited(attr.first, newValue);
+    }
+    return true;
+}
@@ -0,0 +1,306 @@
+// arxml_rule_engine.cpp
+//
+// Shared rule index, built-in AUTOSAR semantic rules and the concurrent
+// rule runner.
+
+#include "arxml_rule_engine.hpp"
+#include "arxml_model.hpp"
+
+#include <QtConcurrentMap>
+#include <algorithm>
+
+namespace {
+
+// Candidates are handed to the thread pool in chunks of this size so that
+// large rules spread over all cores without one task per element
+constexpr size_t RuleChunkSize = 512;
+
+bool isReferenceTag(const QString &tagName)
+{
+    return tagName.endsWith(QLatin1String("-REF")) || tagName.endsWith(QLatin1String("-TREF"));
+}
+
+const ArxmlElement *childWithTag(const ArxmlElement *elem, const QString &tagName)
+{
+    for (const auto& child : elem->children) {
+        if (child->tagName == tagName) {
+            return child.get();
+        }
+    }
+    return nullptr;
+}
+
+// Every *-REF / *-TREF with an absolute path must resolve, and to an element
+// of the type named by its DEST attribute
+class ReferenceIntegrityRule : public ArxmlRule
+{
+public:
+    QString name() const override { return QStringLiteral("reference-integrity"); }
+
+    std::vector<const ArxmlElement*> candidates(const ArxmlRuleIndex &index) const override
+    {
+        return index.references();
+    }
+
+    void checkElement(const ArxmlRuleIndex &index, const ArxmlElement *elem,
+                      std::vector<ArxmlFinding> &findings) const override
+    {
+        const QString target = elem->text.trimmed();
+        const ArxmlElement *resolved = index.resolve(target);
+        if (!resolved) {
+            findings.push_back(makeFinding(index, elem,
+                QStringLiteral("%1 '%2' cannot be resolved").arg(elem->tagName, target)));
+            return;
+        }
+
+        const QString dest = elem->getAttribute(QStringLiteral("DEST"));
+        if (!dest.isEmpty() && resolved->tagName != dest) {
+            findings.push_back(makeFinding(index, elem,
+                QStringLiteral("%1 '%2' points to a %3, expected %4")
+                    .arg(elem->tagName, target, resolved->tagName, dest)));
+        }
+    }
+};
+
+// SHORT-NAMEs must be unique within their package (i.e. AUTOSAR paths unique)
+class UniqueShortNameRule : public ArxmlRule
+{
+public:
+    QString name() const override { return QStringLiteral("unique-short-name"); }
+
+    std::vector<const ArxmlElement*> candidates(const ArxmlRuleIndex &index) const override
+    {
+        return index.duplicatePaths();
+    }
+
+    void checkElement(const ArxmlRuleIndex &index, const ArxmlElement *elem,
+                      std::vector<ArxmlFinding> &findings) const override
+    {
+        const QString path = index.pathOf(elem);
+        const ArxmlElement *first = index.resolve(path);
+        findings.push_back(makeFinding(index, elem,
+            QStringLiteral("SHORT-NAME '%1' of %2 is already used by a %3 at %4")
+                .arg(ArxmlRuleIndex::shortName(elem), elem->tagName,
+                     first ? first->tagName : QString(), path)));
+    }
+};
+
+// DATA-ELEMENT-REF / OPERATION-REF in a port's COM-SPEC must name an element
+// of the interface the port is typed by
+class ComSpecInterfaceRule : public ArxmlRule
+{
+public:
+    QString name() const override { return QStringLiteral("comspec-interface"); }
+
+    std::vector<const ArxmlElement*> candidates(const ArxmlRuleIndex &index) const override
+    {
+        std::vector<const ArxmlElement*> ports;
+        for (const char *tag : {"P-PORT-PROTOTYPE", "R-PORT-PROTOTYPE", "PR-PORT-PROTOTYPE"}) {
+            const auto& tagged = index.elementsWithTag(QLatin1String(tag));
+            ports.insert(ports.end(), tagged.begin(), tagged.end());
+        }
+        return ports;
+    }
+
+    void checkElement(const ArxmlRuleIndex &index, const ArxmlElement *elem,
+                      std::vector<ArxmlFinding> &findings) const override
+    {
+        const ArxmlElement *interfaceRef = childWithTag(elem, QStringLiteral("PROVIDED-INTERFACE-TREF"));
+        if (!interfaceRef) {
+            interfaceRef = childWithTag(elem, QStringLiteral("REQUIRED-INTERFACE-TREF"));
+        }
+        if (!interfaceRef) {
+            return;
+        }
+        // Unresolvable interfaces are reported by reference-integrity
+        const ArxmlElement *interfaceElem = index.resolve(interfaceRef->text.trimmed());
+        if (!interfaceElem) {
+            return;
+        }
+
+        for (const auto& comSpecs : elem->children) {
+            if (comSpecs->tagName != QLatin1String("PROVIDED-COM-SPECS") &&
+                comSpecs->tagName != QLatin1String("REQUIRED-COM-SPECS")) {
+                continue;
+            }
+            for (const auto& comSpec : comSpecs->children) {
+                for (const auto& ref : comSpec->children) {
+                    if (ref->tagName != QLatin1String("DATA-ELEMENT-REF") &&
+                        ref->tagName != QLatin1String("OPERATION-REF")) {
+                        continue;
+                    }
+                    const ArxmlElement *target = index.resolve(ref->text.trimmed());
+                    // DATA-ELEMENTS / OPERATIONS sit directly below the interface
+                    if (target && (!target->parent || target->parent->parent != interfaceElem)) {
+                        findings.push_back(makeFinding(index, ref.get(),
+                            QStringLiteral("%1 '%2' in %3 is not part of interface '%4'")
+                                .arg(ref->tagName, ref->text.trimmed(), comSpec->tagName,
+                                     index.pathOf(interfaceElem))));
+                    }
+                }
+            }
+        }
+    }
+};
+
+} // namespace
+
+ArxmlRuleIndex::ArxmlRuleIndex(const ArxmlModel &model, const std::function<bool()> &cancelled)
+    : m_model(model)
+{
+    const auto root = model.rootElement();
+    if (!root) {
+        return;
+    }
+
+    // Iterative pre-order walk carrying the AUTOSAR path of the nearest
+    // identifiable ancestor, so all lists come out in document order
+    std::vector<std::pair<const ArxmlElement*, QString>> stack;
+    stack.emplace_back(root.get(), QString());
+    while (!stack.empty()) {
+        if (cancelled && cancelled()) {
+            return;
+        }
+        const ArxmlElement *elem = stack.back().first;
+        QString path = std::move(stack.back().second);
+        stack.pop_back();
+
+        m_byTag[elem->tagName].push_back(elem);
+
+        const QString name = shortName(elem);
+        if (!name.isEmpty()) {
+            path += QLatin1Char('/');
+            path += name;
+            if (m_byPath.contains(path)) {
+                m_duplicates.push_back(elem);
+            } else {
+                m_byPath.insert(path, elem);
+            }
+            m_pathOf.insert(elem, path);
+        }
+
+        if (isReferenceTag(elem->tagName) && elem->text.trimmed().startsWith(QLatin1Char('/'))) {
+            m_references.push_back(elem);
+        }
+
+        for (auto it = elem->children.rbegin(); it != elem->children.rend(); ++it) {
+            stack.emplace_back(it->get(), path);
+        }
+    }
+}
+
+const ArxmlElement *ArxmlRuleIndex::resolve(const QString &autosarPath) const
+{
+    return m_byPath.value(autosarPath, nullptr);
+}
+
+QString ArxmlRuleIndex::pathOf(const ArxmlElement *elem) const
+{
+    for (const ArxmlElement *current = elem; current; current = current->parent) {
+        auto it = m_pathOf.constFind(current);
+        if (it != m_pathOf.constEnd()) {
+            return it.value();
+        }
+    }
+    return QStringLiteral("/");
+}
+
+const std::vector<const ArxmlElement*> &ArxmlRuleIndex::elementsWithTag(const QString &tagName) const
+{
+    static const std::vector<const ArxmlElement*> empty;
+    auto it = m_byTag.constFind(tagName);
+    return it != m_byTag.constEnd() ? it.value() : empty;
+}
+
+QString ArxmlRuleIndex::shortName(const ArxmlElement *elem)
+{
+    const ArxmlElement *shortNameElem = childWithTag(elem, QStringLiteral("SHORT-NAME"));
+    return shortNameElem ? shortNameElem->text.trimmed() : QString();
+}
+
+ArxmlFinding ArxmlRule::makeFinding(const ArxmlRuleIndex &index, const ArxmlElement *elem,
+                                    const QString &message, ArxmlFinding::Severity severity) const
+{
+    ArxmlFinding finding;
+    finding.severity = severity;
+    finding.rule = name();
+    finding.message = message;
+    finding.path = index.pathOf(elem);
+    finding.indexPath = index.model().getElementIndexPath(elem);
+    return finding;
+}
+
+ArxmlRuleEngine::ArxmlRuleEngine()
+{
+    addRule(std::make_unique<ReferenceIntegrityRule>());
+    addRule(std::make_unique<UniqueShortNameRule>());
+    addRule(std::make_unique<ComSpecInterfaceRule>());
+}
+
+ArxmlRuleEngine::~ArxmlRuleEngine() = default;
+
+void ArxmlRuleEngine::addRule(std::unique_ptr<ArxmlRule> rule)
+{
+    m_rules.push_back(std::move(rule));
+}
+
+bool ArxmlRuleEngine::run(const ArxmlModel &model, quint64 editGeneration,
+                          std::vector<ArxmlFinding> &findings) const
+{
+    findings.clear();
+    const ArxmlModel::ReadAccess access(model, editGeneration);
+    auto cancelled = [&access]() { return access.cancelled(); };
+    if (cancelled()) {
+        return false;
+    }
+    if (!model.rootElement()) {
+        return true;
+    }
+
+    // Built once, then only read by all rules
+    const ArxmlRuleIndex index(model, cancelled);
+    if (cancelled()) {
+        return false;
+    }
+
+    struct Task
+    {
+        const ArxmlRule *rule = nullptr;
+        std::vector<const ArxmlElement*> elements;
+        std::vector<ArxmlFinding> findings;
+    };
+
+    std::vector<Task> tasks;
+    for (const auto& rule : m_rules) {
+        const std::vector<const ArxmlElement*> candidates = rule->candidates(index);
+        for (size_t begin = 0; begin < candidates.size(); begin += RuleChunkSize) {
+            const size_t end = std::min(begin + RuleChunkSize, candidates.size());
+            Task task;
+            task.rule = rule.get();
+            task.elements.assign(candidates.begin() + begin, candidates.begin() + end);
+            tasks.push_back(std::move(task));
+        }
+    }
+
+    // The tasks read the model under this thread's access; an edit waits
+    // for them, so each one checks for it between elements
+    QtConcurrent::blockingMap(tasks, [&index, &cancelled](Task &task) {
+        for (const ArxmlElement *elem : task.elements) {
+            if (cancelled()) {
+                return;
+            }
+            task.rule->checkElement(index, elem, task.findings);
+        }
+    });
+    if (cancelled()) {
+        return false;
+    }
+
+    // Tasks were created in rule and document order, keep that order
+    for (Task& task : tasks) {
+        findings.insert(findings.end(),
+                        std::make_move_iterator(task.findings.begin()),
+                        std::make_move_iterator(task.findings.end()));
+    }
+    return true;
+}
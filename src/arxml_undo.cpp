@@ -0,0 +1,177 @@
+// arxml_undo.cpp
+//
+// Undo commands for ArxmlModel edits
+
+#include "arxml_undo.hpp"
+
+ArxmlEditCommand::ArxmlEditCommand(ArxmlModel *model, const QList<int> &path, const QString &text)
+    : QUndoCommand(text)
+    , m_model(model)
+    , m_path(path)
+{
+}
+
+std::shared_ptr<ArxmlElement> ArxmlEditCommand::element() const
+{
+    return m_model->findElementByIndexPath(m_path);
+}
+
+ArxmlSetTextCommand::ArxmlSetTextCommand(ArxmlModel *model, const QList<int> &path, const QString &text,
+                                         const QString &description)
+    : ArxmlEditCommand(model, path, description)
+    , m_newText(text)
+{
+    if (auto elem = element()) {
+        m_oldText = elem->text;
+    }
+}
+
+void ArxmlSetTextCommand::redo()
+{
+    apply(m_newText);
+}
+
+void ArxmlSetTextCommand::undo()
+{
+    apply(m_oldText);
+}
+
+void ArxmlSetTextCommand::apply(const QString &text)
+{
+    auto elem = element();
+    if (!elem) {
+        setObsolete(true);
+        return;
+    }
+    m_model->setText(elem, text);
+}
+
+ArxmlSetAttributeCommand::ArxmlSetAttributeCommand(ArxmlModel *model, const QList<int> &path,
+                                                   const QString &name, const QString &value,
+                                                   const QString &description)
+    : ArxmlEditCommand(model, path, description)
+    , m_name(name)
+    , m_newValue(value)
+{
+    if (auto elem = element()) {
+        for (const auto& attr : elem->attributes) {
+            if (attr.first == name) {
+                m_oldValue = attr.second;
+                m_existed = true;
+                break;
+            }
+        }
+    }
+}
+
+void ArxmlSetAttributeCommand::redo()
+{
+    auto elem = element();
+    if (!elem) {
+        setObsolete(true);
+        return;
+    }
+    m_model->setAttribute(elem, m_name, m_newValue);
+}
+
+void ArxmlSetAttributeCommand::undo()
+{
+    auto elem = element();
+    if (!elem) {
+        setObsolete(true);
+        return;
+    }
+    if (m_existed) {
+        m_model->setAttribute(elem, m_name, m_oldValue);
+    } else {
+        m_model->removeAttribute(elem, m_name);
+    }
+}
+
+ArxmlInsertElementCommand::ArxmlInsertElementCommand(ArxmlModel *model, const QList<int> &parentPath,
+                                                     int index, const ArxmlModel::DetachedElement &element,
+                                                     const QString &description)
+    : ArxmlEditCommand(model, parentPath, description)
+    , m_index(index)
+    , m_element(element)
+{
+}
+
+void ArxmlInsertElementCommand::redo()
+{
+    auto parent = element();
+    if (!parent) {
+        setObsolete(true);
+        return;
+    }
+    if (m_index < 0) {
+        m_index = static_cast<int>(parent->children.size());
+    }
+    if (!m_model->insertChild(parent, m_index, m_element)) {
+        setObsolete(true);
+        return;
+    }
+    m_element = ArxmlModel::DetachedElement();  // The document owns it now
+}
+
+void ArxmlInsertElementCommand::undo()
+{
+    auto parent = element();
+    if (!parent || !m_model->removeChild(parent, m_index, m_element)) {
+        setObsolete(true);
+    }
+}
+
+ArxmlRemoveElementCommand::ArxmlRemoveElementCommand(ArxmlModel *model, const QList<int> &parentPath,
+                                                     int index, const QString &description)
+    : ArxmlEditCommand(model, parentPath, description)
+    , m_index(index)
+{
+}
+
+void ArxmlRemoveElementCommand::redo()
+{
+    auto parent = element();
+    if (!parent || !m_model->removeChild(parent, m_index, m_removed)) {
+        setObsolete(true);
+    }
+}
+
+void ArxmlRemoveElementCommand::undo()
+{
+    auto parent = element();
+    if (!parent || !m_model->insertChild(parent, m_index, m_removed)) {
+        setObsolete(true);
+        return;
+    }
+    m_removed = ArxmlModel::DetachedElement();
+}
+
+ArxmlBatchCommand::ArxmlBatchCommand(const QString &text)
+    : QUndoCommand(text)
+{
+}
+
+void ArxmlBatchCommand::add(std::unique_ptr<QUndoCommand> command)
+{
+    command->redo();
+    m_commands.push_back(std::move(command));
+}
+
+void ArxmlBatchCommand::redo()
+{
+    if (m_applied) {
+        m_applied = false;
+        return;
+    }
+    for (const auto& command : m_commands) {
+        command->redo();
+    }
+}
+
+void ArxmlBatchCommand::undo()
+{
+    for (auto it = m_commands.rbegin(); it != m_commands.rend(); ++it) {
+        (*it)->undo();
+    }
+}
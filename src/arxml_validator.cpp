@@ -4,45 +4,686 @@
 
 #include "arxml_validator.hpp"
 #include "arxml_model.hpp"
+#include "arxml_writer.hpp"
 
-#include <QTemporaryFile>
 #include <QProcess>
-#include <QDir>
+#include <QElapsedTimer>
 #include <QFileInfo>
+#include <QFuture>
+#include <QRegularExpression>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+#include <algorithm>
+
+namespace {
+
+QString shortNameOf(const ArxmlElement& elem)
+{
+    for (const auto& child : elem.children) {
+        if (child->tagName == QLatin1String("SHORT-NAME")) {
+            return child->text;
+        }
+    }
+    return QString();
+}
+
+// Dirty units are collected into batch documents of about this size, each
+// checked by one xmllint process
+constexpr qsizetype ValidationBatchSize = 4 * 1024 * 1024;
+// Time one xmllint process may take for a batch
+constexpr int XmllintTimeoutMs = 60000;
+// A running xmllint process is checked for cancellation this often
+constexpr int XmllintPollMs = 100;
+// While all xmllint slots are busy, edits are checked for this often
+constexpr int SlotPollMs = 20;
+
+struct ValidationUnit
+{
+    std::shared_ptr<const ArxmlElement> elem;
+    bool header = false;    // Written without the content of its containers
+    quint64 revision = 0;
+    size_t context = 0;     // Hash of the enclosing start tags and package names
+    QString label;
+    QList<int> indexPath;
+    int firstLine = 0;      // Line of its batch document where the unit starts
+    bool failed = false;    // xmllint did not run properly; not cached
+    QString errors;
+};
+
+// Children of a header unit that are units of their own: the AR-PACKAGES of
+// the root, the ELEMENTS and AR-PACKAGES of a package
+bool isContainer(const ArxmlElement &child, bool underRoot)
+{
+    return child.tagName == QLatin1String("AR-PACKAGES")
+        || (!underRoot && child.tagName == QLatin1String("ELEMENTS"));
+}
+
+size_t startTagHash(const ArxmlElement &elem, size_t seed)
+{
+    size_t hash = qHashMulti(seed, elem.tagName);
+    for (const auto& attr : elem.attributes) {
+        hash = qHashMulti(hash, attr.first, attr.second);
+    }
+    return hash;
+}
+
+// Collect the units of header (the root or an AR-PACKAGE) and everything
+// nested in its containers, in document order. context covers the enclosing
+// start tags; path is the index path of header. Returns false if the model
+// was changed meanwhile.
+bool collectUnits(const ArxmlModel::ReadAccess &access, const std::shared_ptr<ArxmlElement> &header,
+                  bool isRoot, size_t context, const QString &packagePath, QList<int> &path,
+                  std::vector<ValidationUnit> &units)
+{
+    if (access.cancelled()) {
+        return false;
+    }
+
+    const size_t headerIndex = units.size();
+    units.push_back({header, true, 0, context, isRoot ? header->tagName : packagePath, path});
+
+    // Units nested in a package are written inside its start tag and
+    // SHORT-NAME, both are part of their context
+    size_t frame = startTagHash(*header, context);
+    if (!isRoot) {
+        frame = qHashMulti(frame, shortNameOf(*header));
+    }
+
+    quint64 revision = header->revision;
+    for (size_t i = 0; i < header->children.size(); ++i) {
+        const auto& container = header->children[i];
+        if (!isContainer(*container, isRoot)) {
+            revision = qMax(revision, container->subtreeRevision);
+            continue;
+        }
+        // The container's own start tag and child list belong to the header
+        revision = qMax(revision, container->revision);
+        const size_t inner = startTagHash(*container, frame);
+        const bool packages = container->tagName == QLatin1String("AR-PACKAGES");
+        path.append(static_cast<int>(i));
+        for (size_t j = 0; j < container->children.size(); ++j) {
+            const auto& member = container->children[j];
+            path.append(static_cast<int>(j));
+            const QString shortName = shortNameOf(*member);
+            const QString memberPath = packagePath + QLatin1Char('/')
+                                     + (shortName.isEmpty() ? member->tagName : shortName);
+            if (packages && member->tagName == QLatin1String("AR-PACKAGE")) {
+                if (!collectUnits(access, member, false, inner, memberPath, path, units)) {
+                    return false;
+                }
+            } else {
+                if (access.cancelled()) {
+                    return false;
+                }
+                units.push_back({member, false, member->subtreeRevision, inner, memberPath, path});
+            }
+            path.removeLast();
+        }
+        path.removeLast();
+    }
+    units[headerIndex].revision = revision;
+    return true;
+}
+
+// Batch document of dirty units. Each unit is nested in the start tags of
+// its enclosing elements (with the SHORT-NAME of packages); these frames are
+// shared by consecutive units and closed when a unit outside them follows.
+class UnitBatch
+{
+public:
+    UnitBatch()
+    {
+        m_writer.writeDeclaration();
+    }
+
+    bool isEmpty() const { return m_units.empty(); }
+    qsizetype size() const { return m_document.size() + m_writer.size(); }
+
+    // Write units[index] and record the line it starts on
+    void add(std::vector<ValidationUnit> &units, int index)
+    {
+        ValidationUnit &unit = units[index];
+        std::vector<const ArxmlElement*> chain;
+        for (const ArxmlElement *parent = unit.elem->parent; parent; parent = parent->parent) {
+            chain.push_back(parent);
+        }
+        std::reverse(chain.begin(), chain.end());
+
+        size_t shared = 0;
+        while (shared < m_frames.size() && shared < chain.size() && m_frames[shared] == chain[shared]) {
+            ++shared;
+        }
+        closeFrames(shared);
+
+        // Messages up to here belong to the previous unit
+        takeOutput();
+        unit.firstLine = m_lines + 1;
+        m_units.push_back(index);
+        m_firstLines.push_back(unit.firstLine);
+
+        for (size_t i = shared; i < chain.size(); ++i) {
+            const ArxmlElement *frame = chain[i];
+            const int depth = static_cast<int>(i);
+            m_writer.writeStartTag(*frame, depth);
+            if (frame->tagName == QLatin1String("AR-PACKAGE")) {
+                for (const auto& child : frame->children) {
+                    if (child->tagName == QLatin1String("SHORT-NAME")) {
+                        m_writer.writeElement(*child, depth + 1);
+                        break;
+                    }
+                }
+            }
+            m_frames.push_back(frame);
+        }
+
+        const int depth = static_cast<int>(chain.size());
+        if (!unit.header) {
+            m_writer.writeElement(*unit.elem, depth);
+            return;
+        }
+        // Containers are left empty, their content consists of other units
+        const bool isRoot = !unit.elem->parent;
+        m_writer.writeStartTag(*unit.elem, depth);
+        for (const auto& child : unit.elem->children) {
+            if (isContainer(*child, isRoot)) {
+                m_writer.writeStartTag(*child, depth + 1);
+                m_writer.writeEndTag(*child, depth + 1);
+            } else {
+                m_writer.writeElement(*child, depth + 1);
+            }
+        }
+        m_writer.writeEndTag(*unit.elem, depth);
+    }
+
+    // Complete the document; the batch can be reused afterwards
+    QByteArray finish(std::vector<int> &unitIndices, std::vector<int> &firstLines)
+    {
+        closeFrames(0);
+        takeOutput();
+        QByteArray document = std::move(m_document);
+        unitIndices.swap(m_units);
+        firstLines.swap(m_firstLines);
+        m_document = QByteArray();
+        m_units.clear();
+        m_firstLines.clear();
+        m_lines = 0;
+        m_writer.writeDeclaration();
+        return document;
+    }
+
+private:
+    void closeFrames(size_t keep)
+    {
+        while (m_frames.size() > keep) {
+            m_writer.writeEndTag(*m_frames.back(), static_cast<int>(m_frames.size()) - 1);
+            m_frames.pop_back();
+        }
+    }
+
+    void takeOutput()
+    {
+        const QByteArray data = m_writer.takeData();
+        m_lines += static_cast<int>(data.count('\n'));
+        m_document += data;
+    }
+
+    ArxmlWriter m_writer{ArxmlWriter::Format::Pretty};
+    QByteArray m_document;
+    int m_lines = 0;  // Complete lines in m_document
+    std::vector<const ArxmlElement*> m_frames;
+    std::vector<int> m_units;
+    std::vector<int> m_firstLines;
+};
+
+struct XmllintResult
+{
+    int exitCode = -1;
+    QString output;
+};
+
+struct PendingBatch
+{
+    std::vector<int> units;       // Indices into the unit list, by first line
+    std::vector<int> firstLines;
+    QFuture<XmllintResult> result;
+};
+
+// Hand the messages of a batch to its units. "-:LINE:" prefixes become
+// "label:line:" with the line counted from the start of the unit; lines
+// without a location continue the message before them.
+void assignMessages(const PendingBatch &batch, const XmllintResult &result, std::vector<ValidationUnit> &units)
+{
+    static const QRegularExpression location(QStringLiteral("^-:(\\d+):"));
+
+    ValidationUnit *current = nullptr;
+    QString unassigned;
+    for (const QString& line : result.output.split(QLatin1Char('\n'), Qt::SkipEmptyParts)) {
+        if (line == QLatin1String("- validates") || line == QLatin1String("- fails to validate")) {
+            continue;
+        }
+        const QRegularExpressionMatch match = location.match(line);
+        if (match.hasMatch()) {
+            const int number = match.captured(1).toInt();
+            auto it = std::upper_bound(batch.firstLines.begin(), batch.firstLines.end(), number);
+            const size_t owner = it == batch.firstLines.begin() ? 0 : (it - batch.firstLines.begin()) - 1;
+            current = &units[batch.units[owner]];
+            current->errors += QStringLiteral("%1:%2:").arg(current->label).arg(qMax(1, number - current->firstLine + 1));
+            current->errors += QStringView(line).mid(match.capturedLength());
+            current->errors += QLatin1Char('\n');
+        } else if (current) {
+            current->errors += line + QLatin1Char('\n');
+        } else {
+            unassigned += line + QLatin1Char('\n');
+        }
+    }
+
+    if (result.exitCode != 0 && !current) {
+        // xmllint failed as a whole (not started, timed out, unusable
+        // schema); the units are checked again next time
+        for (int index : batch.units) {
+            units[index].failed = true;
+        }
+        ValidationUnit &first = units[batch.units.front()];
+        first.errors = unassigned.isEmpty()
+                     ? QStringLiteral("%1: xmllint failed with exit code %2\n").arg(first.label).arg(result.exitCode)
+                     : unassigned;
+    }
+}
+
+// A broken document can produce a problem per node; stop listing after this
+constexpr int MaxWellFormednessErrors = 100;
+constexpr char32_t InvalidCodePoint = 0xFFFFFFFF;
+
+bool isNameStartChar(char32_t c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':'
+        || (c >= 0xC0 && c <= 0xD6) || (c >= 0xD8 && c <= 0xF6) || (c >= 0xF8 && c <= 0x2FF)
+        || (c >= 0x370 && c <= 0x37D) || (c >= 0x37F && c <= 0x1FFF) || (c >= 0x200C && c <= 0x200D)
+        || (c >= 0x2070 && c <= 0x218F) || (c >= 0x2C00 && c <= 0x2FEF) || (c >= 0x3001 && c <= 0xD7FF)
+        || (c >= 0xF900 && c <= 0xFDCF) || (c >= 0xFDF0 && c <= 0xFFFD) || (c >= 0x10000 && c <= 0xEFFFF);
+}
+
+bool isNameChar(char32_t c)
+{
+    return isNameStartChar(c) || c == '-' || c == '.' || (c >= '0' && c <= '9') || c == 0xB7
+        || (c >= 0x300 && c <= 0x36F) || (c >= 0x203F && c <= 0x2040);
+}
+
+bool isXmlChar(char32_t c)
+{
+    return c == 0x9 || c == 0xA || c == 0xD || (c >= 0x20 && c <= 0xD7FF)
+        || (c >= 0xE000 && c <= 0xFFFD) || (c >= 0x10000 && c <= 0x10FFFF);
+}
+
+// Decode the code point at i and advance past it. Unpaired surrogates are
+// returned as InvalidCodePoint.
+char32_t nextCodePoint(QStringView text, qsizetype &i)
+{
+    const QChar c = text[i++];
+    if (c.isHighSurrogate()) {
+        if (i < text.size() && text[i].isLowSurrogate()) {
+            return QChar::surrogateToUcs4(c, text[i++]);
+        }
+        return InvalidCodePoint;
+    }
+    if (c.isLowSurrogate()) {
+        return InvalidCodePoint;
+    }
+    return c.unicode();
+}
+
+bool isValidName(QStringView name)
+{
+    if (name.isEmpty()) {
+        return false;
+    }
+    qsizetype i = 0;
+    if (!isNameStartChar(nextCodePoint(name, i))) {
+        return false;
+    }
+    while (i < name.size()) {
+        if (!isNameChar(nextCodePoint(name, i))) {
+            return false;
+        }
+    }
+    // Namespace-aware names allow at most one colon, between prefix and local part
+    const qsizetype colon = name.indexOf(QLatin1Char(':'));
+    return colon < 0 || (colon > 0 && colon < name.size() - 1
+                         && name.indexOf(QLatin1Char(':'), colon + 1) < 0);
+}
+
+// Offset of the first character that may not appear in XML content, or -1
+qsizetype findIllegalChar(QStringView text)
+{
+    const qsizetype size = text.size();
+    for (qsizetype i = 0; i < size;) {
+        // Almost all ARXML content is below the surrogate range and above the
+        // control characters, so only the rare remainder is decoded
+        const char16_t unit = text[i].unicode();
+        if (unit >= 0x20 && unit < 0xD800) {
+            ++i;
+            continue;
+        }
+        const qsizetype at = i;
+        if (!isXmlChar(nextCodePoint(text, i))) {
+            return at;
+        }
+    }
+    return -1;
+}
+
+QString prefixOf(const QString &name)
+{
+    const qsizetype colon = name.indexOf(QLatin1Char(':'));
+    return colon > 0 ? name.left(colon) : QString();
+}
+
+QString elementPath(const ArxmlElement *elem)
+{
+    QStringList segments;
+    for (const ArxmlElement *current = elem; current; current = current->parent) {
+        const QString shortName = shortNameOf(*current);
+        segments.prepend(shortName.isEmpty() ? current->tagName
+                                             : QStringLiteral("%1[%2]").arg(current->tagName, shortName));
+    }
+    return QStringLiteral("/") + segments.join(QLatin1Char('/'));
+}
+
+} // namespace
 
 QString ArxmlValidator::validate(const ArxmlModel &model, const QString &schemaFile) const
 {
-    // Write the current document to a temporary file
-    QTemporaryFile tmpFile(QDir::tempPath() + QLatin1String("/arxml_validateXXXXXX.arxml"));
-    if (!tmpFile.open()) {
-        return QStringLiteral("Failed to create temporary file for validation.");
+    // Serialize in memory and pipe the document to xmllint; indented output
+    // keeps the line numbers in its messages meaningful
+    const QString label = model.filePath().isEmpty() ? QStringLiteral("document")
+                                                     : QFileInfo(model.filePath()).fileName();
+    QString errors;
+    if (runXmllint(model.toByteArray(ArxmlWriter::Format::Pretty), schemaFile, errors) == 0) {
+        return QString();
     }
-    tmpFile.close();
+    if (errors.isEmpty()) {
+        return QStringLiteral("Unknown validation error.");
+    }
+    // xmllint calls stdin "-", name the document instead
+    static const QRegularExpression stdinName(QStringLiteral("^-(?=[: ])"),
+                                              QRegularExpression::MultilineOption);
+    errors.replace(stdinName, label);
+    return errors;
+}
+
+bool ArxmlValidator::validateIncremental(const ArxmlModel &model, const QString &schemaFile,
+                                         quint64 editGeneration, std::vector<UnitErrors> &errors)
+{
+    errors.clear();
+    m_cancelled = false;
+    std::vector<ValidationUnit> units;
+    // The processes get threads of their own: this run may itself occupy
+    // the global pool. A slot per process bounds the batches held in memory.
+    QThreadPool xmllintPool;
+    xmllintPool.setMaxThreadCount(QThread::idealThreadCount());
+    QSemaphore slots(xmllintPool.maxThreadCount());
+    std::vector<PendingBatch> batches;
+    bool cancelled = false;
+
+    {
+        ArxmlModel::ReadAccess access(model, editGeneration);
+        const auto root = model.rootElement();
+        if (access.cancelled()) {
+            return false;
+        }
+        if (!root) {
+            return true;
+        }
+
+        // Cached results are only meaningful for the same document and schema
+        if (root.get() != m_cachedRoot || schemaFile != m_cachedSchema) {
+            clearCache();
+            m_cachedRoot = root.get();
+            m_cachedSchema = schemaFile;
+        }
+
+        QList<int> path;
+        cancelled = !collectUnits(access, root, true, 0, QString(), path, units);
 
-    // Save model to temp file
-    if (!model.saveToFile(tmpFile.fileName())) {
-        return QStringLiteral("Failed to write document to temporary file.");
+        // Start an xmllint process for the batch once a slot is free; the
+        // model is not needed for that, but edits must not wait for a slot
+        UnitBatch batch;
+        auto launch = [&]() {
+            while (!slots.tryAcquire(1, SlotPollMs)) {
+                if (access.cancelled() || m_cancelled) {
+                    return false;
+                }
+            }
+            PendingBatch pending;
+            const QByteArray document = batch.finish(pending.units, pending.firstLines);
+            const std::atomic<bool> *stop = &m_cancelled;
+            pending.result = QtConcurrent::run(&xmllintPool, [document, schemaFile, &slots, stop]() {
+                XmllintResult result;
+                result.exitCode = runXmllint(document, schemaFile, result.output, stop);
+                slots.release();
+                return result;
+            });
+            batches.push_back(std::move(pending));
+            return true;
+        };
+
+        for (size_t i = 0; i < units.size() && !cancelled; ++i) {
+            if (m_cancelled) {
+                cancelled = true;
+                break;
+            }
+            ValidationUnit &unit = units[i];
+            auto it = m_unitResults.constFind(unit.elem.get());
+            if (it != m_unitResults.constEnd() && it->revision == unit.revision && it->context == unit.context
+                && it->element.lock() == unit.elem) {
+                unit.errors = it->errors;
+                continue;
+            }
+            if (access.cancelled()) {
+                cancelled = true;
+                break;
+            }
+            batch.add(units, static_cast<int>(i));
+            if (batch.size() >= ValidationBatchSize) {
+                cancelled = !launch();
+            }
+        }
+        if (!cancelled && !batch.isEmpty()) {
+            cancelled = !launch();
+        }
+    }
+
+    // The batches no longer read the model; the ones started are waited for
+    // even when cancelled, they use the pool and semaphore on this stack
+    for (PendingBatch& batch : batches) {
+        assignMessages(batch, batch.result.result(), units);
+    }
+    if (cancelled || m_cancelled) {
+        // What was checked still holds for the revisions it was taken at
+        for (const PendingBatch& batch : batches) {
+            for (int index : batch.units) {
+                const ValidationUnit& unit = units[index];
+                if (!unit.failed) {
+                    m_unitResults.insert(unit.elem.get(),
+                                         UnitResult{unit.elem, unit.revision, unit.context, unit.errors});
+                }
+            }
+        }
+        return false;
+    }
+
+    // Results of units that no longer exist (deleted elements) are dropped by
+    // only keeping the entries of this run
+    m_unitResults.clear();
+    for (ValidationUnit& unit : units) {
+        if (!unit.failed) {
+            m_unitResults.insert(unit.elem.get(), UnitResult{unit.elem, unit.revision, unit.context, unit.errors});
+        }
+        if (!unit.errors.isEmpty()) {
+            errors.push_back({unit.label, unit.indexPath, unit.errors});
+        }
+    }
+    return true;
+}
+
+void ArxmlValidator::clearCache()
+{
+    m_unitResults.clear();
+    m_cachedRoot = nullptr;
+    m_cachedSchema.clear();
+}
+
+bool ArxmlValidator::checkWellFormed(const ArxmlModel &model, quint64 editGeneration, QString &result) const
+{
+    result.clear();
+    ArxmlModel::ReadAccess access(model, editGeneration);
+    const auto root = model.rootElement();
+    if (access.cancelled()) {
+        return false;
+    }
+    if (!root) {
+        return true;
+    }
+
+    QStringList errors;
+    auto report = [&errors](const ArxmlElement *elem, const QString &problem) {
+        if (errors.size() < MaxWellFormednessErrors) {
+            errors << QStringLiteral("%1: %2").arg(elementPath(elem), problem);
+        }
+    };
+
+    // Prefixes declared on the current path, tagged with the declaring depth
+    struct Binding
+    {
+        int depth;
+        QString prefix;
+    };
+    std::vector<Binding> bindings;
+    auto isBound = [&bindings](const QString &prefix) {
+        if (prefix == QLatin1String("xml")) {
+            return true;
+        }
+        for (auto it = bindings.rbegin(); it != bindings.rend(); ++it) {
+            if (it->prefix == prefix) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Iterative pre-order walk; no serialization and no second model
+    std::vector<std::pair<const ArxmlElement*, int>> stack;
+    stack.emplace_back(root.get(), 0);
+    while (!stack.empty() && errors.size() < MaxWellFormednessErrors) {
+        if (access.cancelled()) {
+            return false;
+        }
+        const auto [elem, depth] = stack.back();
+        stack.pop_back();
+
+        // Leaving the subtrees of earlier siblings ends their declarations
+        while (!bindings.empty() && bindings.back().depth >= depth) {
+            bindings.pop_back();
+        }
+
+        if (!isValidName(elem->tagName)) {
+            report(elem, QStringLiteral("invalid element name '%1'").arg(elem->tagName));
+        }
+
+        // Declarations first, they are in scope for the element's own names
+        for (size_t i = 0; i < elem->attributes.size(); ++i) {
+            const auto& attr = elem->attributes[i];
+            if (!isValidName(attr.first)) {
+                report(elem, QStringLiteral("invalid attribute name '%1'").arg(attr.first));
+            }
+            for (size_t j = 0; j < i; ++j) {
+                if (elem->attributes[j].first == attr.first) {
+                    report(elem, QStringLiteral("duplicate attribute '%1'").arg(attr.first));
+                    break;
+                }
+            }
+            const qsizetype bad = findIllegalChar(attr.second);
+            if (bad >= 0) {
+                report(elem, QStringLiteral("illegal character U+%1 in attribute '%2'")
+                                 .arg(uint(attr.second[bad].unicode()), 4, 16, QLatin1Char('0'))
+                                 .arg(attr.first));
+            }
+            if (prefixOf(attr.first) == QLatin1String("xmlns")) {
+                const QString prefix = attr.first.mid(6);
+                if (prefix == QLatin1String("xmlns") || prefix == QLatin1String("xml")) {
+                    report(elem, QStringLiteral("reserved prefix '%1' cannot be declared").arg(prefix));
+                } else if (attr.second.isEmpty()) {
+                    report(elem, QStringLiteral("prefix '%1' is bound to an empty namespace").arg(prefix));
+                }
+                bindings.push_back({depth, prefix});
+            }
+        }
+
+        const QString elemPrefix = prefixOf(elem->tagName);
+        if (!elemPrefix.isEmpty() && !isBound(elemPrefix)) {
+            report(elem, QStringLiteral("undeclared namespace prefix '%1'").arg(elemPrefix));
+        }
+        for (const auto& attr : elem->attributes) {
+            const QString attrPrefix = prefixOf(attr.first);
+            if (!attrPrefix.isEmpty() && attrPrefix != QLatin1String("xmlns") && !isBound(attrPrefix)) {
+                report(elem, QStringLiteral("undeclared namespace prefix '%1' on attribute '%2'")
+                                 .arg(attrPrefix, attr.first));
+            }
+        }
+
+        const qsizetype bad = findIllegalChar(elem->text);
+        if (bad >= 0) {
+            report(elem, QStringLiteral("illegal character U+%1 in text")
+                             .arg(uint(elem->text[bad].unicode()), 4, 16, QLatin1Char('0')));
+        }
+
+        // Push in reverse so children are visited in document order
+        for (auto it = elem->children.rbegin(); it != elem->children.rend(); ++it) {
+            stack.emplace_back(it->get(), depth + 1);
+        }
+    }
+
+    if (errors.size() >= MaxWellFormednessErrors) {
+        errors << QStringLiteral("... further problems not listed.");
     }
+    result = errors.join(QLatin1Char('\n'));
+    return true;
+}
 
-    // Prepare arguments for xmllint
+int ArxmlValidator::runXmllint(const QByteArray &document, const QString &schemaFile, QString &errors,
+                               const std::atomic<bool> *cancelled)
+{
+    // Prepare arguments for xmllint; "-" reads the document from stdin
     QStringList args;
-    args << "--noout" << "--schema" << schemaFile << tmpFile.fileName();
+    args << "--noout" << "--schema" << schemaFile << "-";
 
     QProcess process;
     process.start("xmllint", args);
-    if (!process.waitForFinished(10000)) {
-        return QStringLiteral("xmllint did not finish within the timeout.");
+    if (!process.waitForStarted()) {
+        errors = QStringLiteral("xmllint could not be started.");
+        return -1;
     }
+    process.write(document);
+    process.closeWriteChannel();
 
-    const QByteArray stderrOutput = process.readAllStandardError();
-    
-    // A zero exit code indicates success. If non-zero, return stderr or a
-    // generic error message.
-    if (process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0) {
-        return QString();
+    QElapsedTimer elapsed;
+    elapsed.start();
+    while (process.state() != QProcess::NotRunning && !process.waitForFinished(XmllintPollMs)) {
+        const bool stop = cancelled && *cancelled;
+        if (stop || elapsed.hasExpired(XmllintTimeoutMs)) {
+            process.kill();
+            process.waitForFinished();
+            errors = stop ? QStringLiteral("Validation cancelled.")
+                          : QStringLiteral("xmllint did not finish within the timeout.");
+            return -1;
+        }
     }
-    if (!stderrOutput.isEmpty()) {
-        return QString::fromUtf8(stderrOutput);
+
+    errors = QString::fromUtf8(process.readAllStandardError());
+    if (process.exitStatus() != QProcess::NormalExit) {
+        return -1;
     }
-    return QStringLiteral("Unknown validation error.");
+    return process.exitCode();
 }
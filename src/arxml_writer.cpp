@@ -0,0 +1,504 @@
+// arxml_writer.cpp
+//
+// UTF-8 serializer implementation with an SSE2 fast path for escaping.
+
+#include "arxml_writer.hpp"
+#include "arxml_model.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARXML_WRITER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Worst case output per UTF-16 unit: "&quot;" (UTF-8 itself needs at most 3)
+constexpr qsizetype MaxBytesPerUnit = 6;
+
+// Long values are escaped in pieces so the reserved tail stays small
+constexpr qsizetype EscapeChunkSize = 64 * 1024;
+
+template <size_t N>
+inline char *putLiteral(char *dst, const char (&literal)[N])
+{
+    std::memcpy(dst, literal, N - 1);
+    return dst + N - 1;
+}
+
+using Escaping = ArxmlWriter::Escaping;
+
+// Escape and encode the code point at src and advance past it. end bounds
+// the look-ahead for the low half of a surrogate pair.
+inline char *putChar(char *dst, const char16_t *&src, const char16_t *end, Escaping escaping)
+{
+    const bool attribute = escaping == Escaping::Attribute;
+    const char16_t c = *src++;
+    if (c < 0x80) {
+        if (escaping == Escaping::None) {
+            *dst++ = static_cast<char>(c);
+            return dst;
+        }
+        switch (c) {
+        case u'<': return putLiteral(dst, "&lt;");
+        case u'>': return putLiteral(dst, "&gt;");
+        case u'&': return putLiteral(dst, "&amp;");
+        case u'\r': return putLiteral(dst, "&#13;");
+        case u'"': if (attribute) return putLiteral(dst, "&quot;"); break;
+        case u'\n': if (attribute) return putLiteral(dst, "&#10;"); break;
+        case u'\t': if (attribute) return putLiteral(dst, "&#9;"); break;
+        default: break;
+        }
+        *dst++ = static_cast<char>(c);
+        return dst;
+    }
+
+    char32_t cp = c;
+    if (QChar::isSurrogate(c)) {
+        if (QChar::isHighSurrogate(c) && src != end && QChar::isLowSurrogate(*src)) {
+            cp = QChar::surrogateToUcs4(c, *src++);
+        } else {
+            cp = QChar::ReplacementCharacter;  // Unpaired surrogate
+        }
+    }
+
+    if (cp < 0x800) {
+        *dst++ = static_cast<char>(0xC0 | (cp >> 6));
+    } else if (cp < 0x10000) {
+        *dst++ = static_cast<char>(0xE0 | (cp >> 12));
+        *dst++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    } else {
+        *dst++ = static_cast<char>(0xF0 | (cp >> 18));
+        *dst++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        *dst++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    }
+    *dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+    return dst;
+}
+
+// Encode (and escape) from src up to stop, one unit further if a surrogate
+// pair straddles it, and advance src accordingly. Returns the new end of the
+// output.
+char *encodeUtf8(char *dst, const char16_t *&src, const char16_t *stop, const char16_t *end,
+                 Escaping escaping)
+{
+#ifdef ARXML_WRITER_SSE2
+    const __m128i nonAsciiBits = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lt = _mm_set1_epi16('<');
+    const __m128i gt = _mm_set1_epi16('>');
+    const __m128i amp = _mm_set1_epi16('&');
+    const __m128i cr = _mm_set1_epi16('\r');
+    const __m128i quot = _mm_set1_epi16('"');
+    const __m128i lf = _mm_set1_epi16('\n');
+    const __m128i tab = _mm_set1_epi16('\t');
+
+    while (stop - src >= 8) {
+        const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        __m128i special = zero;
+        if (escaping != Escaping::None) {
+            special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(units, lt), _mm_cmpeq_epi16(units, gt)),
+                                   _mm_or_si128(_mm_cmpeq_epi16(units, amp), _mm_cmpeq_epi16(units, cr)));
+        }
+        if (escaping == Escaping::Attribute) {
+            special = _mm_or_si128(special, _mm_or_si128(_mm_cmpeq_epi16(units, quot),
+                                                         _mm_or_si128(_mm_cmpeq_epi16(units, lf),
+                                                                      _mm_cmpeq_epi16(units, tab))));
+        }
+        const __m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(units, nonAsciiBits), zero);
+
+        if (_mm_movemask_epi8(ascii) == 0xFFFF && _mm_movemask_epi8(special) == 0) {
+            // Eight plain ASCII characters: narrow to bytes and store at once
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(dst), _mm_packus_epi16(units, units));
+            dst += 8;
+            src += 8;
+            continue;
+        }
+
+        // Something in this block needs escaping or multi-byte encoding
+        const char16_t *blockEnd = src + 8;
+        while (src < blockEnd) {
+            dst = putChar(dst, src, end, escaping);
+        }
+    }
+#endif
+
+    while (src < stop) {
+        dst = putChar(dst, src, end, escaping);
+    }
+    return dst;
+}
+
+} // namespace
+
+ArxmlWriter::ArxmlWriter(Format format)
+    : m_format(format)
+{
+}
+
+void ArxmlWriter::reserve(qsizetype size)
+{
+    if (size > m_buffer.size()) {
+        m_buffer.resize(size);
+    }
+}
+
+void ArxmlWriter::setSource(const char *data, qint64 size)
+{
+    m_source = data;
+    m_sourceSize = size;
+}
+
+void ArxmlWriter::setSink(std::function<void(const QByteArray &data)> sink, qsizetype flushSize)
+{
+    m_sink = std::move(sink);
+    m_flushSize = flushSize;
+}
+
+void ArxmlWriter::setSnapshot(ArxmlSnapshotReader *reader)
+{
+    m_reader = reader;
+}
+
+void ArxmlWriter::setSourceShift(qint64 shift)
+{
+    m_sourceShift = shift;
+}
+
+void ArxmlWriter::setSpans(std::vector<Span> *spans)
+{
+    m_spans = spans;
+    m_openSpans.clear();
+}
+
+void ArxmlWriter::flush()
+{
+    // The sink may block; edits of the snapshot must not wait for it
+    if (m_reader) {
+        m_reader->pause();
+    }
+    if (m_sink && m_size > 0) {
+        // The sink consumes the bytes right away, so the buffer is reused
+        m_sink(QByteArray::fromRawData(m_buffer.constData(), m_size));
+        m_written += m_size;
+        m_size = 0;
+    }
+}
+
+void ArxmlWriter::writeDeclaration()
+{
+    static const char declaration[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+    writeBytes(declaration, sizeof(declaration) - 1);
+    writeNewline();
+}
+
+void ArxmlWriter::writeElement(const ArxmlElement &element, int depth)
+{
+    // Through a snapshot an element may only be read until the next one is
+    // looked up, so the children are listed and the tag name kept first
+    const ArxmlElement &elem = m_reader ? m_reader->get(element) : element;
+    const size_t span = beginSpan(element, depth);
+    if (elem.stub) {
+        writeStub(elem, depth, span);
+        return;
+    }
+
+    writeOpenTag(elem, depth);
+
+    if (!elem.children.empty()) {
+        writeBytes(">", 1);
+        const qint64 startTagEnd = position();
+        writeNewline();
+        const QString tagName = elem.tagName;
+        const qint64 shift = elem.sourceShift;
+        const std::vector<ArxmlMarkup> markup = elem.markup;
+        const size_t first = m_children.size();
+        for (const auto& child : elem.children) {
+            m_children.push_back(child.get());
+        }
+        const size_t last = m_children.size();
+        m_sourceShift += shift;
+        for (size_t i = first; i < last; ++i) {
+            writeMarkup(markup, i - first, depth + 1);
+            writeElement(*m_children[i], depth + 1);
+        }
+        m_sourceShift -= shift;
+        m_children.resize(first);
+        writeMarkup(markup, last - first, depth + 1);
+        const qint64 tailBegin = takeLeadBegin();
+        writeIndent(depth);
+        writeTagClose(tagName);
+        writeNewline();
+        endSpan(span, startTagEnd, tailBegin);
+    } else if (!elem.text.isEmpty() || !elem.markup.empty()) {
+        // Text-only elements stay on one line, markup after the text
+        writeBytes(">", 1);
+        const qint64 startTagEnd = position();
+        if (!elem.text.isEmpty()) {
+            writeText(elem.text, elem.cdata);
+        }
+        for (const ArxmlMarkup& token : elem.markup) {
+            writeMarkupToken(token);
+        }
+        writeTagClose(elem.tagName);
+        writeNewline();
+        endSpan(span, startTagEnd, startTagEnd);
+    } else {
+        writeBytes("/>", 2);
+        const qint64 end = position();
+        writeNewline();
+        endSpan(span, end, end);
+    }
+
+    if (m_sink && m_size >= m_flushSize) {
+        flush();
+    }
+}
+
+void ArxmlWriter::writeStub(const ArxmlElement &elem, int depth, size_t span)
+{
+    const qint64 begin = elem.sourceBegin + m_sourceShift;
+    const qint64 end = elem.sourceEnd + m_sourceShift;
+    if (!m_source || !elem.hasSource() || begin < 0 || end > m_sourceSize) {
+        writeOpenTag(elem, depth);
+        writeBytes("/>", 2);
+        const qint64 tagEnd = position();
+        writeNewline();
+        endSpan(span, tagEnd, tagEnd);
+        return;
+    }
+
+    // The source span as written, including its own formatting. flush()
+    // lets edits in, so elem is not read after it.
+    writeIndent(depth);
+    const char *data = m_source + begin;
+    const qint64 size = end - begin;
+    const qint64 written = position();
+    const qint64 startTagEnd = written + elem.sourceStartTag;
+    const qint64 tailBegin = written + size - elem.sourceTail;
+    if (m_sink) {
+        flush();
+        m_sink(QByteArray::fromRawData(data, size));
+        m_written += size;
+    } else {
+        writeBytes(data, size);
+    }
+    writeNewline();
+    endSpan(span, startTagEnd, tailBegin);
+}
+
+void ArxmlWriter::writeStartTag(const ArxmlElement &element, int depth)
+{
+    const ArxmlElement &elem = m_reader ? m_reader->get(element) : element;
+    const size_t span = beginSpan(element, depth);
+    writeOpenTag(elem, depth);
+    writeBytes(">", 1);
+    if (m_spans) {
+        m_openSpans.emplace_back(span, position());
+    }
+    writeNewline();
+}
+
+void ArxmlWriter::writeEndTag(const ArxmlElement &element, int depth)
+{
+    const ArxmlElement &elem = m_reader ? m_reader->get(element) : element;
+    const qint64 tailBegin = takeLeadBegin();
+    writeIndent(depth);
+    writeTagClose(elem.tagName);
+    writeNewline();
+    if (m_spans && !m_openSpans.empty()) {
+        const auto [span, startTagEnd] = m_openSpans.back();
+        m_openSpans.pop_back();
+        endSpan(span, startTagEnd, tailBegin);
+    }
+}
+
+void ArxmlWriter::writeMarkup(const std::vector<ArxmlMarkup> &markup, size_t before, int depth)
+{
+    m_leadBegin = position() - newlineSize();
+    for (const ArxmlMarkup& token : markup) {
+        if (token.before == before) {
+            writeIndent(depth);
+            writeMarkupToken(token);
+            writeNewline();
+        }
+    }
+}
+
+void ArxmlWriter::writeMarkupToken(const ArxmlMarkup &token)
+{
+    if (token.kind == ArxmlMarkup::Kind::Comment) {
+        writeComment(token.text);
+    } else {
+        writeProcessingInstruction(token.text, token.data);
+    }
+}
+
+void ArxmlWriter::writeText(const QString &text, bool cdata)
+{
+    if (!cdata) {
+        writeEncoded(text, Escaping::Text);
+        return;
+    }
+
+    // "]]>" cannot appear inside a section; end the section after "]]" and
+    // start a new one for the '>'
+    const QStringView view(text);
+    writeBytes("<![CDATA[", 9);
+    qsizetype from = 0;
+    for (qsizetype at; (at = view.indexOf(QLatin1String("]]>"), from)) >= 0; from = at + 2) {
+        writeEncoded(view.mid(from, at + 2 - from), Escaping::None);
+        writeBytes("]]><![CDATA[", 12);
+    }
+    writeEncoded(view.mid(from), Escaping::None);
+    writeBytes("]]>", 3);
+}
+
+void ArxmlWriter::writeRaw(const QByteArray &data)
+{
+    writeBytes(data.constData(), data.size());
+}
+
+void ArxmlWriter::writeTagOpen(const QString &name,
+                               const std::vector<std::pair<QString, QString>> &attributes)
+{
+    writeBytes("<", 1);
+    writeEncoded(name, Escaping::Text);
+    for (const auto& attr : attributes) {
+        writeBytes(" ", 1);
+        writeEncoded(attr.first, Escaping::Text);
+        writeBytes("=\"", 2);
+        writeEncoded(attr.second, Escaping::Attribute);
+        writeBytes("\"", 1);
+    }
+}
+
+void ArxmlWriter::writeTagClose(const QString &name)
+{
+    writeBytes("</", 2);
+    writeEncoded(name, Escaping::Text);
+    writeBytes(">", 1);
+}
+
+void ArxmlWriter::writeComment(const QString &text)
+{
+    writeBytes("<!--", 4);
+    writeEncoded(text, Escaping::None);
+    writeBytes("-->", 3);
+}
+
+void ArxmlWriter::writeProcessingInstruction(const QString &target, const QString &data)
+{
+    writeBytes("<?", 2);
+    writeEncoded(target, Escaping::None);
+    if (!data.isEmpty()) {
+        writeBytes(" ", 1);
+        writeEncoded(data, Escaping::None);
+    }
+    writeBytes("?>", 2);
+}
+
+QByteArray ArxmlWriter::takeData()
+{
+    m_buffer.resize(m_size);
+    QByteArray data = std::move(m_buffer);
+    m_buffer = QByteArray();
+    m_written += m_size;
+    m_size = 0;
+    return data;
+}
+
+char *ArxmlWriter::reserveTail(qsizetype extra)
+{
+    const qsizetype needed = m_size + extra;
+    if (needed > m_buffer.size()) {
+        // Geometric growth keeps appends amortized constant
+        m_buffer.resize(std::max(needed, m_buffer.size() * 2));
+    }
+    return m_buffer.data() + m_size;
+}
+
+void ArxmlWriter::writeBytes(const char *data, qsizetype size)
+{
+    std::memcpy(reserveTail(size), data, size);
+    m_size += size;
+}
+
+void ArxmlWriter::writeIndent(int depth)
+{
+    if (m_format != Format::Pretty || depth <= 0) {
+        return;
+    }
+    const qsizetype count = qsizetype(depth) * 2;
+    std::memset(reserveTail(count), ' ', count);
+    m_size += count;
+}
+
+qint64 ArxmlWriter::indentSize(int depth) const
+{
+    return m_format == Format::Pretty && depth > 0 ? qint64(depth) * 2 : 0;
+}
+
+qint64 ArxmlWriter::newlineSize() const
+{
+    return m_format == Format::Pretty ? 1 : 0;
+}
+
+size_t ArxmlWriter::beginSpan(const ArxmlElement &elem, int depth)
+{
+    const qint64 leadBegin = takeLeadBegin();
+    if (!m_spans) {
+        return 0;
+    }
+    const qint64 begin = position() + indentSize(depth);
+    m_spans->push_back({&elem, m_sourceShift, begin, 0, quint32(begin - leadBegin), 0, 0});
+    return m_spans->size() - 1;
+}
+
+qint64 ArxmlWriter::takeLeadBegin()
+{
+    // Written in place of the source, the line break in front belongs to
+    // the lead as well
+    const qint64 leadBegin = m_leadBegin >= 0 ? m_leadBegin : position() - newlineSize();
+    m_leadBegin = -1;
+    return leadBegin;
+}
+
+void ArxmlWriter::endSpan(size_t index, qint64 startTagEnd, qint64 tailBegin)
+{
+    if (!m_spans) {
+        return;
+    }
+    Span &span = (*m_spans)[index];
+    span.end = position() - newlineSize();
+    span.startTag = quint32(startTagEnd - span.begin);
+    span.tail = quint32(span.end - tailBegin);
+}
+
+void ArxmlWriter::writeNewline()
+{
+    if (m_format == Format::Pretty) {
+        writeBytes("\n", 1);
+    }
+}
+
+void ArxmlWriter::writeOpenTag(const ArxmlElement &elem, int depth)
+{
+    writeIndent(depth);
+    writeTagOpen(elem.tagName, elem.attributes);
+}
+
+void ArxmlWriter::writeEncoded(QStringView value, Escaping escaping)
+{
+    const char16_t *src = value.utf16();
+    const char16_t *end = src + value.size();
+    while (src < end) {
+        const char16_t *stop = src + std::min<qsizetype>(end - src, EscapeChunkSize);
+        // One extra unit for a surrogate pair straddling stop
+        char *dst = reserveTail((stop - src + 1) * MaxBytesPerUnit);
+        char *written = encodeUtf8(dst, src, stop, end, escaping);
+        m_size += written - dst;
+    }
+}
@@ -0,0 +1,464 @@
+// bulk_comspec_dialog.cpp
+//
+// Bulk COM-SPEC editor: port query, preview and the values to set
+
+#include "bulk_comspec_dialog.hpp"
+#include "arxml_model.hpp"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QGridLayout>
+#include <QGroupBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QIntValidator>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QTimer>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+namespace {
+
+// Rows listed in the preview; the summary still counts all matches
+constexpr int PreviewRowLimit = 2000;
+
+const QString EndToEndPropsPath = QStringLiteral("TRANSFORMATION-COM-SPEC-PROPSS");
+const QString EndToEndPropsTag = QStringLiteral("END-TO-END-TRANSFORMATION-COM-SPEC-PROPS");
+
+QString shortName(const ArxmlElement *elem)
+{
+    if (elem->stub)
+        return elem->stubShortName;
+    for (const auto& child : elem->children) {
+        if (child->tagName.compare("SHORT-NAME", Qt::CaseInsensitive) == 0) {
+            return child->text;
+        }
+    }
+    return QString();
+}
+
+// Short-name path of the identifiables above elem
+QString parentNamePath(const ArxmlElement *elem)
+{
+    QString path;
+    for (const ArxmlElement *parent = elem->parent; parent; parent = parent->parent) {
+        const QString name = shortName(parent);
+        if (!name.isEmpty())
+            path.prepend(QLatin1Char('/') + name);
+    }
+    return path;
+}
+
+QString lastPathPart(const QString &reference)
+{
+    return reference.section(QLatin1Char('/'), -1);
+}
+
+int comSpecKind(const QString &tag)
+{
+    if (tag.compare("NONQUEUED-RECEIVER-COM-SPEC", Qt::CaseInsensitive) == 0)
+        return BulkComSpecDialog::NonqueuedReceiver;
+    if (tag.compare("QUEUED-RECEIVER-COM-SPEC", Qt::CaseInsensitive) == 0)
+        return BulkComSpecDialog::QueuedReceiver;
+    if (tag.endsWith("SENDER-COM-SPEC", Qt::CaseInsensitive))
+        return BulkComSpecDialog::Sender;
+    if (tag.compare("SERVER-COM-SPEC", Qt::CaseInsensitive) == 0)
+        return BulkComSpecDialog::Server;
+    return 0;
+}
+
+// Text of the element at tagPath below elem; found is false if it is missing
+QString childValue(const ArxmlElement *elem, const QStringList &tagPath, bool &found)
+{
+    for (const QString& tag : tagPath) {
+        const ArxmlElement *next = nullptr;
+        for (const auto& child : elem->children) {
+            if (child->tagName.compare(tag, Qt::CaseInsensitive) == 0) {
+                next = child.get();
+                break;
+            }
+        }
+        if (!next) {
+            found = false;
+            return QString();
+        }
+        elem = next;
+    }
+    found = true;
+    return elem->text;
+}
+
+// Child order of the COM-SPEC content the dialog edits (AUTOSAR schema)
+const QStringList& schemaOrder(const QString &parentTag)
+{
+    static const QStringList senderReceiver{
+        "SHORT-LABEL", "DATA-ELEMENT-REF", "NETWORK-REPRESENTATION", "HANDLE-OUT-OF-RANGE",
+        "HANDLE-OUT-OF-RANGE-STATUS", "MAX-DELTA-COUNTER-INIT", "MAX-NO-NEW-OR-REPEATED-DATA",
+        "RECEPTION-PROPS", "REPLACE-WITH", "SYNC-COUNTER-INIT", "TRANSFORMATION-COM-SPEC-PROPSS",
+        "USES-END-TO-END-PROTECTION", "ALIVE-TIMEOUT", "ENABLE-UPDATE", "FILTER", "HANDLE-DATA-STATUS",
+        "HANDLE-NEVER-RECEIVED", "HANDLE-TIMEOUT-TYPE", "INIT-VALUE", "TIMEOUT-SUBSTITUTION-VALUE",
+        "QUEUE-LENGTH"};
+    static const QStringList server{
+        "SHORT-LABEL", "OPERATION-REF", "GET-TRANSFORMATION-COM-SPEC-PROPS", "QUEUE-LENGTH",
+        "TRANSFORMATION-COM-SPEC-PROPSS"};
+    static const QStringList endToEnd{
+        "SHORT-LABEL", "DISABLE-END-TO-END-CHECK", "DISABLE-END-TO-END-STATE-MACHINE",
+        "E-2-E-PROFILE-COMPATIBILITY-PROPS-REF", "MAX-DELTA-COUNTER", "MAX-ERROR-STATE-INIT",
+        "MAX-ERROR-STATE-INVALID", "MAX-ERROR-STATE-VALID", "MAX-NO-NEW-OR-REPEATED-DATA",
+        "MIN-OK-STATE-INIT", "MIN-OK-STATE-INVALID", "MIN-OK-STATE-VALID", "SYNC-COUNTER-INIT",
+        "WINDOW-SIZE", "WINDOW-SIZE-INIT", "WINDOW-SIZE-INVALID", "WINDOW-SIZE-VALID"};
+    static const QStringList none;
+
+    if (parentTag.compare("SERVER-COM-SPEC", Qt::CaseInsensitive) == 0)
+        return server;
+    if (parentTag.compare(EndToEndPropsTag, Qt::CaseInsensitive) == 0)
+        return endToEnd;
+    if (comSpecKind(parentTag) != 0)
+        return senderReceiver;
+    return none;
+}
+
+QRegularExpression wildcard(const QString &pattern)
+{
+    const QString trimmed = pattern.trimmed();
+    return QRegularExpression::fromWildcard(trimmed.isEmpty() ? QStringLiteral("*") : trimmed,
+                                            Qt::CaseInsensitive);
+}
+
+} // namespace
+
+BulkComSpecDialog::BulkComSpecDialog(ArxmlModel *model, QWidget *parent)
+    : QDialog(parent),
+      m_model(model),
+      m_portNameEdit(new QLineEdit(QStringLiteral("*"))),
+      m_portKindCombo(new QComboBox),
+      m_interfaceEdit(new QLineEdit(QStringLiteral("*"))),
+      m_dataElementEdit(new QLineEdit(QStringLiteral("*"))),
+      m_previewTable(new QTableWidget),
+      m_summaryLabel(new QLabel),
+      m_buttons(new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel))
+{
+    setWindowTitle(tr("Bulk ComSpec Editor"));
+    resize(900, 700);
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    // Port query
+    QGroupBox *queryGroup = new QGroupBox(tr("Ports"));
+    QFormLayout *queryLayout = new QFormLayout(queryGroup);
+    m_portKindCombo->addItem(tr("Any"), QString());
+    m_portKindCombo->addItem(QStringLiteral("R-PORT-PROTOTYPE"), QStringLiteral("R-PORT-PROTOTYPE"));
+    m_portKindCombo->addItem(QStringLiteral("P-PORT-PROTOTYPE"), QStringLiteral("P-PORT-PROTOTYPE"));
+    m_portKindCombo->addItem(QStringLiteral("PR-PORT-PROTOTYPE"), QStringLiteral("PR-PORT-PROTOTYPE"));
+    m_portKindCombo->setCurrentIndex(1);
+    queryLayout->addRow(tr("Port name:"), m_portNameEdit);
+    queryLayout->addRow(tr("Port kind:"), m_portKindCombo);
+    queryLayout->addRow(tr("Interface:"), m_interfaceEdit);
+    queryLayout->addRow(tr("Data element / operation:"), m_dataElementEdit);
+    QPushButton *findButton = new QPushButton(tr("Find"));
+    queryLayout->addRow(QString(), findButton);
+    mainLayout->addWidget(queryGroup);
+
+    // Values to set, named like the fields of the Communication Spec tab
+    QHBoxLayout *valuesLayout = new QHBoxLayout;
+    QGroupBox *comSpecGroup = new QGroupBox(tr("ComSpec"));
+    comSpecGroup->setLayout(new QGridLayout);
+    const int receivers = NonqueuedReceiver | QueuedReceiver;
+    addField(comSpecGroup, tr("Alive Timeout [s]:"), {"ALIVE-TIMEOUT"}, NonqueuedReceiver, false);
+    addField(comSpecGroup, tr("Queue Length:"), {"QUEUE-LENGTH"}, QueuedReceiver | Server, false);
+    addField(comSpecGroup, tr("Enable Update:"), {"ENABLE-UPDATE"}, NonqueuedReceiver, true);
+    addField(comSpecGroup, tr("Handle Never Received:"), {"HANDLE-NEVER-RECEIVED"}, NonqueuedReceiver, true);
+    addField(comSpecGroup, tr("Uses End-to-End Protection:"), {"USES-END-TO-END-PROTECTION"},
+             Sender | receivers, true);
+    valuesLayout->addWidget(comSpecGroup, 0, Qt::AlignTop);
+
+    QGroupBox *endToEndGroup = new QGroupBox(tr("E2E Transformation (receivers)"));
+    endToEndGroup->setLayout(new QGridLayout);
+    const struct {
+        const char *label;
+        const char *tag;
+        bool boolean;
+    } endToEndFields[] = {
+        {QT_TR_NOOP("Disable End-to-End Check:"), "DISABLE-END-TO-END-CHECK", true},
+        {QT_TR_NOOP("Max Delta Counter:"), "MAX-DELTA-COUNTER", false},
+        {QT_TR_NOOP("Max Error State Init:"), "MAX-ERROR-STATE-INIT", false},
+        {QT_TR_NOOP("Max Error State Invalid:"), "MAX-ERROR-STATE-INVALID", false},
+        {QT_TR_NOOP("Max Error State Valid:"), "MAX-ERROR-STATE-VALID", false},
+        {QT_TR_NOOP("Min Ok State Init:"), "MIN-OK-STATE-INIT", false},
+        {QT_TR_NOOP("Min Ok State Invalid:"), "MIN-OK-STATE-INVALID", false},
+        {QT_TR_NOOP("Min Ok State Valid:"), "MIN-OK-STATE-VALID", false},
+        {QT_TR_NOOP("Sync Counter Init:"), "SYNC-COUNTER-INIT", false},
+    };
+    for (const auto& field : endToEndFields) {
+        addField(endToEndGroup, tr(field.label),
+                 {EndToEndPropsPath, EndToEndPropsTag, QString::fromLatin1(field.tag)}, receivers, field.boolean);
+    }
+    valuesLayout->addWidget(endToEndGroup, 0, Qt::AlignTop);
+    valuesLayout->addStretch();
+    mainLayout->addLayout(valuesLayout);
+
+    // Preview
+    m_previewTable->setColumnCount(4);
+    m_previewTable->setHorizontalHeaderLabels({tr("Port"), tr("ComSpec"), tr("Data Element"), tr("Changes")});
+    m_previewTable->horizontalHeader()->setStretchLastSection(true);
+    m_previewTable->verticalHeader()->setVisible(false);
+    m_previewTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_previewTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    mainLayout->addWidget(m_previewTable, 1);
+    mainLayout->addWidget(m_summaryLabel);
+
+    m_buttons->button(QDialogButtonBox::Ok)->setText(tr("Apply"));
+    mainLayout->addWidget(m_buttons);
+
+    connect(findButton, &QPushButton::clicked, this, &BulkComSpecDialog::runQuery);
+    connect(m_portNameEdit, &QLineEdit::returnPressed, this, &BulkComSpecDialog::runQuery);
+    connect(m_interfaceEdit, &QLineEdit::returnPressed, this, &BulkComSpecDialog::runQuery);
+    connect(m_dataElementEdit, &QLineEdit::returnPressed, this, &BulkComSpecDialog::runQuery);
+    connect(m_buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(m_buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    // Once shown, so the owner is connected to pageScanned() by then
+    QTimer::singleShot(0, this, &BulkComSpecDialog::runQuery);
+}
+
+BulkComSpecDialog::~BulkComSpecDialog() = default;
+
+void BulkComSpecDialog::addField(QWidget *parent, const QString &label, const QStringList &tagPath,
+                                 int kinds, bool boolean)
+{
+    QGridLayout *layout = static_cast<QGridLayout*>(parent->layout());
+    const int row = layout->rowCount();
+
+    FieldEditor field;
+    field.enabled = new QCheckBox(label);
+    field.tagPath = tagPath;
+    field.kinds = kinds;
+    layout->addWidget(field.enabled, row, 0);
+
+    QWidget *editor = nullptr;
+    if (boolean) {
+        field.valueCombo = new QComboBox;
+        field.valueCombo->addItems({QStringLiteral("true"), QStringLiteral("false")});
+        connect(field.valueCombo, &QComboBox::currentIndexChanged, this, &BulkComSpecDialog::updatePreview);
+        editor = field.valueCombo;
+    } else {
+        field.valueEdit = new QLineEdit;
+        field.valueEdit->setValidator(new QIntValidator(0, 999999, field.valueEdit));
+        connect(field.valueEdit, &QLineEdit::textChanged, this, &BulkComSpecDialog::updatePreview);
+        editor = field.valueEdit;
+    }
+    editor->setEnabled(false);
+    layout->addWidget(editor, row, 1);
+    connect(field.enabled, &QCheckBox::toggled, editor, &QWidget::setEnabled);
+    connect(field.enabled, &QCheckBox::toggled, this, &BulkComSpecDialog::updatePreview);
+
+    m_fields.push_back(field);
+}
+
+std::vector<BulkComSpecDialog::Assignment> BulkComSpecDialog::assignments() const
+{
+    std::vector<Assignment> result;
+    for (const FieldEditor& field : m_fields) {
+        if (!field.enabled->isChecked())
+            continue;
+        const QString value = field.valueCombo ? field.valueCombo->currentText() : field.valueEdit->text();
+        if (value.isEmpty())
+            continue;
+        result.push_back({field.tagPath, value, field.kinds});
+    }
+    return result;
+}
+
+int BulkComSpecDialog::childInsertIndex(const ArxmlElement *parent, const QString &tag)
+{
+    // After the last child that comes before tag, else before the first one
+    // that comes after it; unknown children do not count
+    const QStringList& order = schemaOrder(parent->tagName);
+    const int rank = order.indexOf(tag);
+    int index = static_cast<int>(parent->children.size());
+    if (rank < 0)
+        return index;
+
+    for (int i = index - 1; i >= 0; --i) {
+        const int childRank = order.indexOf(parent->children[i]->tagName);
+        if (childRank < 0)
+            continue;
+        if (childRank < rank)
+            return i + 1;
+        index = i;
+    }
+    return index;
+}
+
+void BulkComSpecDialog::runQuery()
+{
+    m_portTag = m_portKindCombo->currentData().toString();
+    m_portPattern = wildcard(m_portNameEdit->text());
+    m_interfacePattern = wildcard(m_interfaceEdit->text());
+    m_dataElementPattern = wildcard(m_dataElementEdit->text());
+
+    m_targets.clear();
+    if (!m_model->rootElement()) {
+        updatePreview();
+        return;
+    }
+
+    QList<int> path;
+    collectTargets(m_model->rootElement(), path, QString());
+
+    // Out-of-core: page in only the stubs that contain ports at all, one
+    // at a time, and let the owner evict after each so the query stays
+    // within the model's memory limit
+    if (m_model->isOutOfCore()) {
+        for (const QList<int>& stubPath : m_model->stubsWithElement(QStringLiteral("PORT-PROTOTYPE"))) {
+            const std::shared_ptr<ArxmlElement> stub = m_model->findElementByIndexPath(stubPath);
+            if (!stub)
+                continue;
+            path = stubPath;
+            collectTargets(stub, path, parentNamePath(stub.get()));
+            emit pageScanned();
+        }
+        // Stubs come after the resident part; back to document order
+        std::sort(m_targets.begin(), m_targets.end(),
+                  [](const Target& a, const Target& b) { return a.path < b.path; });
+    }
+    updatePreview();
+}
+
+void BulkComSpecDialog::collectTargets(const std::shared_ptr<ArxmlElement> &elem, QList<int> &path,
+                                       const QString &namePath)
+{
+    // Stubs with ports are scanned once paged in (see runQuery())
+    if (elem->stub)
+        return;
+
+    const QString name = shortName(elem.get());
+    const QString elemPath = name.isEmpty() ? namePath : namePath + QLatin1Char('/') + name;
+
+    if (elem->tagName.endsWith("PORT-PROTOTYPE", Qt::CaseInsensitive)) {
+        if ((m_portTag.isEmpty() || elem->tagName.compare(m_portTag, Qt::CaseInsensitive) == 0) &&
+            m_portPattern.match(name).hasMatch()) {
+            collectComSpecs(elem, path, elemPath);
+        }
+        return;
+    }
+
+    path.append(0);
+    for (size_t i = 0; i < elem->children.size(); ++i) {
+        path.last() = static_cast<int>(i);
+        collectTargets(elem->children[i], path, elemPath);
+    }
+    path.removeLast();
+}
+
+void BulkComSpecDialog::collectComSpecs(const std::shared_ptr<ArxmlElement> &port, const QList<int> &portPath,
+                                        const QString &portName)
+{
+    QString interfaceName;
+    for (const auto& child : port->children) {
+        if (child->tagName.endsWith("INTERFACE-TREF", Qt::CaseInsensitive)) {
+            interfaceName = lastPathPart(child->text);
+            break;
+        }
+    }
+    if (!m_interfacePattern.match(interfaceName).hasMatch())
+        return;
+
+    for (size_t i = 0; i < port->children.size(); ++i) {
+        const auto& comSpecs = port->children[i];
+        if (comSpecs->tagName.compare("PROVIDED-COM-SPECS", Qt::CaseInsensitive) != 0 &&
+            comSpecs->tagName.compare("REQUIRED-COM-SPECS", Qt::CaseInsensitive) != 0) {
+            continue;
+        }
+
+        for (size_t j = 0; j < comSpecs->children.size(); ++j) {
+            const auto& comSpec = comSpecs->children[j];
+            const int kind = comSpecKind(comSpec->tagName);
+            if (kind == 0)
+                continue;
+
+            QString dataElement;
+            for (const auto& child : comSpec->children) {
+                if (child->tagName.compare("DATA-ELEMENT-REF", Qt::CaseInsensitive) == 0 ||
+                    child->tagName.compare("OPERATION-REF", Qt::CaseInsensitive) == 0) {
+                    dataElement = lastPathPart(child->text);
+                    break;
+                }
+            }
+            if (!m_dataElementPattern.match(dataElement).hasMatch())
+                continue;
+
+            Target target;
+            target.path = portPath;
+            target.path << static_cast<int>(i) << static_cast<int>(j);
+            target.port = portName;
+            target.comSpecTag = comSpec->tagName;
+            target.dataElement = dataElement;
+            target.kind = kind;
+            for (const FieldEditor& field : m_fields) {
+                bool found = false;
+                const QString value = childValue(comSpec.get(), field.tagPath, found);
+                if (found)
+                    target.current.insert(field.tagPath.join(QLatin1Char('/')), value);
+            }
+            m_targets.push_back(std::move(target));
+        }
+    }
+}
+
+void BulkComSpecDialog::updatePreview()
+{
+    const std::vector<Assignment> values = assignments();
+    const int total = static_cast<int>(m_targets.size());
+    const int rows = std::min(total, PreviewRowLimit);
+
+    auto setCell = [this](int row, int column, const QString& text) {
+        if (QTableWidgetItem *item = m_previewTable->item(row, column)) {
+            item->setText(text);
+        } else {
+            m_previewTable->setItem(row, column, new QTableWidgetItem(text));
+        }
+    };
+
+    m_pendingEdits = 0;
+    m_previewTable->setUpdatesEnabled(false);
+    m_previewTable->setRowCount(rows);
+    for (int row = 0; row < total; ++row) {
+        const Target& target = m_targets[row];
+        QStringList changes;
+        for (const Assignment& assignment : values) {
+            if (!(assignment.kinds & target.kind))
+                continue;
+            const auto it = target.current.constFind(assignment.tagPath.join(QLatin1Char('/')));
+            const bool found = it != target.current.constEnd();
+            const QString current = found ? *it : QString();
+            if (found && current == assignment.value)
+                continue;
+            ++m_pendingEdits;
+            if (row < rows) {
+                changes << (found ? tr("%1: %2 -> %3").arg(assignment.tagPath.last(), current, assignment.value)
+                                  : tr("%1: (new) %2").arg(assignment.tagPath.last(), assignment.value));
+            }
+        }
+        if (row < rows) {
+            setCell(row, 0, target.port);
+            setCell(row, 1, target.comSpecTag);
+            setCell(row, 2, target.dataElement);
+            setCell(row, 3, changes.isEmpty() ? tr("(unchanged)") : changes.join(QStringLiteral("; ")));
+        }
+    }
+    m_previewTable->setUpdatesEnabled(true);
+
+    QString summary = tr("%n COM-SPEC(s) match", nullptr, total);
+    if (rows < total) {
+        summary += tr(", the first %1 are listed").arg(rows);
+    }
+    summary += tr("; %n value(s) to change", nullptr, m_pendingEdits);
+    m_summaryLabel->setText(summary);
+    m_buttons->button(QDialogButtonBox::Ok)->setEnabled(m_pendingEdits > 0);
+}
@@ -0,0 +1,59 @@
+// edit_coalescer.cpp
+//
+// Batching of per-keystroke field edits
+
+#include "edit_coalescer.hpp"
+
+#include <QEvent>
+#include <QWidget>
+
+EditCoalescer::EditCoalescer(int idleMs, QObject *parent)
+    : QObject(parent)
+{
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(idleMs);
+    connect(&m_idleTimer, &QTimer::timeout, this, [this]() { flush(); });
+}
+
+void EditCoalescer::watch(QWidget *widget)
+{
+    widget->installEventFilter(this);
+}
+
+void EditCoalescer::schedule(const QString &key, std::function<void()> commit)
+{
+    if (m_commit && key != m_key) {
+        flush();
+    }
+    m_key = key;
+    m_commit = std::move(commit);
+    m_idleTimer.start();
+}
+
+void EditCoalescer::flush()
+{
+    m_idleTimer.stop();
+    if (!m_commit) {
+        return;
+    }
+    // Taken out first: the commit may trigger another flush
+    std::function<void()> commit = std::move(m_commit);
+    m_commit = nullptr;
+    m_key.clear();
+    commit();
+}
+
+void EditCoalescer::discard()
+{
+    m_idleTimer.stop();
+    m_commit = nullptr;
+    m_key.clear();
+}
+
+bool EditCoalescer::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::FocusOut) {
+        flush();
+    }
+    return QObject::eventFilter(watched, event);
+}
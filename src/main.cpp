@@ -1,11 +1,191 @@
-
 #include "main_window.hpp"
+#include "arxml_compression.hpp"
+#include "arxml_model.hpp"
+#include "arxml_pipeline.hpp"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QTimer>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+namespace {
+
+// Headless mode: arxml_editor --transform INPUT OUTPUT [--stage SPEC]...
+int runTransform(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Stream an ARXML file through transform stages."));
+    parser.addHelpOption();
+    parser.addOption({QStringLiteral("transform"), QStringLiteral("Run a streaming transform instead of the GUI.")});
+    parser.addOption({QStringLiteral("stage"),
+                      QStringLiteral("Transform stage: drop:TAG[,TAG...], rename-package:/PATH=NAME "
+                                     "or extract:/PATH. May be repeated; applied in order."),
+                      QStringLiteral("spec")});
+    parser.addPositionalArgument(QStringLiteral("input"), QStringLiteral("ARXML file to read (.gz/.zst allowed)."));
+    parser.addPositionalArgument(QStringLiteral("output"), QStringLiteral("ARXML file to write (.gz/.zst allowed)."));
+    parser.process(app);
+
+    const QStringList files = parser.positionalArguments();
+    if (files.size() != 2) {
+        err << "Expected an input and an output file\n";
+        return 2;
+    }
+
+    ArxmlPipeline pipeline;
+    for (const QString& spec : parser.values(QStringLiteral("stage"))) {
+        if (!pipeline.addStage(spec)) {
+            err << pipeline.lastError() << "\n";
+            return 2;
+        }
+    }
+    if (!pipeline.run(files[0], files[1])) {
+        err << pipeline.lastError() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Round-trip check: arxml_editor --check-round-trip FILE
+// Loads FILE, writes it out again the way a full save does and compares the
+// result with the (decompressed) input byte by byte. Exits with 0 if they
+// are identical, 1 if they differ and 2 if FILE cannot be read.
+int runRoundTripCheck(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Check that an ARXML file is saved back unchanged."));
+    parser.addHelpOption();
+    parser.addOption({QStringLiteral("check-round-trip"), QStringLiteral("Run the round-trip check instead of the GUI.")});
+    parser.addPositionalArgument(QStringLiteral("file"), QStringLiteral("ARXML file to check (.gz/.zst allowed)."));
+    parser.process(app);
+
+    const QStringList files = parser.positionalArguments();
+    if (files.size() != 1) {
+        err << "Expected one file\n";
+        return 2;
+    }
+
+    QByteArray original;
+    ArxmlInputStream input(files[0], 1 << 20);
+    if (!input.open()) {
+        err << input.errorString() << "\n";
+        return 2;
+    }
+    while (!input.atEnd()) {
+        original += input.read();
+    }
+    if (input.hasError()) {
+        err << input.errorString() << "\n";
+        return 2;
+    }
+
+    ArxmlModel model;
+    if (!model.loadFromFile(files[0])) {
+        err << model.lastError() << "\n";
+        return 2;
+    }
+    const QByteArray saved = model.toByteArray(ArxmlWriter::Format::Pretty);
+
+    const qsizetype common = qMin(original.size(), saved.size());
+    qsizetype at = 0;
+    while (at < common && original[at] == saved[at]) {
+        ++at;
+    }
+    if (at == original.size() && at == saved.size()) {
+        out << "identical " << original.size() << " bytes\n";
+        return 0;
+    }
+    out << "differs at byte " << at << " (line " << original.left(at).count('\n') + 1 << ")\n";
+    return 1;
+}
+
+// Resident memory of this process in KiB; -1 where it is not known
+qint64 residentMemoryKiB()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<qint64>(counters.WorkingSetSize / 1024);
+    }
+#elif defined(Q_OS_LINUX)
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (status.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        for (QByteArray line = status.readLine(); !line.isEmpty(); line = status.readLine()) {
+            if (line.startsWith("VmRSS:")) {
+                return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+            }
+        }
+    }
+#endif
+    return -1;
+}
+
+// Startup benchmark: arxml_editor --benchmark-startup
+// Prints the time until the main window is constructed and until it was
+// first shown, and the resident memory once it is idle.
+int runStartupBenchmark(int argc, char *argv[])
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QApplication app(argc, argv);
+    QCoreApplication::setOrganizationName(QStringLiteral("ARXML-Editor"));
+    QCoreApplication::setApplicationName(QStringLiteral("ARXML Editor"));
+    MainWindow w;
+    const qint64 constructedMs = timer.elapsed();
+    w.show();
+
+    qint64 shownMs = -1;
+    // Runs once the events queued by show() (layout, first paint) are done
+    QTimer::singleShot(0, &app, [&]() {
+        shownMs = timer.elapsed();
+        // Give deferred work a moment before taking the idle memory
+        QTimer::singleShot(1000, &app, [&]() {
+            QTextStream out(stdout);
+            out << "constructed_ms " << constructedMs << "\n"
+                << "shown_ms " << shownMs << "\n"
+                << "idle_rss_kib " << residentMemoryKiB() << "\n";
+            app.quit();
+        });
+    });
+    return app.exec();
+}
+
+} // namespace
 
 int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--transform") == 0) {
+            return runTransform(argc, argv);
+        }
+        if (std::strcmp(argv[i], "--benchmark-startup") == 0) {
+            return runStartupBenchmark(argc, argv);
+        }
+        if (std::strcmp(argv[i], "--check-round-trip") == 0) {
+            return runRoundTripCheck(argc, argv);
+        }
+    }
+
     QApplication app(argc, argv);
+    // Identifies the QSettings store (out-of-core limits)
+    QCoreApplication::setOrganizationName(QStringLiteral("ARXML-Editor"));
+    QCoreApplication::setApplicationName(QStringLiteral("ARXML Editor"));
     MainWindow w;
     w.show();
     return app.exec();
-}
\ No newline at end of file
+}
@@ -5,10 +5,21 @@
 #include "main_window.hpp"
 #include "arxml_model.hpp"
 #include "arxml_validator.hpp"
+#include "arxml_rule_engine.hpp"
+#include "arxml_pipeline.hpp"
+#include "arxml_compression.hpp"
+#include "arxml_undo.hpp"
+#include "edit_coalescer.hpp"
+#include "bulk_comspec_dialog.hpp"
+#include "arxml_port_index.hpp"
+#include "arxml_port_table_model.hpp"
+#include "arxml_property_table_model.hpp"
+#include "action_log_model.hpp"
 
 #include <QTreeWidget>
 #include <QTreeWidgetItemIterator>
 #include <QTableWidget>
+#include <QTableView>
 #include <QPushButton>
 #include <QFileDialog>
 #include <QMessageBox>
@@ -16,6 +27,7 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QTextEdit>
+#include <QTextDocument>
 #include <QHeaderView>
 #include <QMenu>
 #include <QInputDialog>
@@ -41,115 +53,103 @@
 #include <QSplitter>
 #include <QMouseEvent>
 #include <QEvent>
-#include <QTemporaryFile>
+#include <QStatusBar>
+#include <QProgressBar>
+#include <QtConcurrentRun>
+#include <QMutexLocker>
+#include <QSettings>
+#include <QFileInfo>
+#include <QUndoStack>
+#include <QKeySequence>
+#include <QElapsedTimer>
+#include <QDockWidget>
+#include <QToolButton>
+#include <QListView>
+#include <QScrollBar>
+#include <QSortFilterProxyModel>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+
+// Defaults for the out-of-core settings (QSettings group "outOfCore")
+constexpr qint64 DefaultOutOfCoreThresholdMB = 1024;
+constexpr qint64 DefaultOutOfCoreMemoryLimitMB = 2048;
+
+// Typing pause after which a batch of keystrokes becomes one edit
+constexpr int EditIdleMs = 500;
+
+// Typing pause after which a port overview filter is applied
+constexpr int PortFilterDelayMs = 150;
+
+// Editing pause after which the document is checked again
+constexpr int CheckIdleMs = 1000;
+
+// Action log lines kept for the view; older ones are dropped (an exported
+// log file keeps everything)
+constexpr int ActionLogCapacity = 10000;
+
+// Recently selected ports whose PORTS tab contents are kept
+constexpr int PortViewCacheSize = 64;
+
+// Setting the same text again still re-lays out the field and moves the
+// cursor; skip it
+void setTextIfChanged(QLineEdit *edit, const QString &text)
+{
+    if (edit->text() != text) {
+        edit->setText(text);
+    }
+}
+
+} // namespace
+
+// Outcome of one background check run
+struct MainWindow::CheckResult
+{
+    bool cancelled = false;  // The model was changed during the run
+    bool schema = false;     // Validated against m_schemaFileName
+    QString wellFormed;      // Problems found without a schema
+    std::vector<ArxmlValidator::UnitErrors> schemaErrors;
+    std::vector<ArxmlFinding> findings;
+};
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
       m_treeWidget(new QTreeWidget),
       m_propertyTabWidget(new QTabWidget),
-      m_propertyTable(new QTableWidget),
-      m_portsPropertiesTab(new QWidget),
-      m_portsApiOptionsTab(new QWidget),
-      m_portsCommSpecTab(new QWidget),
-      m_portsDescriptionTab(new QTextEdit),
+      m_propertyTable(new QTableView),
+      m_propertyModel(new ArxmlPropertyTableModel(this)),
       m_logTabWidget(new QTabWidget),
-      m_portNameEdit(new QLineEdit),
-      m_portInterfaceGroup(new QGroupBox),
-      m_portInterfaceNameEdit(new QLineEdit),
-      m_blueprintGroup(new QGroupBox),
-      m_blueprintNameEdit(new QLineEdit),
-      m_directionGroup(new QGroupBox),
-      m_directionButtonGroup(new QButtonGroup),
-      m_directionRadio1(new QRadioButton),
-      m_directionRadio2(new QRadioButton),
-      m_directionRadio3(new QRadioButton),
-      m_apiOptionsGroup(new QGroupBox),
-      m_enableIndirectApiCheck(new QCheckBox),
-      m_enableApiUsageByAddressCheck(new QCheckBox),
-      m_transformationErrorHandlingCheck(new QCheckBox),
-      m_portDefinedArgsGroup(new QGroupBox),
-      m_portDefinedArgsTable(new QTableWidget),
-      m_editArgsButton(new QPushButton),
-      m_getFromButton(new QPushButton),
-      m_copyToButton(new QPushButton),
-      m_commSpecDeElementsList(new QListWidget),
-      m_commSpecSubTabs(new QTabWidget),
-      m_senderComSpecTab(new QWidget),
-      m_receiverComSpecTab(new QWidget),
-      m_clientServerComSpecTab(new QWidget),
-      m_serverComSpecTab(new QWidget),
-      m_interfacePropertiesTab(new QWidget),
-      m_commSpecDescriptionTab(new QWidget),
-      m_commSpecNoPropertiesLabel(new QLabel),
-      m_receiverInitValueEdit(new QLineEdit),
-      m_receiverInitValueTypeCombo(new QComboBox),
-      m_receiverInitValueEditButton(new QPushButton),
-      m_rxFilterButtonGroup(new QButtonGroup),
-      m_rxFilterAlwaysRadio(new QRadioButton),
-      m_rxFilterMaskedRadio(new QRadioButton),
-      m_receiverUsesEndToEndProtectionCheck(new QCheckBox),
-      m_handleNeverReceivedCheck(new QCheckBox),
-      m_enableUpdateCheck(new QCheckBox),
-      m_aliveTimeoutEdit(new QLineEdit),
-      m_queueLengthEdit(new QLineEdit),
-      m_transformationGroup(new QGroupBox),
-      m_transformationTypeCombo(new QComboBox),
-      m_transformationDisabledCheck(new QCheckBox),
-      m_maxDeltaCounterEdit(new QLineEdit),
-      m_maxErrorStateInitEdit(new QLineEdit),
-      m_maxErrorStateInvalidEdit(new QLineEdit),
-      m_maxErrorStateValidEdit(new QLineEdit),
-      m_minOkStateInitEdit(new QLineEdit),
-      m_minOkStateInvalidEdit(new QLineEdit),
-      m_minOkStateValidEdit(new QLineEdit),
-      m_syncCounterInitEdit(new QLineEdit),
-      m_clientServerDeElementsList(new QListWidget),
-      m_clientServerTransformationGroup(new QGroupBox),
-      m_clientServerTransformationTypeCombo(new QComboBox),
-      m_clientServerTransformationDisabledCheck(new QCheckBox),
-      m_clientServerMaxDeltaCounterEdit(new QLineEdit),
-      m_clientServerMaxErrorStateInitEdit(new QLineEdit),
-      m_clientServerMaxErrorStateInvalidEdit(new QLineEdit),
-      m_clientServerMaxErrorStateValidEdit(new QLineEdit),
-      m_clientServerMaxNoNewOrRepeatedDataEdit(new QLineEdit),
-      m_clientServerMinOkStateInitEdit(new QLineEdit),
-      m_clientServerMinOkStateInvalidEdit(new QLineEdit),
-      m_clientServerMinOkStateValidEdit(new QLineEdit),
-      m_clientServerSyncCounterInitEdit(new QLineEdit),
-      m_clientServerWindowSizeEdit(new QLineEdit),
-      m_clientServerNoPropertiesLabel(new QLabel),
-      m_serverQueueLengthEdit(new QLineEdit),
-      m_interfacePropNameEdit(new QLineEdit),
-      m_dataTypeGroup(new QGroupBox),
-      m_dataTypeEdit(new QLineEdit),
-      m_dataTypeButton1(new QPushButton),
-      m_dataTypeButton2(new QPushButton),
-      m_dataTypeButton3(new QPushButton),
-      m_dataConstraintEdit(new QLineEdit),
-      m_dataConstraintButton(new QPushButton),
-      m_useQueuedCommCheck(new QCheckBox),
-      m_measurementCalibrationGroup(new QGroupBox),
-      m_calibrationAccessCombo(new QComboBox),
-      m_handleInvalidGroup(new QGroupBox),
-      m_handleInvalidButtonGroup(new QButtonGroup),
-      m_handleInvalidKeepRadio(new QRadioButton),
-      m_handleInvalidReplaceRadio(new QRadioButton),
-      m_handleInvalidNoneRadio(new QRadioButton),
-      m_initValueEdit(new QLineEdit),
-      m_initValueTypeCombo(new QComboBox),
-      m_initValueEditButton(new QPushButton),
-      m_usesTxAcknowledgeCheck(new QCheckBox),
-      m_timeoutEdit(new QLineEdit),
-      m_timeoutUnitCombo(new QComboBox),
-      m_usesEndToEndProtectionCheck(new QCheckBox),
-      m_actionLog(new QTextEdit),
+      m_actionLog(new ActionLogModel(ActionLogCapacity, this)),
+      m_actionLogView(new QListView),
+      m_actionLogFilter(new QSortFilterProxyModel(this)),
       m_openButton(new QPushButton(tr("Open"))),
+      m_openSubsetButton(new QPushButton(tr("Open Subset..."))),
       m_saveButton(new QPushButton(tr("Save"))),
       m_saveAsButton(new QPushButton(tr("Save As"))),
       m_validateButton(new QPushButton(tr("Validate"))),
+      m_transformButton(new QPushButton(tr("Transform..."))),
+      m_bulkComSpecButton(new QPushButton(tr("Bulk ComSpec..."))),
+      m_undoButton(new QPushButton(tr("Undo"))),
+      m_redoButton(new QPushButton(tr("Redo"))),
       m_searchBox(new QLineEdit),
+      m_loadProgressBar(new QProgressBar),
+      m_cancelLoadButton(new QPushButton(tr("Cancel"))),
+      m_messagesList(new QTreeWidget),
       m_model(new ArxmlModel),
-      m_validator(new ArxmlValidator)
+      m_validator(new ArxmlValidator),
+      m_ruleEngine(new ArxmlRuleEngine),
+      m_undoStack(new QUndoStack(this)),
+      m_editCoalescer(new EditCoalescer(EditIdleMs, this)),
+      m_portIndex(std::make_unique<ArxmlPortIndex>()),
+      m_portViewCache(PortViewCacheSize),
+      m_portTableModel(new ArxmlPortTableModel(m_portIndex.get(), this)),
+      m_portDock(new QDockWidget(tr("Ports"), this)),
+      m_portOverview(new QTableView),
+      m_portCountLabel(new QLabel),
+      m_loadingModel(nullptr),
+      m_checkTimer(new QTimer(this))
 {
     // Central widget and layout
     QWidget *central = new QWidget(this);
@@ -159,9 +159,17 @@ MainWindow::MainWindow(QWidget *parent)
     // Top toolbar
     QHBoxLayout *toolbarLayout = new QHBoxLayout;
     toolbarLayout->addWidget(m_openButton);
+    toolbarLayout->addWidget(m_openSubsetButton);
     toolbarLayout->addWidget(m_saveButton);
     toolbarLayout->addWidget(m_saveAsButton);
     toolbarLayout->addWidget(m_validateButton);
+    toolbarLayout->addWidget(m_transformButton);
+    toolbarLayout->addWidget(m_bulkComSpecButton);
+    toolbarLayout->addWidget(m_undoButton);
+    toolbarLayout->addWidget(m_redoButton);
+    QToolButton *portsButton = new QToolButton;
+    portsButton->setDefaultAction(m_portDock->toggleViewAction());
+    toolbarLayout->addWidget(portsButton);
     toolbarLayout->addSpacing(10);
     QLabel *searchLabel = new QLabel(tr("Search:"));
     toolbarLayout->addWidget(searchLabel);
@@ -188,15 +196,16 @@ MainWindow::MainWindow(QWidget *parent)
     QWidget *propPanel = new QWidget;
     QVBoxLayout *propLayout = new QVBoxLayout(propPanel);
     
-    // Setup standard property table
-    m_propertyTable->setColumnCount(2);
-    m_propertyTable->setHorizontalHeaderLabels(QStringList() << tr("Property") << tr("Value"));
+    // Setup standard property table - reads the selected element through
+    // m_propertyModel
+    m_propertyTable->setModel(m_propertyModel);
+    m_propertyTable->setWordWrap(false);
     m_propertyTable->horizontalHeader()->setStretchLastSection(true);
     m_propertyTable->verticalHeader()->setVisible(false);
     m_propertyTable->setEditTriggers(QAbstractItemView::AllEditTriggers);
     
-    // Setup PORTS tabs
-    setupPortsTabs();
+    // The PORTS tabs are built when the first port is selected
+    // (ensurePortsTabs)
     
     // Add both widgets to layout, but show only the standard table initially
     propLayout->addWidget(m_propertyTable);
@@ -215,18 +224,101 @@ MainWindow::MainWindow(QWidget *parent)
     QWidget *logPanel = new QWidget;
     QVBoxLayout *logLayout = new QVBoxLayout(logPanel);
     
-    // Setup action log
-    m_actionLog->setReadOnly(true);
+    // Setup action log - severity filter and export above a list view that
+    // only lays out the visible lines
+    QWidget *actionLogTab = new QWidget;
+    QVBoxLayout *actionLogLayout = new QVBoxLayout(actionLogTab);
+    actionLogLayout->setContentsMargins(0, 0, 0, 0);
+    actionLogLayout->setSpacing(2);
+    QHBoxLayout *actionLogToolbar = new QHBoxLayout;
+    QComboBox *severityCombo = new QComboBox;
+    severityCombo->addItem(tr("All"), QString());
+    severityCombo->addItem(tr("Warnings and errors"),
+                           QStringLiteral("^[%1%2]$")
+                               .arg(static_cast<int>(ActionLogModel::Severity::Warning))
+                               .arg(static_cast<int>(ActionLogModel::Severity::Error)));
+    severityCombo->addItem(tr("Errors"),
+                           QStringLiteral("^%1$").arg(static_cast<int>(ActionLogModel::Severity::Error)));
+    QPushButton *exportLogButton = new QPushButton(tr("Export..."));
+    exportLogButton->setToolTip(tr("Write the log to a file and keep appending to it"));
+    actionLogToolbar->addWidget(new QLabel(tr("Show:")));
+    actionLogToolbar->addWidget(severityCombo);
+    actionLogToolbar->addStretch();
+    actionLogToolbar->addWidget(exportLogButton);
+    actionLogLayout->addLayout(actionLogToolbar);
+    m_actionLogFilter->setSourceModel(m_actionLog);
+    m_actionLogFilter->setFilterRole(ActionLogModel::SeverityRole);
+    m_actionLogView->setModel(m_actionLogFilter);
+    m_actionLogView->setUniformItemSizes(true);
+    m_actionLogView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_actionLogView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    actionLogLayout->addWidget(m_actionLogView);
+    connect(severityCombo, &QComboBox::currentIndexChanged, this, [this, severityCombo]() {
+        m_actionLogFilter->setFilterRegularExpression(severityCombo->currentData().toString());
+    });
+    connect(exportLogButton, &QPushButton::clicked, this, &MainWindow::exportActionLog);
+    // Keep showing the newest line unless the user scrolled up
+    connect(m_actionLogFilter, &QAbstractItemModel::rowsAboutToBeInserted, this, [this]() {
+        const QScrollBar *bar = m_actionLogView->verticalScrollBar();
+        m_actionLogFollow = bar->value() == bar->maximum();
+    });
+    connect(m_actionLogFilter, &QAbstractItemModel::rowsInserted, this, [this]() {
+        if (m_actionLogFollow) {
+            m_actionLogView->scrollToBottom();
+        }
+    });
     
-    // Setup messages tab (placeholder for now)
+    // Setup messages tab - findings of the semantic checks, double-click jumps to the element
     m_messagesTab = new QWidget;
     QVBoxLayout *messagesLayout = new QVBoxLayout(m_messagesTab);
-    QLabel *messagesLabel = new QLabel(tr("Messages tab - functionality to be added"));
-    messagesLabel->setAlignment(Qt::AlignCenter);
-    messagesLayout->addWidget(messagesLabel);
-    
+    messagesLayout->setContentsMargins(0, 0, 0, 0);
+    m_messagesList->setHeaderLabels(QStringList() << tr("Severity") << tr("Rule") << tr("Message") << tr("Path"));
+    m_messagesList->setRootIsDecorated(false);
+    m_messagesList->setUniformRowHeights(true);
+    m_messagesList->setSortingEnabled(true);
+    m_messagesList->sortByColumn(0, Qt::AscendingOrder);
+    messagesLayout->addWidget(m_messagesList);
+
+    // Setup port overview dock - every port of the document with a filter
+    // per column, sortable, double-click jumps to the port. Rows come from
+    // the model on demand, so the view stays fast with any number of ports.
+    QWidget *portPanel = new QWidget;
+    QVBoxLayout *portLayout = new QVBoxLayout(portPanel);
+    portLayout->setContentsMargins(0, 0, 0, 0);
+    QHBoxLayout *portFilterLayout = new QHBoxLayout;
+    for (int column = 0; column < ArxmlPortTableModel::ColumnCount; ++column) {
+        QLineEdit *filterEdit = new QLineEdit;
+        filterEdit->setPlaceholderText(
+            m_portTableModel->headerData(column, Qt::Horizontal).toString());
+        filterEdit->setClearButtonEnabled(true);
+        QTimer *filterTimer = new QTimer(filterEdit);
+        filterTimer->setSingleShot(true);
+        filterTimer->setInterval(PortFilterDelayMs);
+        connect(filterEdit, &QLineEdit::textChanged, filterTimer, qOverload<>(&QTimer::start));
+        connect(filterTimer, &QTimer::timeout, this, [this, column, filterEdit]() {
+            m_portTableModel->setFilter(column, filterEdit->text());
+        });
+        portFilterLayout->addWidget(filterEdit);
+    }
+    portLayout->addLayout(portFilterLayout);
+    m_portOverview->setModel(m_portTableModel);
+    m_portOverview->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_portOverview->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_portOverview->setWordWrap(false);
+    m_portOverview->verticalHeader()->setVisible(false);
+    m_portOverview->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_portOverview->horizontalHeader()->setStretchLastSection(true);
+    m_portOverview->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+    m_portOverview->setSortingEnabled(true);
+    portLayout->addWidget(m_portOverview);
+    portLayout->addWidget(m_portCountLabel);
+    m_portDock->setObjectName(QStringLiteral("portDock"));
+    m_portDock->setWidget(portPanel);
+    addDockWidget(Qt::BottomDockWidgetArea, m_portDock);
+    m_portDock->hide();
+
     // Add tabs to tab widget
-    m_logTabWidget->addTab(m_actionLog, tr("Action Log"));
+    m_logTabWidget->addTab(actionLogTab, tr("Action Log"));
     m_logTabWidget->addTab(m_messagesTab, tr("Messages"));
     m_logTabWidget->setFixedHeight(120);  // Fixed height for the tab widget
     
@@ -234,37 +326,68 @@ MainWindow::MainWindow(QWidget *parent)
     logLayout->setContentsMargins(0, 0, 0, 0);
     mainLayout->addWidget(logPanel, 0);  // No stretch for log tabs
 
+    // Status bar - load progress and cancel button, only visible while loading
+    m_loadProgressBar->setMaximumWidth(200);
+    m_loadProgressBar->setVisible(false);
+    m_cancelLoadButton->setVisible(false);
+    statusBar()->addPermanentWidget(m_loadProgressBar);
+    statusBar()->addPermanentWidget(m_cancelLoadButton);
+
     // Initially disable Save, Save As, and Validate buttons (no file opened yet)
     m_saveButton->setEnabled(false);
     m_saveAsButton->setEnabled(false);
     m_validateButton->setEnabled(false);
+    m_bulkComSpecButton->setEnabled(false);
     
     // Connect signals
     connect(m_openButton, &QPushButton::clicked, this, &MainWindow::openFile);
+    connect(m_openSubsetButton, &QPushButton::clicked, this, &MainWindow::openFileSubset);
     connect(m_saveButton, &QPushButton::clicked, this, &MainWindow::saveFile);
     connect(m_saveAsButton, &QPushButton::clicked, this, &MainWindow::saveFileAs);
     connect(m_validateButton, &QPushButton::clicked, this, &MainWindow::validateDocument);
+    connect(m_transformButton, &QPushButton::clicked, this, &MainWindow::transformFile);
+    connect(m_portOverview, &QTableView::doubleClicked, this, &MainWindow::onPortOverviewActivated);
+    connect(m_portTableModel, &ArxmlPortTableModel::queryFinished, this, [this](int shownRows, int totalRows) {
+        m_portCountLabel->setText(tr("%1 of %2 ports").arg(shownRows).arg(totalRows));
+    });
+    connect(m_bulkComSpecButton, &QPushButton::clicked, this, &MainWindow::bulkEditComSpecs);
+    m_undoButton->setShortcut(QKeySequence::Undo);
+    m_redoButton->setShortcut(QKeySequence::Redo);
+    m_undoButton->setEnabled(false);
+    m_redoButton->setEnabled(false);
+    connect(m_undoButton, &QPushButton::clicked, this, &MainWindow::undoEdit);
+    connect(m_redoButton, &QPushButton::clicked, this, &MainWindow::redoEdit);
+    connect(m_undoStack, &QUndoStack::canUndoChanged, m_undoButton, &QPushButton::setEnabled);
+    connect(m_undoStack, &QUndoStack::canRedoChanged, m_redoButton, &QPushButton::setEnabled);
+    connect(m_cancelLoadButton, &QPushButton::clicked, this, &MainWindow::cancelLoad);
+    connect(&m_loadWatcher, &QFutureWatcher<bool>::finished, this, &MainWindow::onLoadFinished);
+    connect(&m_saveWatcher, &QFutureWatcher<bool>::finished, this, &MainWindow::onSaveFinished);
+    connect(&m_transformWatcher, &QFutureWatcher<bool>::finished, this, &MainWindow::onTransformFinished);
+    connect(&m_checkWatcher, &QFutureWatcher<std::shared_ptr<CheckResult>>::finished,
+            this, &MainWindow::onChecksFinished);
+    m_checkTimer->setSingleShot(true);
+    m_checkTimer->setInterval(CheckIdleMs);
+    connect(m_checkTimer, &QTimer::timeout, this, &MainWindow::startChecks);
     connect(m_treeWidget, &QTreeWidget::currentItemChanged,
             this, &MainWindow::onCurrentItemChanged);
-    connect(m_propertyTable, &QTableWidget::itemChanged,
-            this, &MainWindow::onPropertyItemChanged);
-    connect(m_portNameEdit, &QLineEdit::textChanged,
-            this, &MainWindow::onPortPropertyChanged);
-    connect(m_directionButtonGroup, &QButtonGroup::buttonClicked,
-            this, [this](QAbstractButton* button) {
-                int id = m_directionButtonGroup->id(button);
-                onDirectionChanged(id);
-            });
-    // Port API Options tab uses checkboxes and buttons, no table item changes to connect
-    // Port Communication Spec tab is now a form widget, no table item changes to connect
-    connect(m_portsDescriptionTab, &QTextEdit::textChanged,
-            this, &MainWindow::onDescriptionTextChanged);
-    connect(m_commSpecDeElementsList, &QListWidget::itemSelectionChanged,
-            this, &MainWindow::onCommSpecDeElementSelected);
-    connect(m_commSpecDeElementsList, &QListWidget::currentItemChanged,
-            this, &MainWindow::onCommSpecDeElementSelected);
+    connect(m_propertyModel, &ArxmlPropertyTableModel::attributeEdited,
+            this, &MainWindow::onPropertyAttributeEdited);
+    connect(m_propertyModel, &ArxmlPropertyTableModel::textEdited,
+            this, &MainWindow::onPropertyTextEdited);
+    connect(m_propertyTable, &QTableView::doubleClicked, this, [this](const QModelIndex &index) {
+        // A long text is shown cut off until it is asked for
+        if (m_propertyModel->isTextRow(index.row()) && m_propertyModel->isTextElided()) {
+            m_propertyModel->setTextExpanded(true);
+        }
+    });
     connect(m_searchBox, &QLineEdit::textChanged,
             this, &MainWindow::onSearchTextChanged);
+    connect(m_searchBox, &QLineEdit::returnPressed,
+            this, &MainWindow::onSearchSubmitted);
+    connect(m_treeWidget, &QTreeWidget::itemExpanded,
+            this, &MainWindow::onItemExpanded);
+    connect(m_messagesList, &QTreeWidget::itemActivated,
+            this, &MainWindow::onMessageActivated);
     
     // Context menu
     m_treeWidget->setContextMenuPolicy(Qt::CustomContextMenu);
@@ -278,6 +401,20 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    // A running load still writes into m_loadingModel, stop it first
+    if (m_loadWatcher.isRunning()) {
+        m_loadCancelRequested = true;
+        m_loadWatcher.waitForFinished();
+    }
+    delete m_loadingModel;
+    // A running save works on its own snapshot; let it complete so the file
+    // is not left behind half written
+    m_saveWatcher.waitForFinished();
+    m_transformWatcher.waitForFinished();
+    // A running check reads m_model
+    m_validator->cancel();
+    m_model->interruptReaders();
+    m_checkWatcher.waitForFinished();
 }
 
 void MainWindow::openFile()
@@ -285,37 +422,307 @@ void MainWindow::openFile()
     QString fileName = QFileDialog::getOpenFileName(this,
                                                     tr("Open ARXML File"),
                                                     "",
+                                                    tr("ARXML Files (*.arxml *.xml *.arxml.gz *.arxml.zst);;All Files (*)"));
+    if (fileName.isEmpty())
+        return;
+
+    startLoad(fileName);
+}
+
+void MainWindow::openFileSubset()
+{
+    QString fileName = QFileDialog::getOpenFileName(this,
+                                                    tr("Open Part of an ARXML File"),
+                                                    "",
                                                     tr("ARXML Files (*.arxml *.xml);;All Files (*)"));
     if (fileName.isEmpty())
         return;
 
-    if (m_model->loadFromFile(fileName)) {
-        m_currentFileName = fileName;
-        logAction(tr("Opened file: %1").arg(fileName));
-        
-        // Rebuild tree
-        m_treeWidget->clear();
-        if (m_model->rootElement()) {
-            buildTreeRecursive(m_model->rootElement(), nullptr);
-            // Collapse all items initially
-            m_treeWidget->collapseAll();
-            // Select first item if available
-            if (m_treeWidget->topLevelItemCount() > 0) {
-                m_treeWidget->setCurrentItem(m_treeWidget->topLevelItem(0));
-            }
+    bool ok = false;
+    const QString selection = QInputDialog::getText(this, tr("Open Subset"),
+                                                    tr("Package paths (/Pkg/Sub) and element tags to load, comma separated:"),
+                                                    QLineEdit::Normal, QString(), &ok);
+    if (!ok || selection.trimmed().isEmpty())
+        return;
+
+    // Paths start with '/', anything else is an element tag
+    QStringList packagePaths;
+    QStringList elementTags;
+    for (const QString& entry : selection.split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+        const QString trimmed = entry.trimmed();
+        if (trimmed.startsWith(QLatin1Char('/'))) {
+            packagePaths.append(trimmed);
+        } else if (!trimmed.isEmpty()) {
+            elementTags.append(trimmed);
         }
-        
-        // Enable Save, Save As, and Validate buttons
-        m_saveButton->setEnabled(true);
-        m_saveAsButton->setEnabled(true);
-        m_validateButton->setEnabled(true);
+    }
+
+    logAction(tr("Opening subset of %1: %2").arg(fileName, selection.trimmed()));
+    startLoad(fileName, packagePaths, elementTags);
+}
+
+void MainWindow::startLoad(const QString& fileName, const QStringList& packagePaths,
+                           const QStringList& elementTags)
+{
+    if (m_loadWatcher.isRunning())
+        return;
+
+    // Parse into a separate model so the current document stays usable
+    m_loadingModel = new ArxmlModel;
+    m_loadingFileName = fileName;
+    m_loadCancelRequested = false;
+
+    m_openButton->setEnabled(false);
+    m_openSubsetButton->setEnabled(false);
+    m_loadProgressBar->setRange(0, 100);
+    m_loadProgressBar->setValue(0);
+    m_loadProgressBar->setVisible(true);
+    m_cancelLoadButton->setVisible(true);
+    statusBar()->showMessage(tr("Loading %1...").arg(fileName));
+
+    ArxmlLoadOptions options;
+    // Large plain files are opened out-of-core: identifiables stay stubs
+    // backed by the mapped file until they are expanded
+    QSettings settings;
+    const qint64 thresholdMB = settings.value(QStringLiteral("outOfCore/thresholdMB"),
+                                              DefaultOutOfCoreThresholdMB).toLongLong();
+    options.outOfCore = thresholdMB > 0 &&
+                        compressionForFile(fileName) == ArxmlCompression::None &&
+                        QFileInfo(fileName).size() >= thresholdMB * 1024 * 1024;
+    options.packagePaths = packagePaths;
+    options.elementTags = elementTags;
+    options.progress = [this](qint64 bytesRead, qint64 totalBytes) {
+        QMetaObject::invokeMethod(this, [this, bytesRead, totalBytes]() {
+            onLoadProgress(bytesRead, totalBytes);
+        }, Qt::QueuedConnection);
+        return !m_loadCancelRequested.load();
+    };
+    options.packageLoaded = [this](const std::shared_ptr<ArxmlElement>& package,
+                                   const QList<int>& indexPath,
+                                   const QStringList& ancestorTags) {
+        // Only the first package of a batch schedules a flush; the rest are
+        // picked up by it, so a busy GUI thread gets larger batches
+        QMutexLocker locker(&m_loadedPackagesMutex);
+        const bool scheduleFlush = m_loadedPackages.empty();
+        m_loadedPackages.push_back({package, indexPath, ancestorTags});
+        if (scheduleFlush) {
+            QMetaObject::invokeMethod(this, &MainWindow::flushLoadedPackages, Qt::QueuedConnection);
+        }
+    };
+
+    ArxmlModel *model = m_loadingModel;
+    m_loadWatcher.setFuture(QtConcurrent::run([model, fileName, options]() {
+        return model->loadFromFile(fileName, options);
+    }));
+}
+
+void MainWindow::onLoadProgress(qint64 bytesRead, qint64 totalBytes)
+{
+    if (!m_loadWatcher.isRunning())
+        return;
+
+    if (totalBytes > 0) {
+        m_loadProgressBar->setValue(static_cast<int>(bytesRead * 100 / totalBytes));
     } else {
-        QMessageBox::critical(this, tr("Error"),
-                              tr("Failed to open file: %1").arg(fileName));
+        m_loadProgressBar->setRange(0, 0);  // Unknown size, busy indicator
+    }
+}
+
+void MainWindow::flushLoadedPackages()
+{
+    std::vector<LoadedPackage> batch;
+    {
+        QMutexLocker locker(&m_loadedPackagesMutex);
+        batch.swap(m_loadedPackages);
+    }
+    // A flush queued behind the finished signal must not touch the final tree
+    if (batch.empty() || !m_loadingModel)
+        return;
+
+    if (!m_previewActive) {
+        // Replace the current document's tree by the preview of the new one;
+        // it stays read-only until loading has finished
+        m_previewActive = true;
+        m_treeWidget->clear();
+        m_propertyTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        if (m_portsPropertiesTab) {
+            m_portNameEdit->setReadOnly(true);
+            m_portsDescriptionTab->setReadOnly(true);
+        }
+        m_saveButton->setEnabled(false);
+        m_saveAsButton->setEnabled(false);
+        m_validateButton->setEnabled(false);
+        m_bulkComSpecButton->setEnabled(false);
+
+        const LoadedPackage &first = batch.front();
+        QTreeWidgetItem *rootItem = new QTreeWidgetItem(m_treeWidget);
+        rootItem->setText(0, first.ancestorTags.value(0));
+        rootItem->setData(0, Qt::UserRole, QVariant::fromValue(QList<int>()));
+        m_previewContainerItem = new QTreeWidgetItem(rootItem);
+        m_previewContainerItem->setText(0, first.ancestorTags.value(1));
+        m_previewContainerItem->setData(0, Qt::UserRole,
+                                        QVariant::fromValue(QList<int>() << first.indexPath.value(0)));
+        rootItem->setExpanded(true);
+        m_previewContainerItem->setExpanded(true);
+    }
+
+    for (const LoadedPackage &package : batch) {
+        QTreeWidgetItem *item = buildTreeRecursive(package.element, m_previewContainerItem, package.indexPath);
+        m_previewPackages.insert(item, package.element);
+    }
+
+    if (!m_searchBox->text().isEmpty()) {
+        filterTreeItems(m_searchBox->text());
+    }
+    statusBar()->showMessage(tr("Loading %1... (%2 packages shown)")
+                                 .arg(m_loadingFileName)
+                                 .arg(m_previewContainerItem->childCount()));
+}
+
+void MainWindow::endLoadPreview()
+{
+    {
+        QMutexLocker locker(&m_loadedPackagesMutex);
+        m_loadedPackages.clear();
+    }
+    if (!m_previewActive)
+        return;
+
+    m_previewActive = false;
+    m_previewContainerItem = nullptr;
+    m_previewPackages.clear();
+    m_propertyTable->setEditTriggers(QAbstractItemView::AllEditTriggers);
+    if (m_portsPropertiesTab) {
+        m_portNameEdit->setReadOnly(false);
+        m_portsDescriptionTab->setReadOnly(false);
+    }
+}
+
+void MainWindow::cancelLoad()
+{
+    if (m_loadWatcher.isRunning()) {
+        m_loadCancelRequested = true;
+        statusBar()->showMessage(tr("Cancelling..."));
+    }
+}
+
+void MainWindow::onLoadFinished()
+{
+    m_loadProgressBar->setVisible(false);
+    m_cancelLoadButton->setVisible(false);
+    m_openButton->setEnabled(true);
+    m_openSubsetButton->setEnabled(true);
+    statusBar()->clearMessage();
+
+    ArxmlModel *loaded = m_loadingModel;
+    m_loadingModel = nullptr;
+    const QString fileName = m_loadingFileName;
+
+    // Remember what the user selected in the preview; preview paths are
+    // model paths, so the item can be found again in the full tree
+    const bool wasPreviewing = m_previewActive;
+    QList<int> previewSelection;
+    if (wasPreviewing && m_treeWidget->currentItem()) {
+        previewSelection = m_treeWidget->currentItem()->data(0, Qt::UserRole).value<QList<int>>();
+    }
+
+    // Clearing the tree first drops all references the property panels hold
+    // into the preview or the old model. A load that failed before the
+    // preview took over leaves the current document's tree as it is.
+    const bool loadedOk = m_loadWatcher.result();
+    if (wasPreviewing || loadedOk) {
+        m_treeWidget->clear();
+    }
+    endLoadPreview();
+
+    if (!loadedOk) {
+        if (m_loadCancelRequested) {
+            logAction(tr("Loading cancelled: %1").arg(fileName), ActionLogModel::Severity::Warning);
+        } else {
+            QMessageBox::critical(this, tr("Error"),
+                                  tr("Failed to open file: %1\n%2").arg(fileName, loaded->lastError()));
+        }
+        delete loaded;
+        // The preview replaced the previous document's tree, bring it back
+        if (wasPreviewing) {
+            populateTree();
+            const bool hasDocument = !m_currentFileName.isEmpty();
+            m_saveButton->setEnabled(hasDocument);
+            m_saveAsButton->setEnabled(hasDocument);
+            m_validateButton->setEnabled(hasDocument);
+            m_bulkComSpecButton->setEnabled(hasDocument);
+        }
+        return;
+    }
+
+    // Swap the finished model in; the undo history belongs to the old one
+    m_editCoalescer->discard();
+    m_undoStack->clear();
+    ArxmlModel *previous = m_model;
+    m_model = loaded;
+    m_portViewCache.clear();
+    m_pagedSearch.clear();
+    m_portIndex->build(m_model->rootElement());
+    m_portTableModel->refresh();
+    // A running check reads the old document; stop it before it goes
+    m_validator->cancel();
+    previous->interruptReaders();
+    m_checkWatcher.waitForFinished();
+    m_checkingModel = nullptr;
+    m_checkTimer->stop();
+    m_liveChecks = false;
+    m_checkPending = false;
+    m_checkRequested = false;
+    delete previous;
+    m_savingModel = nullptr;  // A running save belongs to the old document
+
+    m_currentFileName = fileName;
+    m_validator->clearCache();
+    m_messagesList->clear();
+    logAction(tr("Opened file: %1").arg(fileName));
+    if (m_model->isOutOfCore()) {
+        QSettings settings;
+        const qint64 limitMB = settings.value(QStringLiteral("outOfCore/memoryLimitMB"),
+                                              DefaultOutOfCoreMemoryLimitMB).toLongLong();
+        m_model->setMemoryLimit(limitMB * 1024 * 1024);
+        logAction(tr("Opened out-of-core or in part; elements are loaded on demand (memory limit %1 MB)")
+                      .arg(limitMB));
+    }
+
+    // Rebuild tree
+    populateTree();
+    QTreeWidgetItem *selected = wasPreviewing ? findTreeItem(previewSelection) : nullptr;
+    if (selected) {
+        m_treeWidget->setCurrentItem(selected);
+        m_treeWidget->scrollToItem(selected);
+    } else if (m_treeWidget->topLevelItemCount() > 0) {
+        // Select first item if available
+        m_treeWidget->setCurrentItem(m_treeWidget->topLevelItem(0));
     }
+    if (!m_searchBox->text().isEmpty()) {
+        filterTreeItems(m_searchBox->text());
+    }
+
+    // Enable Save, Save As, and Validate buttons
+    m_saveButton->setEnabled(true);
+    m_saveAsButton->setEnabled(true);
+    m_validateButton->setEnabled(true);
+    m_bulkComSpecButton->setEnabled(true);
+}
+
+void MainWindow::populateTree()
+{
+    m_treeWidget->clear();
+    if (m_currentFileName.isEmpty() || !m_model->rootElement())
+        return;
+
+    buildTreeRecursive(m_model->rootElement(), nullptr, QList<int>());
+    // Collapse all items initially
+    m_treeWidget->collapseAll();
 }
 
-void MainWindow::buildTreeRecursive(const std::shared_ptr<ArxmlElement>& elem, QTreeWidgetItem* parentItem)
+QTreeWidgetItem* MainWindow::buildTreeRecursive(const std::shared_ptr<ArxmlElement>& elem, QTreeWidgetItem* parentItem,
+                                                const QList<int>& indexPath)
 {
     QTreeWidgetItem* item;
     if (parentItem) {
@@ -332,13 +739,22 @@ void MainWindow::buildTreeRecursive(const std::shared_ptr<ArxmlElement>& elem, Q
     item->setText(1, package);
     
     // Store element index path instead of raw pointer
-    QList<int> indexPath = m_model->getElementIndexPath(elem.get());
     item->setData(0, Qt::UserRole, QVariant::fromValue(indexPath));
 
-    // Build children
-    for (const auto& child : elem->children) {
-        buildTreeRecursive(child, item);
+    // Stubs get their children when expanded (see onItemExpanded)
+    if (elem->stub) {
+        item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+        return item;
+    }
+
+    // Build children; their paths extend ours, no need to search the model
+    QList<int> childPath = indexPath;
+    childPath.append(0);
+    for (size_t i = 0; i < elem->children.size(); ++i) {
+        childPath.last() = static_cast<int>(i);
+        buildTreeRecursive(elem->children[i], item, childPath);
     }
+    return item;
 }
 
 void MainWindow::getElementDisplayInfo(ArxmlElement* elem, QString& name, QString& package) const
@@ -351,6 +767,12 @@ void MainWindow::getElementDisplayInfo(ArxmlElement* elem, QString& name, QStrin
     
     name = elem->tagName;
     package = "";
+    if (elem->stub) {
+        // Only the SHORT-NAME is kept for elements that are not paged in
+        if (!elem->stubShortName.isEmpty())
+            name = elem->stubShortName;
+        return;
+    }
     
     // Try to find SHORT-NAME or similar in attributes/children
     for (const auto& attr : elem->attributes) {
@@ -401,11 +823,7 @@ void MainWindow::saveFile()
         return;
     }
 
-    if (m_model->saveToFile(m_currentFileName)) {
-        logAction(tr("Saved file: %1").arg(m_currentFileName));
-        QMessageBox::information(this, tr("Saved"),
-                                tr("File saved to %1").arg(m_currentFileName));
-    }
+    startSave(m_currentFileName);
 }
 
 void MainWindow::saveFileAs()
@@ -419,114 +837,462 @@ void MainWindow::saveFileAs()
     QString fileName = QFileDialog::getSaveFileName(this,
                                                      tr("Save ARXML File"),
                                                      "",
-                                                     tr("ARXML Files (*.arxml *.xml);;All Files (*)"));
+                                                     tr("ARXML Files (*.arxml *.xml *.arxml.gz *.arxml.zst);;All Files (*)"));
     if (fileName.isEmpty())
         return;
 
-    if (m_model->saveToFile(fileName)) {
+    startSave(fileName);
+}
+
+void MainWindow::startSave(const QString& fileName)
+{
+    m_editCoalescer->flush();
+    if (m_saveWatcher.isRunning()) {
+        logAction(tr("A save is still in progress, try again when it has finished"), ActionLogModel::Severity::Warning);
+        return;
+    }
+
+    // The snapshot is taken copy-on-write, so editing can go on at once
+    // while the worker writes it
+    m_saveJob = m_model->beginSave(fileName);
+    if (!m_saveJob) {
+        logAction(tr("Failed to save file: %1 (%2)").arg(fileName, m_model->lastError()), ActionLogModel::Severity::Error);
+        return;
+    }
+    m_savingModel = m_model;
+    m_savingFileName = fileName;
+
+    m_saveButton->setEnabled(false);
+    m_saveAsButton->setEnabled(false);
+    statusBar()->showMessage(tr("Saving %1...").arg(fileName));
+
+    // Only the edited regions are re-serialized, the rest is copied from the file
+    const std::shared_ptr<ArxmlSaveJob> job = m_saveJob;
+    m_saveWatcher.setFuture(QtConcurrent::run([job]() {
+        return job->run();
+    }));
+}
+
+void MainWindow::onSaveFinished()
+{
+    const std::shared_ptr<ArxmlSaveJob> job = std::move(m_saveJob);
+    const QString fileName = m_savingFileName;
+    ArxmlModel *savedModel = m_savingModel;
+    m_savingModel = nullptr;
+
+    statusBar()->clearMessage();
+    if (!m_previewActive) {
+        m_saveButton->setEnabled(true);
+        m_saveAsButton->setEnabled(true);
+    }
+
+    if (!m_saveWatcher.result()) {
+        // Also releases the snapshot
+        if (savedModel == m_model) {
+            m_model->finishSave(*job);
+        }
+        logAction(tr("Failed to save file: %1 (%2)").arg(fileName, job->lastError()), ActionLogModel::Severity::Error);
+        return;
+    }
+
+    // The document may have been replaced during the save; edits made
+    // meanwhile stay unsaved
+    if (savedModel == m_model) {
         m_currentFileName = fileName;
-        logAction(tr("Saved file as: %1").arg(fileName));
-        QMessageBox::information(this, tr("Saved"),
-                                tr("File saved to %1").arg(fileName));
-    } else {
-        QMessageBox::critical(this, tr("Error"),
-                              tr("Failed to save file: %1").arg(fileName));
+        m_model->finishSave(*job);
     }
+    logAction(tr("Saved file: %1").arg(fileName));
 }
 
-void MainWindow::onCurrentItemChanged(QTreeWidgetItem *current, QTreeWidgetItem *previous)
+void MainWindow::transformFile()
 {
-    Q_UNUSED(previous);
-    
-    // Clear all fields
-    m_propertyTable->clearContents();
-    m_propertyTable->setRowCount(0);
-    m_portNameEdit->blockSignals(true);
-    m_portNameEdit->clear();
-    m_portInterfaceNameEdit->clear();
-    m_blueprintNameEdit->setText(tr("<None>"));
-    m_directionRadio1->setChecked(false);
-    m_directionRadio2->setChecked(false);
-    m_directionRadio3->setChecked(false);
-    m_enableIndirectApiCheck->setChecked(false);
-    m_enableApiUsageByAddressCheck->setChecked(false);
-    m_transformationErrorHandlingCheck->setChecked(false);
-    m_portDefinedArgsTable->clearContents();
-    m_portDefinedArgsTable->setRowCount(0);
-    m_commSpecDeElementsList->clear();
-    m_dataElementToComSpec.clear();
-    m_initValueEdit->clear();
-    m_initValueTypeCombo->setCurrentIndex(2); // Reset to "Array"
-    m_usesTxAcknowledgeCheck->setChecked(false);
-    m_timeoutEdit->clear();
-    m_timeoutUnitCombo->setCurrentIndex(0);
-    m_usesEndToEndProtectionCheck->setChecked(false);
-    m_portsDescriptionTab->clear();
+    if (m_transformWatcher.isRunning()) {
+        logAction(tr("A transform is still in progress, try again when it has finished"), ActionLogModel::Severity::Warning);
+        return;
+    }
 
-    // Unblock signals before populating
-    m_portNameEdit->blockSignals(false);
+    const QString filter = tr("ARXML Files (*.arxml *.xml *.arxml.gz *.arxml.zst);;All Files (*)");
+    const QString inputFileName = QFileDialog::getOpenFileName(this, tr("Transform: Input File"), "", filter);
+    if (inputFileName.isEmpty())
+        return;
 
-    if (!current)
+    bool ok = false;
+    const QString stages = QInputDialog::getText(this, tr("Transform"),
+        tr("Stages, separated by ';' and applied in order:\n"
+           "  drop:TAG[,TAG...]\n"
+           "  rename-package:/PATH=NAME\n"
+           "  extract:/PATH"),
+        QLineEdit::Normal, m_transformStages, &ok);
+    if (!ok)
         return;
 
-    auto elem = getElementForItem(current);
-    if (!elem)
+    auto pipeline = std::make_shared<ArxmlPipeline>();
+    for (const QString& spec : stages.split(QLatin1Char(';'), Qt::SkipEmptyParts)) {
+        if (!pipeline->addStage(spec.trimmed())) {
+            QMessageBox::warning(this, tr("Transform"), pipeline->lastError());
+            return;
+        }
+    }
+    m_transformStages = stages;
+
+    const QString outputFileName = QFileDialog::getSaveFileName(this, tr("Transform: Output File"), "", filter);
+    if (outputFileName.isEmpty())
+        return;
+
+    m_transformPipeline = pipeline;
+    m_transformOutputFileName = outputFileName;
+    m_transformButton->setEnabled(false);
+    logAction(tr("Transforming %1 into %2").arg(inputFileName, outputFileName));
+
+    auto progress = [this](qint64 bytesRead, qint64 totalBytes) {
+        QMetaObject::invokeMethod(this, [this, bytesRead, totalBytes]() {
+            if (m_transformWatcher.isRunning() && totalBytes > 0) {
+                statusBar()->showMessage(tr("Transforming... %1%").arg(bytesRead * 100 / totalBytes));
+            }
+        }, Qt::QueuedConnection);
+        return true;
+    };
+    m_transformWatcher.setFuture(QtConcurrent::run([pipeline, inputFileName, outputFileName, progress]() {
+        return pipeline->run(inputFileName, outputFileName, progress);
+    }));
+}
+
+void MainWindow::onTransformFinished()
+{
+    const std::shared_ptr<ArxmlPipeline> pipeline = std::move(m_transformPipeline);
+    m_transformButton->setEnabled(true);
+    statusBar()->clearMessage();
+
+    if (!m_transformWatcher.result()) {
+        logAction(tr("Transform failed: %1").arg(pipeline->lastError()), ActionLogModel::Severity::Error);
+        return;
+    }
+    logAction(tr("Transform written to %1").arg(m_transformOutputFileName));
+}
+
+void MainWindow::bulkEditComSpecs()
+{
+    if (m_previewActive || !m_model->rootElement())
+        return;
+
+    // Values typed into the port fields go in first
+    m_editCoalescer->flush();
+
+    BulkComSpecDialog dialog(m_model, this);
+    connect(&dialog, &BulkComSpecDialog::pageScanned, this, &MainWindow::evictIdlePages);
+    if (dialog.exec() != QDialog::Accepted || dialog.pendingEditCount() == 0)
+        return;
+
+    // Edit the model directly, one batch for all COM-SPECs; the tree and the
+    // port panels are updated once at the end
+    QElapsedTimer timer;
+    timer.start();
+    const std::vector<BulkComSpecDialog::Assignment> assignments = dialog.assignments();
+    beginEditBatch(tr("Bulk edit of %n COM-SPEC(s)", nullptr, static_cast<int>(dialog.targets().size())));
+    for (const BulkComSpecDialog::Target& target : dialog.targets()) {
+        for (const BulkComSpecDialog::Assignment& assignment : assignments) {
+            if (!(assignment.kinds & target.kind))
+                continue;
+            if (!setComSpecValue(target.path, target.comSpecTag, assignment.tagPath, assignment.value)) {
+                // All or nothing: take back what the batch did so far
+                logAction(tr("Bulk ComSpec edit cancelled: %1 of port %2 could not be loaded")
+                              .arg(target.comSpecTag, target.port),
+                          ActionLogModel::Severity::Error);
+                if (rollbackEditBatch()) {
+                    logAction(tr("No changes were made"));
+                }
+                return;
+            }
+        }
+    }
+    commitEditBatch();
+    onCurrentItemChanged(m_treeWidget->currentItem(), nullptr);
+    statusBar()->showMessage(tr("Bulk ComSpec edit applied in %1 ms").arg(timer.elapsed()), 5000);
+}
+
+bool MainWindow::setComSpecValue(const QList<int>& comSpecPath, const QString& comSpecTag, const QStringList& tagPath,
+                                 const QString& value)
+{
+    std::shared_ptr<ArxmlElement> parent = m_model->findElementByIndexPath(comSpecPath);
+    if (!parent || parent->tagName != comSpecTag)
+        return false;
+
+    QList<int> path = comSpecPath;
+    for (int level = 0; level < tagPath.size(); ++level) {
+        int index = -1;
+        for (size_t i = 0; i < parent->children.size(); ++i) {
+            if (parent->children[i]->tagName.compare(tagPath[level], Qt::CaseInsensitive) == 0) {
+                index = static_cast<int>(i);
+                break;
+            }
+        }
+
+        if (index < 0) {
+            // Create the missing rest of the path as one subtree
+            ArxmlModel::DetachedElement created = m_model->createElement(tagPath[level]);
+            ArxmlElement *leaf = created.element.get();
+            for (int i = level + 1; i < tagPath.size(); ++i) {
+                leaf = leaf->createChild(tagPath[i]).get();
+            }
+            leaf->text = value;
+            pushEdit(new ArxmlInsertElementCommand(m_model, path,
+                                                   BulkComSpecDialog::childInsertIndex(parent.get(), tagPath[level]),
+                                                   created, tr("Added %1").arg(tagPath.join(QLatin1Char('/')))));
+            return true;
+        }
+
+        path.append(index);
+        parent = parent->children[index];
+    }
+
+    if (parent->text != value) {
+        pushEdit(new ArxmlSetTextCommand(m_model, path, value, tr("Set %1 to '%2'").arg(tagPath.last(), value)));
+    }
+    return true;
+}
+
+void MainWindow::onCurrentItemChanged(QTreeWidgetItem *current, QTreeWidgetItem *previous)
+{
+    Q_UNUSED(previous);
+
+    // Typing in the fields still belongs to the previous element
+    m_editCoalescer->flush();
+    
+    // Filling in the fields is not an edit
+    m_editCoalescer->discard();
+
+    std::shared_ptr<ArxmlElement> elem = current ? getElementForItem(current) : nullptr;
+    if (!elem) {
+        // Clear all fields
+        m_propertyModel->setElement(nullptr);
+        if (m_portsPropertiesTab) {
+            applyPortView(PortView());
+        }
         return;
+    }
 
     bool isPorts = isPortsElement(elem.get());
     
     if (isPorts) {
         // Show PORTS-specific tabs
+        ensurePortsTabs();
         m_propertyTable->setVisible(false);
         m_propertyTabWidget->setVisible(true);
-        m_propertyTabWidget->addTab(m_portsPropertiesTab, tr("Properties"));
-        m_propertyTabWidget->addTab(m_portsApiOptionsTab, tr("Port API Options"));
-        m_propertyTabWidget->addTab(m_portsCommSpecTab, tr("Communication Spec"));
-        m_propertyTabWidget->addTab(m_portsDescriptionTab, tr("Description"));
         
         // Populate PORTS-specific tabs
-        populatePortsTabs(elem.get());
+        populatePortsTabs(elem);
     } else {
         // Hide tabs and show standard property table
+        m_dataElementToComSpec.clear();
         m_propertyTabWidget->setVisible(false);
         m_propertyTable->setVisible(true);
-        populateStandardPropertyTable(elem.get());
+        populateStandardPropertyTable(elem);
     }
+    m_editCoalescer->discard();
+
+    evictIdlePages();
 }
 
-void MainWindow::populateStandardPropertyTable(ArxmlElement* elem)
+void MainWindow::onItemExpanded(QTreeWidgetItem *item)
 {
-    if (!elem)
+    if (!item || item->childCount() > 0 || m_previewActive)
         return;
 
-    m_propertyTable->blockSignals(true);
-    m_propertyTable->clearContents();
-    m_propertyTable->setRowCount(0);
+    // Resolving the element pages it in
+    auto elem = getElementForItem(item);
+    if (!elem) {
+        logAction(tr("Failed to load element from %1").arg(m_currentFileName), ActionLogModel::Severity::Error);
+        return;
+    }
 
-    int row = 0;
+    buildChildItems(item, elem);
+    refreshTreeItem(item, elem.get());
+    m_portIndex->addSubtree(elem);
+    m_portTableModel->refresh();
 
-    // Attributes
-    for (const auto& attr : elem->attributes) {
-        m_propertyTable->insertRow(row);
-        QTableWidgetItem *attrName = new QTableWidgetItem(attr.first);
-        attrName->setFlags(attrName->flags() & ~Qt::ItemIsEditable);
-        m_propertyTable->setItem(row, 0, attrName);
-        QTableWidgetItem *attrValue = new QTableWidgetItem(attr.second);
-        m_propertyTable->setItem(row, 1, attrValue);
-        row++;
+    evictIdlePages();
+}
+
+void MainWindow::buildChildItems(QTreeWidgetItem* item, const std::shared_ptr<ArxmlElement>& elem)
+{
+    qDeleteAll(item->takeChildren());
+    QList<int> childPath = item->data(0, Qt::UserRole).value<QList<int>>();
+    childPath.append(0);
+    for (size_t i = 0; i < elem->children.size(); ++i) {
+        childPath.last() = static_cast<int>(i);
+        buildTreeRecursive(elem->children[i], item, childPath);
     }
+    item->setChildIndicatorPolicy(QTreeWidgetItem::DontShowIndicatorWhenChildless);
+}
 
-    // Text content
-    if (!elem->text.isEmpty()) {
-        m_propertyTable->insertRow(row);
-        QTableWidgetItem *textName = new QTableWidgetItem(tr("Text"));
-        textName->setFlags(textName->flags() & ~Qt::ItemIsEditable);
-        m_propertyTable->setItem(row, 0, textName);
-        QTableWidgetItem *textValue = new QTableWidgetItem(elem->text);
-        m_propertyTable->setItem(row, 1, textValue);
+void MainWindow::updateItemPaths(QTreeWidgetItem* item, const QList<int>& indexPath)
+{
+    item->setData(0, Qt::UserRole, QVariant::fromValue(indexPath));
+    QList<int> childPath = indexPath;
+    childPath.append(0);
+    for (int i = 0; i < item->childCount(); ++i) {
+        childPath.last() = i;
+        updateItemPaths(item->child(i), childPath);
     }
-    
-    m_propertyTable->blockSignals(false);
+}
+
+void MainWindow::evictIdlePages()
+{
+    if (!m_model->isOutOfCore() || !m_pagedSearch.isEmpty())
+        return;
+
+    QTreeWidgetItem *current = m_treeWidget->currentItem();
+    const std::shared_ptr<ArxmlElement> keep = getElementForItem(current);
+    const std::vector<QList<int>> evicted = m_model->evictPages(keep.get());
+    if (evicted.empty())
+        return;
+
+    for (const QList<int>& path : evicted) {
+        QTreeWidgetItem *item = findTreeItem(path);
+        if (!item)
+            continue;
+        item->setExpanded(false);
+        qDeleteAll(item->takeChildren());
+        item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+    }
+    m_portIndex->removeStubbed();
+    m_portTableModel->refresh();
+    m_portViewCache.clear();  // Entries may hold COM-SPECs of evicted pages
+}
+
+void MainWindow::populateStandardPropertyTable(const std::shared_ptr<ArxmlElement>& elem)
+{
+    // The model reads the element when rows are painted; selecting the
+    // same element again only repaints
+    m_propertyModel->setElement(elem);
+}
+
+void MainWindow::ensurePortsTabs()
+{
+    if (m_portsPropertiesTab)
+        return;
+
+    m_portsPropertiesTab = new QWidget;
+    m_portsApiOptionsTab = new QWidget;
+    m_portsCommSpecTab = new QWidget;
+    m_portsDescriptionTab = new QTextEdit;
+    m_portNameEdit = new QLineEdit;
+    m_portInterfaceGroup = new QGroupBox;
+    m_portInterfaceNameEdit = new QLineEdit;
+    m_blueprintGroup = new QGroupBox;
+    m_blueprintNameEdit = new QLineEdit;
+    m_directionGroup = new QGroupBox;
+    m_directionButtonGroup = new QButtonGroup;
+    m_directionRadio1 = new QRadioButton;
+    m_directionRadio2 = new QRadioButton;
+    m_directionRadio3 = new QRadioButton;
+    m_apiOptionsGroup = new QGroupBox;
+    m_enableIndirectApiCheck = new QCheckBox;
+    m_enableApiUsageByAddressCheck = new QCheckBox;
+    m_transformationErrorHandlingCheck = new QCheckBox;
+    m_portDefinedArgsGroup = new QGroupBox;
+    m_portDefinedArgsTable = new QTableWidget;
+    m_editArgsButton = new QPushButton;
+    m_getFromButton = new QPushButton;
+    m_copyToButton = new QPushButton;
+    m_commSpecDeElementsList = new QListWidget;
+    m_commSpecSubTabs = new QTabWidget;
+    m_senderComSpecTab = new QWidget;
+    m_receiverComSpecTab = new QWidget;
+    m_clientServerComSpecTab = new QWidget;
+    m_serverComSpecTab = new QWidget;
+    m_interfacePropertiesTab = new QWidget;
+    m_commSpecDescriptionTab = new QWidget;
+    m_commSpecNoPropertiesLabel = new QLabel;
+    m_receiverInitValueEdit = new QLineEdit;
+    m_receiverInitValueTypeCombo = new QComboBox;
+    m_receiverInitValueEditButton = new QPushButton;
+    m_rxFilterButtonGroup = new QButtonGroup;
+    m_rxFilterAlwaysRadio = new QRadioButton;
+    m_rxFilterMaskedRadio = new QRadioButton;
+    m_receiverUsesEndToEndProtectionCheck = new QCheckBox;
+    m_handleNeverReceivedCheck = new QCheckBox;
+    m_enableUpdateCheck = new QCheckBox;
+    m_aliveTimeoutEdit = new QLineEdit;
+    m_queueLengthEdit = new QLineEdit;
+    m_transformationGroup = new QGroupBox;
+    m_transformationTypeCombo = new QComboBox;
+    m_transformationDisabledCheck = new QCheckBox;
+    m_maxDeltaCounterEdit = new QLineEdit;
+    m_maxErrorStateInitEdit = new QLineEdit;
+    m_maxErrorStateInvalidEdit = new QLineEdit;
+    m_maxErrorStateValidEdit = new QLineEdit;
+    m_minOkStateInitEdit = new QLineEdit;
+    m_minOkStateInvalidEdit = new QLineEdit;
+    m_minOkStateValidEdit = new QLineEdit;
+    m_syncCounterInitEdit = new QLineEdit;
+    m_clientServerDeElementsList = new QListWidget;
+    m_clientServerTransformationGroup = new QGroupBox;
+    m_clientServerTransformationTypeCombo = new QComboBox;
+    m_clientServerTransformationDisabledCheck = new QCheckBox;
+    m_clientServerMaxDeltaCounterEdit = new QLineEdit;
+    m_clientServerMaxErrorStateInitEdit = new QLineEdit;
+    m_clientServerMaxErrorStateInvalidEdit = new QLineEdit;
+    m_clientServerMaxErrorStateValidEdit = new QLineEdit;
+    m_clientServerMaxNoNewOrRepeatedDataEdit = new QLineEdit;
+    m_clientServerMinOkStateInitEdit = new QLineEdit;
+    m_clientServerMinOkStateInvalidEdit = new QLineEdit;
+    m_clientServerMinOkStateValidEdit = new QLineEdit;
+    m_clientServerSyncCounterInitEdit = new QLineEdit;
+    m_clientServerWindowSizeEdit = new QLineEdit;
+    m_clientServerNoPropertiesLabel = new QLabel;
+    m_serverQueueLengthEdit = new QLineEdit;
+    m_interfacePropNameEdit = new QLineEdit;
+    m_dataTypeGroup = new QGroupBox;
+    m_dataTypeEdit = new QLineEdit;
+    m_dataTypeButton1 = new QPushButton;
+    m_dataTypeButton2 = new QPushButton;
+    m_dataTypeButton3 = new QPushButton;
+    m_dataConstraintEdit = new QLineEdit;
+    m_dataConstraintButton = new QPushButton;
+    m_useQueuedCommCheck = new QCheckBox;
+    m_measurementCalibrationGroup = new QGroupBox;
+    m_calibrationAccessCombo = new QComboBox;
+    m_handleInvalidGroup = new QGroupBox;
+    m_handleInvalidButtonGroup = new QButtonGroup;
+    m_handleInvalidKeepRadio = new QRadioButton;
+    m_handleInvalidReplaceRadio = new QRadioButton;
+    m_handleInvalidNoneRadio = new QRadioButton;
+    m_initValueEdit = new QLineEdit;
+    m_initValueTypeCombo = new QComboBox;
+    m_initValueEditButton = new QPushButton;
+    m_usesTxAcknowledgeCheck = new QCheckBox;
+    m_timeoutEdit = new QLineEdit;
+    m_timeoutUnitCombo = new QComboBox;
+    m_usesEndToEndProtectionCheck = new QCheckBox;
+
+    setupPortsTabs();
+    m_propertyTabWidget->addTab(m_portsPropertiesTab, tr("Properties"));
+    m_propertyTabWidget->addTab(m_portsApiOptionsTab, tr("Port API Options"));
+    m_propertyTabWidget->addTab(m_portsCommSpecTab, tr("Communication Spec"));
+    m_propertyTabWidget->addTab(m_portsDescriptionTab, tr("Description"));
+
+    m_editCoalescer->watch(m_portNameEdit);
+    m_editCoalescer->watch(m_portsDescriptionTab);
+    connect(m_portNameEdit, &QLineEdit::textChanged,
+            this, &MainWindow::onPortPropertyChanged);
+    connect(m_directionButtonGroup, &QButtonGroup::buttonClicked,
+            this, [this](QAbstractButton* button) {
+                int id = m_directionButtonGroup->id(button);
+                onDirectionChanged(id);
+            });
+    // Port API Options tab uses checkboxes and buttons, no table item changes to connect
+    // Port Communication Spec tab is now a form widget, no table item changes to connect
+    connect(m_portsDescriptionTab, &QTextEdit::textChanged,
+            this, &MainWindow::onDescriptionTextChanged);
+    connect(m_commSpecDeElementsList, &QListWidget::itemSelectionChanged,
+            this, &MainWindow::onCommSpecDeElementSelected);
+    connect(m_commSpecDeElementsList, &QListWidget::currentItemChanged,
+            this, &MainWindow::onCommSpecDeElementSelected);
+
+    // A load preview may be showing
+    m_portNameEdit->setReadOnly(m_previewActive);
+    m_portsDescriptionTab->setReadOnly(m_previewActive);
 }
 
 void MainWindow::setupPortsTabs()
@@ -1051,107 +1817,51 @@ void MainWindow::setupPortsTabs()
     m_portsDescriptionTab->setPlaceholderText(tr("Enter description text here..."));
 }
 
-void MainWindow::populatePortsTabs(ArxmlElement* elem)
+void MainWindow::populatePortsTabs(const std::shared_ptr<ArxmlElement>& elem)
 {
-    // Block signals during population
-    m_portNameEdit->blockSignals(true);
-    m_directionRadio1->blockSignals(true);
-    m_directionRadio2->blockSignals(true);
-    m_directionRadio3->blockSignals(true);
-    m_enableIndirectApiCheck->blockSignals(true);
-    m_enableApiUsageByAddressCheck->blockSignals(true);
-    m_transformationErrorHandlingCheck->blockSignals(true);
-    m_portDefinedArgsTable->blockSignals(true);
-    m_commSpecDeElementsList->blockSignals(true);
-    m_initValueEdit->blockSignals(true);
-    m_initValueTypeCombo->blockSignals(true);
-    m_usesTxAcknowledgeCheck->blockSignals(true);
-    m_timeoutEdit->blockSignals(true);
-    m_timeoutUnitCombo->blockSignals(true);
-    m_usesEndToEndProtectionCheck->blockSignals(true);
-    m_portsDescriptionTab->blockSignals(true);
-    
-    // Populate Properties tab - find SHORT-NAME
-    QString portName;
+    // Arrowing through ports revisits the same few; reuse what was
+    // extracted for them as long as they are unchanged
+    const PortView *view = m_portViewCache.find(elem);
+    if (!view) {
+        view = &m_portViewCache.insert(elem, extractPortView(elem));
+    }
+    applyPortView(*view);
+}
+
+PortView MainWindow::extractPortView(const std::shared_ptr<ArxmlElement>& elem)
+{
+    PortView view;
+
+    // Ports of a preview belong to the model still loading, they must not
+    // end up in the document's index
+    ArxmlPortIndex previewIndex;
+    ArxmlPortIndex *portIndex = m_previewActive ? &previewIndex : m_portIndex.get();
+    const int portRow = portIndex->ensure(elem);
+
+    // Properties tab - find SHORT-NAME
     for (const auto& child : elem->children) {
         if (child->tagName.compare("SHORT-NAME", Qt::CaseInsensitive) == 0) {
-            portName = child->text;
+            view.name = child->text;
             break;
         }
     }
-    m_portNameEdit->setText(portName);
     
-    // Find REQUIRED-INTERFACE-TREF or PROVIDED-INTERFACE-TREF for Port Interface name
-    QString interfaceName;
-    QString interfaceFullPath;  // Store the full path for tooltip
-    QString interfaceDest;
-    bool isProvidedInterface = false;
-    bool isRequiredInterface = false;
-    std::shared_ptr<ArxmlElement> interfaceTrefElement = nullptr;
-    
-    for (const auto& child : elem->children) {
-        QString tagLower = child->tagName.toLower();
-        if (tagLower.contains("provided-interface-tref")) {
-            isProvidedInterface = true;
-            interfaceTrefElement = child;
-            // Get the DEST attribute
-            for (const auto& attr : child->attributes) {
-                if (attr.first.compare("DEST", Qt::CaseInsensitive) == 0) {
-                    interfaceDest = attr.second;
-                    break;
-                }
-            }
-            // Try to get the text content as interface name (full path)
-            interfaceFullPath = child->text;
-            if (interfaceFullPath.isEmpty()) {
-                // Try to find SHORT-NAME child
-                for (const auto& grandchild : child->children) {
-                    if (grandchild->tagName.compare("SHORT-NAME", Qt::CaseInsensitive) == 0) {
-                        interfaceFullPath = grandchild->text;
-                        break;
-                    }
-                }
-            }
-            break;
-        } else if (tagLower.contains("required-interface-tref")) {
-            isRequiredInterface = true;
-            interfaceTrefElement = child;
-            // Get the DEST attribute
-            for (const auto& attr : child->attributes) {
-                if (attr.first.compare("DEST", Qt::CaseInsensitive) == 0) {
-                    interfaceDest = attr.second;
-                    break;
-                }
-            }
-            // Try to get the text content as interface name (full path)
-            interfaceFullPath = child->text;
-            if (interfaceFullPath.isEmpty()) {
-                // Try to find SHORT-NAME child
-                for (const auto& grandchild : child->children) {
-                    if (grandchild->tagName.compare("SHORT-NAME", Qt::CaseInsensitive) == 0) {
-                        interfaceFullPath = grandchild->text;
-                        break;
-                    }
-                }
-            }
-            break;
-        }
-    }
+    // Port Interface, direction and interface kind come from the port index
+    const QString interfaceFullPath = portIndex->interfaceRef(portRow);  // Full path for the tooltip
+    const ArxmlPortIndex::Direction portDirection = portIndex->direction(portRow);
+    const ArxmlPortIndex::InterfaceKind interfaceKind = portIndex->interfaceKind(portRow);
     
     // Extract only the last name from the path (split by '/' and take the last part)
     if (!interfaceFullPath.isEmpty()) {
         QStringList pathParts = interfaceFullPath.split('/', Qt::SkipEmptyParts);
         if (!pathParts.isEmpty()) {
-            interfaceName = pathParts.last();
+            view.interfaceName = pathParts.last();
         } else {
-            interfaceName = interfaceFullPath;  // Fallback if no '/' found
+            view.interfaceName = interfaceFullPath;  // Fallback if no '/' found
         }
     }
     
-    // Set the short name in the text box
-    m_portInterfaceNameEdit->setText(interfaceName);
-    
-    // Set tooltip with Port Interface name and Package (full path)
+    // Tooltip with Port Interface name and Package (full path)
     // Align colons by padding "Package:" to match "Port Interface:" width
     if (!interfaceFullPath.isEmpty()) {
         QString packageLabel = "Package:";
@@ -1160,21 +1870,14 @@ void MainWindow::populatePortsTabs(ArxmlElement* elem)
         int paddingLength = portInterfaceLabel.length() - packageLabel.length();
         QString padding = QString(paddingLength, ' ');
         
-        QString tooltipText = QString("%1 %2\n%3%4 %5")
+        view.interfaceToolTip = QString("%1 %2\n%3%4 %5")
             .arg(portInterfaceLabel)
-            .arg(interfaceName)
+            .arg(view.interfaceName)
             .arg(packageLabel)
             .arg(padding)
             .arg(interfaceFullPath);
-        m_portInterfaceNameEdit->setToolTip(tooltipText);
-    } else {
-        m_portInterfaceNameEdit->setToolTip(QString());
     }
     
-    // Determine port type and direction
-    bool isPPortPrototype = elem->tagName.compare("P-PORT-PROTOTYPE", Qt::CaseInsensitive) == 0;
-    bool isRPortPrototype = elem->tagName.compare("R-PORT-PROTOTYPE", Qt::CaseInsensitive) == 0;
-    
     // Check if there's a stored DIRECTION element
     QString storedDirection;
     for (const auto& child : elem->children) {
@@ -1184,363 +1887,306 @@ void MainWindow::populatePortsTabs(ArxmlElement* elem)
         }
     }
     
-    // Set direction radio buttons based on interface type
-    m_directionRadio1->setChecked(false);
-    m_directionRadio2->setChecked(false);
-    m_directionRadio3->setChecked(false);
-    
-    if (interfaceDest.contains("CLIENT-SERVER-INTERFACE", Qt::CaseInsensitive)) {
-        m_directionRadio1->setText(tr("Server"));
-        m_directionRadio2->setText(tr("Client"));
-        m_directionRadio3->setText(tr("Client/Server"));
+    // Direction radio buttons based on interface type
+    if (interfaceKind == ArxmlPortIndex::InterfaceKind::ClientServer) {
+        view.directionLabels[0] = tr("Server");
+        view.directionLabels[1] = tr("Client");
+        view.directionLabels[2] = tr("Client/Server");
         
         // Check stored direction first
         if (!storedDirection.isEmpty()) {
-            if (storedDirection == tr("Server")) {
-                m_directionRadio1->setChecked(true);
-            } else if (storedDirection == tr("Client")) {
-                m_directionRadio2->setChecked(true);
-            } else if (storedDirection == tr("Client/Server")) {
-                m_directionRadio3->setChecked(true);
+            for (int i = 0; i < 3; ++i) {
+                if (storedDirection == view.directionLabels[i]) {
+                    view.checkedDirection = i;
+                }
             }
         } else {
             // For R-PORT-PROTOTYPE with REQUIRED-INTERFACE-TREF DEST="CLIENT-SERVER-INTERFACE",
             // the direction is "Client" (second radio button) by default
-            if (isRPortPrototype && isRequiredInterface) {
-                m_directionRadio2->setChecked(true);
+            if (portDirection == ArxmlPortIndex::Direction::Required) {
+                view.checkedDirection = 1;
             }
         }
-    } else if (interfaceDest.contains("SENDER-RECEIVER-INTERFACE", Qt::CaseInsensitive)) {
-        m_directionRadio1->setText(tr("Sender"));
-        m_directionRadio2->setText(tr("Receiver"));
-        m_directionRadio3->setText(tr("Sender/Receiver"));
+    } else if (interfaceKind == ArxmlPortIndex::InterfaceKind::SenderReceiver) {
+        view.directionLabels[0] = tr("Sender");
+        view.directionLabels[1] = tr("Receiver");
+        view.directionLabels[2] = tr("Sender/Receiver");
         
         // Check stored direction first
         if (!storedDirection.isEmpty()) {
-            if (storedDirection == tr("Sender")) {
-                m_directionRadio1->setChecked(true);
-            } else if (storedDirection == tr("Receiver")) {
-                m_directionRadio2->setChecked(true);
-            } else if (storedDirection == tr("Sender/Receiver")) {
-                m_directionRadio3->setChecked(true);
+            for (int i = 0; i < 3; ++i) {
+                if (storedDirection == view.directionLabels[i]) {
+                    view.checkedDirection = i;
+                }
             }
         } else {
             // For P-PORT-PROTOTYPE with PROVIDED-INTERFACE-TREF DEST="SENDER-RECEIVER-INTERFACE", 
             // the direction is "Sender" (first radio button) by default
             // This includes server ports (which are also P-PORT-PROTOTYPE with PROVIDED and SENDER-RECEIVER-INTERFACE)
-            if (isPPortPrototype && isProvidedInterface) {
-                m_directionRadio1->setChecked(true);
+            if (portDirection == ArxmlPortIndex::Direction::Provided) {
+                view.checkedDirection = 0;
             }
             // For R-PORT-PROTOTYPE with REQUIRED-INTERFACE-TREF DEST="SENDER-RECEIVER-INTERFACE",
             // the direction is typically "Receiver" (second radio button) by default
-            else if (isRPortPrototype && isRequiredInterface) {
-                m_directionRadio2->setChecked(true);
+            else if (portDirection == ArxmlPortIndex::Direction::Required) {
+                view.checkedDirection = 1;
             }
         }
     } else {
         // Default labels if interface type is unknown
-        m_directionRadio1->setText(tr("Option 1"));
-        m_directionRadio2->setText(tr("Option 2"));
-        m_directionRadio3->setText(tr("Option 3"));
-    }
-    
-    // Unblock signals
-    m_portNameEdit->blockSignals(false);
-    m_directionRadio1->blockSignals(false);
-    m_directionRadio2->blockSignals(false);
-    m_directionRadio3->blockSignals(false);
-    m_enableIndirectApiCheck->blockSignals(false);
-    m_enableApiUsageByAddressCheck->blockSignals(false);
-    m_transformationErrorHandlingCheck->blockSignals(false);
-    m_portDefinedArgsTable->blockSignals(false);
-    m_commSpecDeElementsList->blockSignals(false);
-    m_initValueEdit->blockSignals(false);
-    m_initValueTypeCombo->blockSignals(false);
-    m_usesTxAcknowledgeCheck->blockSignals(false);
-    m_timeoutEdit->blockSignals(false);
-    m_timeoutUnitCombo->blockSignals(false);
-    m_usesEndToEndProtectionCheck->blockSignals(false);
-    
-    // Populate Data Elements list from PROVIDED-COM-SPECS or REQUIRED-COM-SPECS
-    m_commSpecDeElementsList->clear();
-    
-    // Find PROVIDED-COM-SPECS or REQUIRED-COM-SPECS
-    std::shared_ptr<ArxmlElement> comSpecsElement = nullptr;
-    for (const auto& child : elem->children) {
-        QString tagLower = child->tagName.toLower();
-        if (tagLower.contains("provided-com-specs") || tagLower.contains("required-com-specs")) {
-            comSpecsElement = child;
-            break;
-        }
+        view.directionLabels[0] = tr("Option 1");
+        view.directionLabels[1] = tr("Option 2");
+        view.directionLabels[2] = tr("Option 3");
     }
     
-    // Clear the mapping
-    m_dataElementToComSpec.clear();
-    
-    if (comSpecsElement) {
-        // Find NONQUEUED-SENDER-COM-SPEC, QUEUED-SENDER-COM-SPEC, NONQUEUED-RECEIVER-COM-SPEC, etc.
-        for (const auto& comSpec : comSpecsElement->children) {
-            QString comSpecTagLower = comSpec->tagName.toLower();
-            if (comSpecTagLower.contains("sender-com-spec") || comSpecTagLower.contains("receiver-com-spec")) {
-                // Find DATA-ELEMENT-REF
-                for (const auto& comSpecChild : comSpec->children) {
-                    QString childTagLower = comSpecChild->tagName.toLower();
-                    if (childTagLower.contains("data-element-ref")) {
-                        QString dataElementPath = comSpecChild->text;
-                        if (!dataElementPath.isEmpty()) {
-                            // Extract last name from path
-                            QStringList pathParts = dataElementPath.split('/', Qt::SkipEmptyParts);
-                            if (!pathParts.isEmpty()) {
-                                QString dataElementName = pathParts.last();
-                                // Store the data element name and associate it with the COM-SPEC
-                                m_commSpecDeElementsList->addItem(dataElementName);
-                                m_dataElementToComSpec[dataElementName] = comSpec;
-                            }
-                        }
-                    }
-                }
-            }
+    // Data Elements list from the sender/receiver COM-SPECs of the port
+    for (int i = 0; i < portIndex->comSpecCount(portRow); ++i) {
+        const std::shared_ptr<ArxmlElement>& comSpec = portIndex->comSpec(portRow, i);
+        const QString& dataElementName = portIndex->dataElement(portRow, i);
+        QString comSpecTagLower = comSpec->tagName.toLower();
+        if (dataElementName.isEmpty() ||
+            !(comSpecTagLower.contains("sender-com-spec") || comSpecTagLower.contains("receiver-com-spec"))) {
+            continue;
         }
+        view.dataElements << dataElementName;
+        view.dataElementComSpecs.push_back(comSpec);
     }
     
-    // Populate Description tab - set text content
-    QString descriptionText;
+    // Description tab - text content
     if (!elem->text.isEmpty()) {
-        descriptionText = elem->text;
+        view.description = elem->text;
     } else {
         // Look for description-related children
         for (const auto& child : elem->children) {
             QString tagLower = child->tagName.toLower();
             if (tagLower.contains("desc") || tagLower.contains("annotation") ||
                 tagLower.contains("documentation")) {
-                if (!descriptionText.isEmpty()) {
-                    descriptionText += "\n";
+                if (!view.description.isEmpty()) {
+                    view.description += "\n";
                 }
-                descriptionText += child->text.isEmpty() ? child->tagName : child->text;
+                view.description += child->text.isEmpty() ? child->tagName : child->text;
             }
         }
     }
-    m_portsDescriptionTab->setPlainText(descriptionText);
-    
-    // Setup Communication Spec sub-tabs based on port type
-    m_commSpecSubTabs->clear();  // Clear existing tabs
-    
-    bool isRPortWithSenderReceiver = isRPortPrototypeWithSenderReceiver(elem);
-    bool isRPortWithClientServer = isRPortPrototypeWithClientServer(elem);
-    bool isPPortWithClientServer = isPPortPrototypeClientServer(elem);
-    
-    if (isRPortWithSenderReceiver) {
-        // For R-PORT-PROTOTYPE with SENDER-RECEIVER-INTERFACE, show Receiver ComSpec
-        m_commSpecSubTabs->addTab(m_receiverComSpecTab, tr("Receiver ComSpec"));
-        // Add common tabs
-        m_commSpecSubTabs->addTab(m_interfacePropertiesTab, tr("Interface Properties"));
-        m_commSpecSubTabs->addTab(m_commSpecDescriptionTab, tr("Description"));
-    } else if (isRPortWithClientServer) {
-        // For R-PORT-PROTOTYPE with CLIENT-SERVER-INTERFACE, show Client-Server ComSpec
-        // Add Communication Spec tab (with Transformation) and Description tab directly
-        m_commSpecSubTabs->addTab(m_clientServerComSpecTab, tr("Communication Spec"));
-        m_commSpecSubTabs->addTab(m_commSpecDescriptionTab, tr("Description"));
-    } else if (isPPortWithClientServer) {
-        // For P-PORT-PROTOTYPE with PROVIDED-INTERFACE-TREF DEST="CLIENT-SERVER-INTERFACE",
-        // show Server ComSpec (with Queue Length and Transformation) and Description tab
-        m_commSpecSubTabs->addTab(m_serverComSpecTab, tr("Communication Spec"));
-        m_commSpecSubTabs->addTab(m_commSpecDescriptionTab, tr("Description"));
+    
+    // Communication Spec sub-tabs based on port type
+    const bool isRPort = portDirection == ArxmlPortIndex::Direction::Required;
+    const bool isPPort = portDirection == ArxmlPortIndex::Direction::Provided;
+    if (isRPort && interfaceKind == ArxmlPortIndex::InterfaceKind::SenderReceiver) {
+        view.comSpecTabs = PortView::ComSpecTabs::Receiver;
+    } else if (isRPort && interfaceKind == ArxmlPortIndex::InterfaceKind::ClientServer) {
+        view.comSpecTabs = PortView::ComSpecTabs::ClientServer;
+    } else if (isPPort && interfaceKind == ArxmlPortIndex::InterfaceKind::ClientServer) {
+        view.comSpecTabs = PortView::ComSpecTabs::Server;
     } else {
-        // For P-PORT-PROTOTYPE with PROVIDED-INTERFACE-TREF DEST="SENDER-RECEIVER-INTERFACE" or other types,
-        // show Sender ComSpec (default for sender-receiver provider ports)
-        m_commSpecSubTabs->addTab(m_senderComSpecTab, tr("Sender ComSpec"));
-        // Add common tabs
-        m_commSpecSubTabs->addTab(m_interfacePropertiesTab, tr("Interface Properties"));
-        m_commSpecSubTabs->addTab(m_commSpecDescriptionTab, tr("Description"));
+        view.comSpecTabs = PortView::ComSpecTabs::Sender;
     }
-    
-    // Unblock signals
-    m_portsCommSpecTab->blockSignals(false);
-    m_portsDescriptionTab->blockSignals(false);
+    return view;
 }
 
-bool MainWindow::isPortsElement(ArxmlElement* elem) const
+void MainWindow::applyPortView(const PortView& view)
 {
-    if (!elem) {
-        return false;
+    // Only widgets whose value differs are touched, so stepping between
+    // similar ports does little work
+
+    // Block signals during population
+    m_portNameEdit->blockSignals(true);
+    m_directionRadio1->blockSignals(true);
+    m_directionRadio2->blockSignals(true);
+    m_directionRadio3->blockSignals(true);
+    m_enableIndirectApiCheck->blockSignals(true);
+    m_enableApiUsageByAddressCheck->blockSignals(true);
+    m_transformationErrorHandlingCheck->blockSignals(true);
+    m_portDefinedArgsTable->blockSignals(true);
+    m_commSpecDeElementsList->blockSignals(true);
+    m_initValueEdit->blockSignals(true);
+    m_initValueTypeCombo->blockSignals(true);
+    m_usesTxAcknowledgeCheck->blockSignals(true);
+    m_timeoutEdit->blockSignals(true);
+    m_timeoutUnitCombo->blockSignals(true);
+    m_usesEndToEndProtectionCheck->blockSignals(true);
+    m_portsDescriptionTab->blockSignals(true);
+
+    setTextIfChanged(m_portNameEdit, view.name);
+    setTextIfChanged(m_portInterfaceNameEdit, view.interfaceName);
+    if (m_portInterfaceNameEdit->toolTip() != view.interfaceToolTip) {
+        m_portInterfaceNameEdit->setToolTip(view.interfaceToolTip);
     }
-    
-    // Check if parent is PORTS
-    ArxmlElement* parent = elem->parent;
-    if (!parent) {
-        return false;
+    setTextIfChanged(m_blueprintNameEdit, tr("<None>"));
+
+    QRadioButton *directionRadios[] = {m_directionRadio1, m_directionRadio2, m_directionRadio3};
+    for (int i = 0; i < 3; ++i) {
+        if (directionRadios[i]->text() != view.directionLabels[i]) {
+            directionRadios[i]->setText(view.directionLabels[i]);
+        }
+        directionRadios[i]->setChecked(i == view.checkedDirection);
     }
-    
-    return parent->tagName.compare("PORTS", Qt::CaseInsensitive) == 0;
-}
 
-bool MainWindow::isRPortPrototypeWithSenderReceiver(ArxmlElement* elem) const
-{
-    if (!elem) {
-        return false;
+    // Not read from the model yet; keep them at their defaults
+    m_enableIndirectApiCheck->setChecked(false);
+    m_enableApiUsageByAddressCheck->setChecked(false);
+    m_transformationErrorHandlingCheck->setChecked(false);
+    if (m_portDefinedArgsTable->rowCount() > 0) {
+        m_portDefinedArgsTable->clearContents();
+        m_portDefinedArgsTable->setRowCount(0);
+    }
+    setTextIfChanged(m_timeoutEdit, QString());
+    m_timeoutUnitCombo->setCurrentIndex(0);
+    m_usesTxAcknowledgeCheck->setChecked(false);
+    m_usesEndToEndProtectionCheck->setChecked(false);
+
+    // Data Elements list; kept with its selection if it shows the same names
+    bool sameDataElements = m_commSpecDeElementsList->count() == view.dataElements.size();
+    bool sameComSpecs = sameDataElements;
+    for (int i = 0; sameDataElements && i < view.dataElements.size(); ++i) {
+        sameDataElements = m_commSpecDeElementsList->item(i)->text() == view.dataElements[i];
+        sameComSpecs = sameComSpecs && m_dataElementToComSpec.value(view.dataElements[i]) == view.dataElementComSpecs[i];
     }
-    
-    // Check if tag name is R-PORT-PROTOTYPE
-    if (elem->tagName.compare("R-PORT-PROTOTYPE", Qt::CaseInsensitive) != 0) {
-        return false;
+    if (!sameDataElements) {
+        m_commSpecDeElementsList->clear();
+        m_commSpecDeElementsList->addItems(view.dataElements);
+        setTextIfChanged(m_initValueEdit, QString());
+        m_initValueTypeCombo->setCurrentIndex(2); // Reset to "Array"
     }
-    
-    // Check if it has REQUIRED-INTERFACE-TREF with DEST="SENDER-RECEIVER-INTERFACE"
-    for (const auto& child : elem->children) {
-        QString tagLower = child->tagName.toLower();
-        if (tagLower.contains("required-interface-tref")) {
-            // Check DEST attribute
-            for (const auto& attr : child->attributes) {
-                if (attr.first.compare("DEST", Qt::CaseInsensitive) == 0) {
-                    if (attr.second.contains("SENDER-RECEIVER-INTERFACE", Qt::CaseInsensitive)) {
-                        return true;
-                    }
-                }
-            }
-        }
+    m_dataElementToComSpec.clear();
+    for (int i = 0; i < view.dataElements.size(); ++i) {
+        m_dataElementToComSpec[view.dataElements[i]] = view.dataElementComSpecs[i];
     }
-    
-    return false;
-}
 
-bool MainWindow::isRPortPrototypeWithClientServer(ArxmlElement* elem) const
-{
-    if (!elem) {
-        return false;
-    }
-    
-    // Check if tag name is R-PORT-PROTOTYPE
-    if (elem->tagName.compare("R-PORT-PROTOTYPE", Qt::CaseInsensitive) != 0) {
-        return false;
+    // Comparing against the shown text is enough unless it was typed in
+    if (m_portsDescriptionTab->document()->isModified() || m_shownPortDescription != view.description) {
+        m_portsDescriptionTab->setPlainText(view.description);
+        m_portsDescriptionTab->document()->setModified(false);
+        m_shownPortDescription = view.description;
     }
-    
-    // Check if it has REQUIRED-INTERFACE-TREF with DEST="CLIENT-SERVER-INTERFACE"
-    for (const auto& child : elem->children) {
-        QString tagLower = child->tagName.toLower();
-        if (tagLower.contains("required-interface-tref")) {
-            // Check DEST attribute
-            for (const auto& attr : child->attributes) {
-                if (attr.first.compare("DEST", Qt::CaseInsensitive) == 0) {
-                    if (attr.second.contains("CLIENT-SERVER-INTERFACE", Qt::CaseInsensitive)) {
-                        return true;
-                    }
-                }
-            }
+
+    // Communication Spec sub-tabs based on port type
+    if (m_shownComSpecTabs != view.comSpecTabs) {
+        m_shownComSpecTabs = view.comSpecTabs;
+        m_commSpecSubTabs->clear();  // Clear existing tabs
+        switch (view.comSpecTabs) {
+        case PortView::ComSpecTabs::Receiver:
+            // For R-PORT-PROTOTYPE with SENDER-RECEIVER-INTERFACE, show Receiver ComSpec
+            m_commSpecSubTabs->addTab(m_receiverComSpecTab, tr("Receiver ComSpec"));
+            // Add common tabs
+            m_commSpecSubTabs->addTab(m_interfacePropertiesTab, tr("Interface Properties"));
+            m_commSpecSubTabs->addTab(m_commSpecDescriptionTab, tr("Description"));
+            break;
+        case PortView::ComSpecTabs::ClientServer:
+            // For R-PORT-PROTOTYPE with CLIENT-SERVER-INTERFACE, show Client-Server ComSpec
+            // Add Communication Spec tab (with Transformation) and Description tab directly
+            m_commSpecSubTabs->addTab(m_clientServerComSpecTab, tr("Communication Spec"));
+            m_commSpecSubTabs->addTab(m_commSpecDescriptionTab, tr("Description"));
+            break;
+        case PortView::ComSpecTabs::Server:
+            // For P-PORT-PROTOTYPE with PROVIDED-INTERFACE-TREF DEST="CLIENT-SERVER-INTERFACE",
+            // show Server ComSpec (with Queue Length and Transformation) and Description tab
+            m_commSpecSubTabs->addTab(m_serverComSpecTab, tr("Communication Spec"));
+            m_commSpecSubTabs->addTab(m_commSpecDescriptionTab, tr("Description"));
+            break;
+        case PortView::ComSpecTabs::Sender:
+            // For P-PORT-PROTOTYPE with PROVIDED-INTERFACE-TREF DEST="SENDER-RECEIVER-INTERFACE" or other types,
+            // show Sender ComSpec (default for sender-receiver provider ports)
+            m_commSpecSubTabs->addTab(m_senderComSpecTab, tr("Sender ComSpec"));
+            // Add common tabs
+            m_commSpecSubTabs->addTab(m_interfacePropertiesTab, tr("Interface Properties"));
+            m_commSpecSubTabs->addTab(m_commSpecDescriptionTab, tr("Description"));
+            break;
+        case PortView::ComSpecTabs::None:
+            break;
         }
     }
     
-    return false;
+    // Unblock signals
+    m_portNameEdit->blockSignals(false);
+    m_directionRadio1->blockSignals(false);
+    m_directionRadio2->blockSignals(false);
+    m_directionRadio3->blockSignals(false);
+    m_enableIndirectApiCheck->blockSignals(false);
+    m_enableApiUsageByAddressCheck->blockSignals(false);
+    m_transformationErrorHandlingCheck->blockSignals(false);
+    m_portDefinedArgsTable->blockSignals(false);
+    m_commSpecDeElementsList->blockSignals(false);
+    m_initValueEdit->blockSignals(false);
+    m_initValueTypeCombo->blockSignals(false);
+    m_usesTxAcknowledgeCheck->blockSignals(false);
+    m_timeoutEdit->blockSignals(false);
+    m_timeoutUnitCombo->blockSignals(false);
+    m_usesEndToEndProtectionCheck->blockSignals(false);
+    m_portsDescriptionTab->blockSignals(false);
+
+    // Same names, but of another port: show the selected one's COM-SPEC
+    if (sameDataElements && !sameComSpecs && m_commSpecDeElementsList->currentItem()) {
+        onCommSpecDeElementSelected();
+    }
 }
 
-bool MainWindow::isPPortPrototypeClientServer(ArxmlElement* elem) const
+bool MainWindow::isPortsElement(ArxmlElement* elem) const
 {
     if (!elem) {
         return false;
     }
     
-    // Check if tag name is P-PORT-PROTOTYPE
-    if (elem->tagName.compare("P-PORT-PROTOTYPE", Qt::CaseInsensitive) != 0) {
+    // Check if parent is PORTS
+    ArxmlElement* parent = elem->parent;
+    if (!parent) {
         return false;
     }
     
-    // Check if it has PROVIDED-INTERFACE-TREF with DEST="CLIENT-SERVER-INTERFACE"
-    for (const auto& child : elem->children) {
-        QString tagLower = child->tagName.toLower();
-        if (tagLower.contains("provided-interface-tref")) {
-            // Check DEST attribute
-            for (const auto& attr : child->attributes) {
-                if (attr.first.compare("DEST", Qt::CaseInsensitive) == 0) {
-                    QString destValue = attr.second;
-                    QString destLower = destValue.toLower();
-                    if (destLower.contains("client-server-interface")) {
-                        return true;
-                    }
-                }
-            }
-        }
-    }
-    
-    return false;
+    return parent->tagName.compare("PORTS", Qt::CaseInsensitive) == 0;
 }
 
-void MainWindow::onPropertyItemChanged(QTableWidgetItem *item)
+void MainWindow::onPropertyAttributeEdited(const QString &name, const QString &value)
 {
-    if (!item)
+    // The preview of a loading document is read-only
+    if (m_previewActive)
         return;
 
     QTreeWidgetItem *current = m_treeWidget->currentItem();
-    if (!current)
+    const std::shared_ptr<ArxmlElement> elem = m_propertyModel->element();
+    if (!current || !elem)
         return;
 
-    auto elem = getElementForItem(current);
-    if (!elem)
-        return;
+    const QList<int> path = current->data(0, Qt::UserRole).value<QList<int>>();
+    pushEdit(new ArxmlSetAttributeCommand(m_model, path, name, value,
+                                          tr("Modified attribute '%1' for element '%2'")
+                                              .arg(name).arg(elem->tagName)));
+}
 
-    bool isPorts = isPortsElement(elem.get());
-    
-    if (isPorts) {
-        // Determine which tab the edit came from by checking which table widget sent the signal
-        // We'll need to track this differently - check all PORTS tables
-        QString tabName;
-        QTableWidget* sourceTable = nullptr;
-        
-        // Check each table to see which one contains this item
-        // Since we don't have direct access, we'll use the sender() mechanism
-        QObject* senderObj = sender();
-        sourceTable = qobject_cast<QTableWidget*>(senderObj);
-        
-        // Properties tab is now a form widget, not a table, so skip it here
-        // Port API Options tab is also a form widget now, skip it here
-        // Port Communication Spec tab is also a form widget now, skip it here
-        // Description tab is now a QTextEdit, handled separately
-    } else {
-        // Standard 2-column layout (Property | Value)
-        if (item->column() != 1)
-            return;
+void MainWindow::onPropertyTextEdited(const QString &text)
+{
+    if (m_previewActive)
+        return;
 
-        QTableWidgetItem *fieldItem = m_propertyTable->item(item->row(), 0);
-        if (!fieldItem)
-            return;
+    QTreeWidgetItem *current = m_treeWidget->currentItem();
+    const std::shared_ptr<ArxmlElement> elem = m_propertyModel->element();
+    if (!current || !elem)
+        return;
 
-        QString fieldName = fieldItem->text();
-        QString newValue = item->text();
-
-        // Update attribute or text
-        if (fieldName != tr("Name") && fieldName != tr("Text")) {
-            // Update attribute
-            bool found = false;
-            for (auto& attr : elem->attributes) {
-                if (attr.first == fieldName) {
-                    attr.second = newValue;
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                elem->attributes.push_back({fieldName, newValue});
-            }
-            logAction(tr("Modified attribute '%1' for element '%2'").arg(fieldName).arg(elem->tagName));
-        } else if (fieldName == tr("Text")) {
-            elem->text = newValue;
-            logAction(tr("Modified text for element '%1'").arg(elem->tagName));
-        }
-        
-        // Refresh tree item display
-        refreshTreeItem(current, elem.get());
-    }
+    const QList<int> path = current->data(0, Qt::UserRole).value<QList<int>>();
+    pushEdit(new ArxmlSetTextCommand(m_model, path, text,
+                                     tr("Modified text for element '%1'").arg(elem->tagName)));
 }
 
 void MainWindow::onPortPropertyChanged()
 {
     // Only process if signals are not blocked (i.e., user edit, not programmatic)
-    if (m_portNameEdit->signalsBlocked())
+    if (m_portNameEdit->signalsBlocked() || m_previewActive)
         return;
     
     QTreeWidgetItem *current = m_treeWidget->currentItem();
     if (!current)
         return;
 
-    auto elem = getElementForItem(current);
+    // Keystrokes are committed together when typing pauses or the field
+    // loses focus
+    const QList<int> path = current->data(0, Qt::UserRole).value<QList<int>>();
+    m_editCoalescer->schedule(QStringLiteral("port-name"), [this, path]() { commitPortName(path); });
+}
+
+void MainWindow::commitPortName(const QList<int>& path)
+{
+    auto elem = m_model->findElementByIndexPath(path);
     if (!elem)
         return;
     
@@ -1551,29 +2197,29 @@ void MainWindow::onPortPropertyChanged()
     QString newName = m_portNameEdit->text();
     
     // Find and update SHORT-NAME child
-    for (auto& child : elem->children) {
+    for (size_t i = 0; i < elem->children.size(); ++i) {
+        const auto& child = elem->children[i];
         if (child->tagName.compare("SHORT-NAME", Qt::CaseInsensitive) == 0) {
             if (child->text != newName) {
-                child->text = newName;
-                logAction(tr("Modified port name to '%1'").arg(newName));
-                refreshTreeItem(current, elem.get());
+                pushEdit(new ArxmlSetTextCommand(m_model, path + QList<int>{static_cast<int>(i)}, newName,
+                                                 tr("Modified port name to '%1'").arg(newName)));
             }
             return;
         }
     }
     
     // If SHORT-NAME doesn't exist, create it
-    auto shortName = std::make_shared<ArxmlElement>();
-    shortName->tagName = "SHORT-NAME";
-    shortName->text = newName;
-    shortName->parent = elem.get();
-    elem->children.push_back(shortName);
-    logAction(tr("Created SHORT-NAME with value '%1'").arg(newName));
-    refreshTreeItem(current, elem.get());
+    ArxmlModel::DetachedElement shortName = m_model->createElement("SHORT-NAME");
+    shortName.element->text = newName;
+    pushEdit(new ArxmlInsertElementCommand(m_model, path, -1, shortName,
+                                           tr("Created SHORT-NAME with value '%1'").arg(newName)));
 }
 
 void MainWindow::onDirectionChanged(int id)
 {
+    if (m_previewActive)
+        return;
+
     QTreeWidgetItem *current = m_treeWidget->currentItem();
     if (!current)
         return;
@@ -1597,26 +2243,20 @@ void MainWindow::onDirectionChanged(int id)
     }
     
     // Find or create a DIRECTION child element to store the direction
-    std::shared_ptr<ArxmlElement> directionElement = nullptr;
-    for (const auto& child : elem->children) {
-        if (child->tagName.compare("DIRECTION", Qt::CaseInsensitive) == 0) {
-            directionElement = child;
-            break;
+    const QList<int> path = current->data(0, Qt::UserRole).value<QList<int>>();
+    const QString description = tr("Changed direction for port '%1' to '%2'").arg(elem->tagName).arg(directionText);
+    for (size_t i = 0; i < elem->children.size(); ++i) {
+        if (elem->children[i]->tagName.compare("DIRECTION", Qt::CaseInsensitive) == 0) {
+            pushEdit(new ArxmlSetTextCommand(m_model, path + QList<int>{static_cast<int>(i)},
+                                             directionText, description));
+            return;
         }
     }
     
-    if (!directionElement) {
-        // Create new DIRECTION element
-        directionElement = elem->createChild("DIRECTION");
-    }
-    
-    // Update the direction text
-    directionElement->text = directionText;
-    
-    logAction(tr("Changed direction for port '%1' to '%2'").arg(elem->tagName).arg(directionText));
-    
-    // Refresh tree item display
-    refreshTreeItem(current, elem.get());
+    // Create new DIRECTION element
+    ArxmlModel::DetachedElement directionElement = m_model->createElement("DIRECTION");
+    directionElement.element->text = directionText;
+    pushEdit(new ArxmlInsertElementCommand(m_model, path, -1, directionElement, description));
 }
 
 void MainWindow::onCommSpecDeElementSelected()
@@ -1730,7 +2370,7 @@ void MainWindow::onCommSpecDeElementSelected()
 bool MainWindow::eventFilter(QObject *obj, QEvent *event)
 {
     // Handle mouse clicks on the Data Elements panel to clear selection
-    if (event->type() == QEvent::MouseButtonPress) {
+    if (m_commSpecDeElementsList && event->type() == QEvent::MouseButtonPress) {
         QMouseEvent *mouseEvent = static_cast<QMouseEvent*>(event);
         
         // Find the Data Elements panel widget
@@ -1778,16 +2418,32 @@ bool MainWindow::eventFilter(QObject *obj, QEvent *event)
     return QMainWindow::eventFilter(obj, event);
 }
 
-void MainWindow::logAction(const QString &message)
+void MainWindow::logAction(const QString &message, ActionLogModel::Severity severity)
 {
-    QString timestamp = QDateTime::currentDateTime().toString("hh:mm:ss");
-    m_actionLog->append(QString("[%1] %2").arg(timestamp).arg(message));
+    // Shown with the next frame, together with whatever else is logged
+    // until then
+    m_actionLog->append(severity, message);
+}
+
+void MainWindow::exportActionLog()
+{
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("Export Action Log"), "",
+                                                          tr("Log Files (*.log *.txt);;All Files (*)"));
+    if (fileName.isEmpty())
+        return;
+
+    if (!m_actionLog->exportTo(fileName)) {
+        logAction(tr("Failed to export the action log: %1 (%2)").arg(fileName, m_actionLog->lastError()),
+                  ActionLogModel::Severity::Error);
+        return;
+    }
+    logAction(tr("Action log exported to %1; new entries are appended").arg(fileName));
 }
 
 void MainWindow::showContextMenu(const QPoint &pos)
 {
     QTreeWidgetItem *item = m_treeWidget->itemAt(pos);
-    if (!item)
+    if (!item || m_previewActive)
         return;
 
     QMenu menu(this);
@@ -1813,18 +2469,9 @@ void MainWindow::addChildElement()
     if (!elem)
         return;
 
-    auto newChild = std::make_shared<ArxmlElement>();
-    newChild->tagName = tagName;
-    newChild->parent = elem.get();
-    elem->children.push_back(newChild);
-
-    // Add to tree
-    QTreeWidgetItem *childItem = new QTreeWidgetItem(current);
-    childItem->setText(0, tagName);
-    QList<int> indexPath = m_model->getElementIndexPath(newChild.get());
-    childItem->setData(0, Qt::UserRole, QVariant::fromValue(indexPath));
-    
-    logAction(tr("Added child element '%1' to '%2'").arg(tagName).arg(elem->tagName));
+    pushEdit(new ArxmlInsertElementCommand(m_model, current->data(0, Qt::UserRole).value<QList<int>>(), -1,
+                                           m_model->createElement(tagName),
+                                           tr("Added child element '%1' to '%2'").arg(tagName).arg(elem->tagName)));
 }
 
 void MainWindow::deleteElement()
@@ -1844,22 +2491,11 @@ void MainWindow::deleteElement()
         return;
     }
 
-    auto parentElem = getElementForItem(parentItem);
-    if (!parentElem)
-        return;
-
-    // Remove from model
-    parentElem->children.erase(
-        std::remove_if(parentElem->children.begin(), parentElem->children.end(),
-                      [&elem](const std::shared_ptr<ArxmlElement>& child) {
-                          return child.get() == elem.get();
-                      }),
-        parentElem->children.end());
-
-    // Remove from tree
-    delete current;
-    
-    logAction(tr("Deleted element '%1'").arg(elem->tagName));
+    // Tree items are in model order, so the item's position is the
+    // element's index in its parent; the subtree is kept for undo
+    pushEdit(new ArxmlRemoveElementCommand(m_model, parentItem->data(0, Qt::UserRole).value<QList<int>>(),
+                                           parentItem->indexOfChild(current),
+                                           tr("Deleted element '%1'").arg(elem->tagName)));
 }
 
 void MainWindow::validateDocument()
@@ -1869,49 +2505,382 @@ void MainWindow::validateDocument()
                                 tr("Please open an ARXML file before validating."));
         return;
     }
+    if (m_model->isOutOfCore()) {
+        // The checks need the whole tree in memory
+        logAction(tr("Validation is not available for documents opened out-of-core"), ActionLogModel::Severity::Warning);
+        return;
+    }
+
+    // Ask for the AUTOSAR schema once; cancelling falls back to a
+    // well-formedness check only
+    if (m_schemaFileName.isEmpty()) {
+        m_schemaFileName = QFileDialog::getOpenFileName(this,
+                                                        tr("Select AUTOSAR Schema"),
+                                                        "",
+                                                        tr("XML Schema Files (*.xsd);;All Files (*)"));
+    }
+
+    // From now on the document is checked again after each pause in editing
+    m_liveChecks = true;
+    m_checkRequested = true;
+    m_checkTimer->stop();
+    startChecks();
+}
+
+void MainWindow::startChecks()
+{
+    if (!m_model->rootElement() || m_model->isOutOfCore())
+        return;
+    // The validator works on one run at a time
+    if (m_checkWatcher.isRunning()) {
+        m_checkPending = true;
+        return;
+    }
 
-    // For now, validation without schema file - just check XML well-formedness
-    // TODO: Add schema file selection dialog
-    QString schemaFile = "";  // Empty schema file means we'll skip schema validation
-    QString result;
-    if (schemaFile.isEmpty()) {
-        // Basic XML validation - just check if file can be saved and loaded
-        QTemporaryFile tmpFile;
-        if (!tmpFile.open()) {
-            result = tr("Failed to create temporary file for validation.");
+    // The worker reads the live model; an edit interrupts it (see
+    // ArxmlModel::ReadAccess) and the run is started again later. Only
+    // elements edited since the last run are passed to xmllint again.
+    m_checkPending = false;
+    m_checkingModel = m_model;
+    const ArxmlModel *model = m_model;
+    ArxmlValidator *validator = m_validator;
+    const ArxmlRuleEngine *ruleEngine = m_ruleEngine;
+    const QString schemaFile = m_schemaFileName;
+    const quint64 generation = m_model->editGeneration();
+    statusBar()->showMessage(tr("Checking document..."));
+    m_checkWatcher.setFuture(QtConcurrent::run([model, validator, ruleEngine, schemaFile, generation]() {
+        auto result = std::make_shared<CheckResult>();
+        result->schema = !schemaFile.isEmpty();
+        if (schemaFile.isEmpty()) {
+            // Structural check straight on the in-memory tree
+            result->cancelled = !validator->checkWellFormed(*model, generation, result->wellFormed);
         } else {
-            tmpFile.close();
-            if (!m_model->saveToFile(tmpFile.fileName())) {
-                result = tr("Failed to write document to temporary file.");
-            } else {
-                // Try to reload to verify well-formedness
-                ArxmlModel testModel;
-                if (!testModel.loadFromFile(tmpFile.fileName())) {
-                    result = tr("Document is not well-formed XML.");
-                }
+            result->cancelled = !validator->validateIncremental(*model, schemaFile, generation,
+                                                                result->schemaErrors);
+        }
+        if (!result->cancelled) {
+            result->cancelled = !ruleEngine->run(*model, generation, result->findings);
+        }
+        return result;
+    }));
+}
+
+void MainWindow::onChecksFinished()
+{
+    ArxmlModel *checkedModel = m_checkingModel;
+    m_checkingModel = nullptr;
+    const std::shared_ptr<CheckResult> result = m_checkWatcher.result();
+    if (!checkedModel || checkedModel != m_model)
+        return;
+
+    if (m_checkPending) {
+        startChecks();
+        return;
+    }
+    if (result->cancelled) {
+        // Edits restart the timer themselves, paging in does not
+        m_checkTimer->start();
+        return;
+    }
+    showCheckResults(*result);
+}
+
+void MainWindow::showCheckResults(const CheckResult& result)
+{
+    const std::vector<ArxmlFinding>& findings = result.findings;
+
+    // Fill with sorting off so rows are not re-sorted on every insert
+    m_messagesList->setSortingEnabled(false);
+    m_messagesList->clear();
+    QList<QTreeWidgetItem*> items;
+    auto addRow = [&items](const QString& severity, const QString& rule, const QString& message,
+                           const QString& path, const QList<int>& indexPath) {
+        QTreeWidgetItem *item = new QTreeWidgetItem;
+        item->setText(0, severity);
+        item->setText(1, rule);
+        item->setText(2, message);
+        item->setText(3, path);
+        item->setData(0, Qt::UserRole, QVariant::fromValue(indexPath));
+        items.append(item);
+    };
+
+    // One row per message; xmllint continues a message on unprefixed lines
+    int schemaProblems = 0;
+    for (const ArxmlValidator::UnitErrors& unit : result.schemaErrors) {
+        const QString prefix = unit.label + QLatin1Char(':');
+        for (const QString& line : unit.errors.split(QLatin1Char('\n'), Qt::SkipEmptyParts)) {
+            if (!line.startsWith(prefix) && !items.isEmpty() && items.last()->text(3) == unit.label) {
+                items.last()->setText(2, items.last()->text(2) + QLatin1Char('\n') + line);
+                continue;
             }
+            addRow(tr("Error"), QStringLiteral("schema"),
+                   line.startsWith(prefix) ? line.mid(prefix.size()) : line, unit.label, unit.indexPath);
+            ++schemaProblems;
         }
-    } else {
-        result = m_validator->validate(*m_model, schemaFile);
     }
-    
-    if (result.isEmpty()) {
+    for (const QString& line : result.wellFormed.split(QLatin1Char('\n'), Qt::SkipEmptyParts)) {
+        const qsizetype separator = line.indexOf(QLatin1String(": "));
+        addRow(tr("Error"), QStringLiteral("well-formedness"),
+               separator < 0 ? line : line.mid(separator + 2),
+               separator < 0 ? QString() : line.left(separator), QList<int>());
+        ++schemaProblems;
+    }
+    for (const ArxmlFinding& finding : findings) {
+        addRow(finding.severity == ArxmlFinding::Severity::Error ? tr("Error") : tr("Warning"),
+               finding.rule, finding.message, finding.path, finding.indexPath);
+    }
+    m_messagesList->addTopLevelItems(items);
+    m_messagesList->setSortingEnabled(true);
+
+    const QString summary = schemaProblems == 0
+        ? (result.schema ? tr("Document is valid against the schema") : tr("Document is well-formed"))
+        : tr("%n validation problem(s)", nullptr, schemaProblems);
+    statusBar()->showMessage(tr("%1, %n semantic finding(s)", nullptr, static_cast<int>(findings.size()))
+                                 .arg(summary));
+
+    // Reruns after edits only update the list; an explicit request is logged
+    if (!m_checkRequested)
+        return;
+    m_checkRequested = false;
+    if (schemaProblems == 0) {
         logAction(tr("Document validation: PASSED"));
-        QMessageBox::information(this, tr("Validation Passed"),
-                                tr("The document is well-formed."));
     } else {
-        logAction(tr("Document validation: FAILED"));
-        logAction(tr("Validation errors:\n%1").arg(result));
-        
-        // Show detailed error in message box
-        QMessageBox msgBox(this);
-        msgBox.setIcon(QMessageBox::Warning);
-        msgBox.setWindowTitle(tr("Validation Failed"));
-        msgBox.setText(tr("The document validation failed."));
-        msgBox.setDetailedText(result);
-        msgBox.setStandardButtons(QMessageBox::Ok);
-        msgBox.exec();
+        logAction(tr("Document validation: FAILED (%n problem(s), see Messages)", nullptr, schemaProblems),
+                  ActionLogModel::Severity::Error);
+    }
+    logAction(tr("Semantic checks: %1 finding(s)").arg(findings.size()));
+    if (!items.isEmpty()) {
+        m_logTabWidget->setCurrentWidget(m_messagesTab);
+    }
+}
+
+void MainWindow::onMessageActivated(QTreeWidgetItem *item, int column)
+{
+    Q_UNUSED(column);
+
+    // Findings belong to the previous document, not to the preview
+    if (!item || m_previewActive)
+        return;
+
+    QTreeWidgetItem *treeItem = findTreeItem(item->data(0, Qt::UserRole).value<QList<int>>());
+    if (!treeItem) {
+        logAction(tr("Element for finding no longer exists: %1").arg(item->text(3)), ActionLogModel::Severity::Warning);
+        return;
+    }
+
+    m_treeWidget->setCurrentItem(treeItem);
+    m_treeWidget->scrollToItem(treeItem);
+}
+
+void MainWindow::onPortOverviewActivated(const QModelIndex &index)
+{
+    if (!index.isValid() || m_previewActive)
+        return;
+
+    const std::shared_ptr<ArxmlElement> port = m_portTableModel->portAt(index.row());
+    if (!port)
+        return;
+
+    // Items below collapsed stubs do not exist yet; expanding builds them
+    // (the port's page is in memory already)
+    QTreeWidgetItem *item = m_treeWidget->topLevelItem(0);
+    for (int childIndex : m_model->getElementIndexPath(port.get())) {
+        if (!item)
+            break;
+        if (item->childCount() == 0) {
+            item->setExpanded(true);
+        }
+        item = childIndex < item->childCount() ? item->child(childIndex) : nullptr;
+    }
+    if (!item) {
+        logAction(tr("Port is not shown in the tree: %1").arg(port->tagName), ActionLogModel::Severity::Warning);
+        return;
+    }
+
+    m_treeWidget->setCurrentItem(item);
+    m_treeWidget->scrollToItem(item);
+}
+
+void MainWindow::pushEdit(ArxmlEditCommand *command)
+{
+    if (m_editBatch) {
+        m_editBatch->add(std::unique_ptr<QUndoCommand>(command));
+        return;
+    }
+
+    // A pending field edit comes first; it may refer to paths this command
+    // changes
+    m_editCoalescer->flush();
+    logAction(command->text());
+    m_undoStack->push(command);
+    applyModelChanges();
+}
+
+void MainWindow::beginEditBatch(const QString& description)
+{
+    if (m_editBatch)
+        return;
+
+    m_editCoalescer->flush();
+    m_editBatch = std::make_unique<ArxmlBatchCommand>(description);
+    m_model->beginTransaction();
+}
+
+void MainWindow::commitEditBatch()
+{
+    if (!m_editBatch)
+        return;
+
+    m_model->commitTransaction();
+    std::unique_ptr<ArxmlBatchCommand> batch = std::move(m_editBatch);
+    if (batch->count() > 0) {
+        logAction(tr("%1 (%n edit(s))", nullptr, batch->count()).arg(batch->text()));
+        m_undoStack->push(batch.release());
+    }
+    applyModelChanges();
+}
+
+bool MainWindow::rollbackEditBatch()
+{
+    if (!m_editBatch)
+        return true;
+
+    const bool reverted = m_model->rollbackTransaction();
+    const QString description = m_editBatch->text();
+    m_editBatch.reset();
+    if (reverted) {
+        applyModelChanges();
+        return true;
+    }
+
+    // Some edits of the batch remain, outside the undo history; rebuild
+    // the views from the tree rather than from the change list
+    logAction(tr("Could not take back %1, some of its edits remain: %2").arg(description, m_model->lastError()),
+              ActionLogModel::Severity::Error);
+    m_model->takeChanges();
+    populateTree();
+    m_portIndex->build(m_model->rootElement());
+    m_portTableModel->refresh();
+    m_propertyModel->refresh();
+    return false;
+}
+
+void MainWindow::applyModelChanges()
+{
+    const std::vector<ArxmlChange> changes = m_model->takeChanges();
+    for (const ArxmlChange& change : changes) {
+        applyChangeToView(change);
+    }
+    m_portIndex->update(*m_model, changes);
+    m_portTableModel->refresh();
+    m_propertyModel->refresh();
+    if (m_liveChecks && !changes.empty()) {
+        m_checkTimer->start();
+    }
+}
+
+void MainWindow::undoEdit()
+{
+    // Undo takes back the text typed last, so it has to be a step first
+    m_editCoalescer->flush();
+    if (m_previewActive || m_editBatch || !m_undoStack->canUndo())
+        return;
+
+    logAction(tr("Undo: %1").arg(m_undoStack->undoText()));
+    m_undoStack->undo();
+    applyModelChanges();
+    // Show the restored values in the property panels
+    onCurrentItemChanged(m_treeWidget->currentItem(), nullptr);
+}
+
+void MainWindow::redoEdit()
+{
+    m_editCoalescer->flush();
+    if (m_previewActive || m_editBatch || !m_undoStack->canRedo())
+        return;
+
+    logAction(tr("Redo: %1").arg(m_undoStack->redoText()));
+    m_undoStack->redo();
+    applyModelChanges();
+    onCurrentItemChanged(m_treeWidget->currentItem(), nullptr);
+}
+
+void MainWindow::applyChangeToView(const ArxmlChange& change)
+{
+    if (change.kind == ArxmlChange::Kind::Content) {
+        // Items show data of their children too (SHORT-NAME), so refresh
+        // the parent as well
+        QList<int> path = change.path;
+        for (int level = 0; level < 2; ++level) {
+            if (QTreeWidgetItem *item = findTreeItem(path)) {
+                refreshTreeItem(item, getElementForItem(item).get());
+            }
+            if (path.isEmpty())
+                break;
+            path.removeLast();
+        }
+        return;
+    }
+
+    QTreeWidgetItem *item = findTreeItem(change.path);
+    if (!item)
+        return;  // Inside a collapsed stub, built when expanded
+    auto elem = getElementForItem(item);
+    if (!elem)
+        return;
+
+    if (change.kind == ArxmlChange::Kind::ChildrenReset) {
+        // Several children of this element changed; build its items once
+        if (item->childCount() == 0 && !item->isExpanded()) {
+            item->setChildIndicatorPolicy(elem->children.empty() ? QTreeWidgetItem::DontShowIndicatorWhenChildless
+                                                                 : QTreeWidgetItem::ShowIndicator);
+        } else {
+            buildChildItems(item, elem);
+        }
+        refreshTreeItem(item, elem.get());
+        return;
+    }
+
+    const bool inserted = change.kind == ArxmlChange::Kind::ChildInserted;
+    const int modelCount = static_cast<int>(elem->children.size());
+    const int countBefore = inserted ? modelCount - 1 : modelCount + 1;
+    if (item->childCount() == 0 && countBefore > 0) {
+        // Child items were never built (out-of-core stub); expanding does it
+        item->setChildIndicatorPolicy(modelCount > 0 ? QTreeWidgetItem::ShowIndicator
+                                                     : QTreeWidgetItem::DontShowIndicatorWhenChildless);
+    } else if (item->childCount() != countBefore || change.index < 0 || change.index >= countBefore + (inserted ? 1 : 0)) {
+        // The items are out of step with the model; build them again
+        buildChildItems(item, elem);
+    } else if (inserted) {
+        QTreeWidgetItem *child = buildTreeRecursive(elem->children[change.index], item,
+                                                    change.path + QList<int>{change.index});
+        item->removeChild(child);
+        item->insertChild(change.index, child);
+    } else {
+        delete item->child(change.index);
+    }
+
+    // The siblings after the change moved by one
+    QList<int> childPath = change.path;
+    childPath.append(0);
+    for (int i = std::max(change.index, 0); i < item->childCount(); ++i) {
+        childPath.last() = i;
+        updateItemPaths(item->child(i), childPath);
+    }
+    refreshTreeItem(item, elem.get());
+}
+
+QTreeWidgetItem* MainWindow::findTreeItem(const QList<int>& indexPath) const
+{
+    // The root element is the single top-level item, index paths start below it
+    QTreeWidgetItem *item = m_treeWidget->topLevelItem(0);
+    for (int index : indexPath) {
+        if (!item || index < 0 || index >= item->childCount()) {
+            return nullptr;
+        }
+        item = item->child(index);
     }
+    return item;
 }
 
 std::shared_ptr<ArxmlElement> MainWindow::getElementForItem(QTreeWidgetItem *item)
@@ -1926,6 +2895,27 @@ std::shared_ptr<ArxmlElement> MainWindow::getElementForItem(QTreeWidgetItem *ite
 
     // Get index path from variant
     QList<int> indexPath = v.value<QList<int>>();
+
+    if (m_previewActive) {
+        // Only completed packages can be inspected while loading; resolve
+        // inside the package the item belongs to, never through the model
+        // the loader is still filling
+        QTreeWidgetItem *packageItem = item;
+        while (packageItem && !m_previewPackages.contains(packageItem))
+            packageItem = packageItem->parent();
+        if (!packageItem)
+            return nullptr;
+
+        std::shared_ptr<ArxmlElement> elem = m_previewPackages.value(packageItem);
+        const int packageDepth = packageItem->data(0, Qt::UserRole).value<QList<int>>().size();
+        for (int i = packageDepth; i < indexPath.size(); ++i) {
+            const int index = indexPath[i];
+            if (index < 0 || index >= static_cast<int>(elem->children.size()))
+                return nullptr;
+            elem = elem->children[index];
+        }
+        return elem;
+    }
     
     // Find element using index path
     return m_model->findElementByIndexPath(indexPath);
@@ -1933,11 +2923,21 @@ std::shared_ptr<ArxmlElement> MainWindow::getElementForItem(QTreeWidgetItem *ite
 
 void MainWindow::onDescriptionTextChanged()
 {
+    if (m_previewActive)
+        return;
+
     QTreeWidgetItem *current = m_treeWidget->currentItem();
     if (!current)
         return;
 
-    auto elem = getElementForItem(current);
+    // The whole text is only read once typing pauses
+    const QList<int> path = current->data(0, Qt::UserRole).value<QList<int>>();
+    m_editCoalescer->schedule(QStringLiteral("description"), [this, path]() { commitDescription(path); });
+}
+
+void MainWindow::commitDescription(const QList<int>& path)
+{
+    auto elem = m_model->findElementByIndexPath(path);
     if (!elem)
         return;
 
@@ -1948,8 +2948,8 @@ void MainWindow::onDescriptionTextChanged()
     // Update the element's text with the description
     QString newText = m_portsDescriptionTab->toPlainText();
     if (elem->text != newText) {
-        elem->text = newText;
-        logAction(tr("Modified description for element '%1'").arg(elem->tagName));
+        pushEdit(new ArxmlSetTextCommand(m_model, path, newText,
+                                         tr("Modified description for element '%1'").arg(elem->tagName)));
     }
 }
 
@@ -1957,6 +2957,43 @@ void MainWindow::onSearchTextChanged(const QString &text)
 {
     // Filter tree items based on search text
     filterTreeItems(text);
+
+    // The matches paged in for another search may go again
+    if (!m_pagedSearch.isEmpty() && text != m_pagedSearch) {
+        m_pagedSearch.clear();
+        evictIdlePages();
+    }
+}
+
+void MainWindow::onSearchSubmitted()
+{
+    const QString text = m_searchBox->text();
+    if (text.isEmpty() || m_previewActive || !m_model->isOutOfCore())
+        return;
+
+    // The filter only sees items that exist; expand the stubs whose text
+    // content contains the search text so it becomes searchable. Eviction waits
+    // until the search changes, so the first matches are not evicted again
+    // for the later ones; the memory limit ends the search instead.
+    m_pagedSearch = text;
+    const std::vector<QList<int>> matches = m_model->stubsContaining(text);
+    int expanded = 0;
+    for (const QList<int>& path : matches) {
+        if (m_model->memoryLimit() > 0 && m_model->pagedBytes() >= m_model->memoryLimit()) {
+            logAction(tr("Search stopped after %1 of %2 matching elements: memory limit reached")
+                          .arg(expanded).arg(matches.size()),
+                      ActionLogModel::Severity::Warning);
+            break;
+        }
+        QTreeWidgetItem *item = findTreeItem(path);
+        if (!item)
+            continue;
+        for (QTreeWidgetItem *parent = item->parent(); parent; parent = parent->parent())
+            parent->setExpanded(true);
+        item->setExpanded(true);
+        ++expanded;
+    }
+    filterTreeItems(text);
 }
 
 void MainWindow::filterTreeItems(const QString &searchText)
@@ -2001,7 +3038,7 @@ void MainWindow::filterTreeItems(const QString &searchText)
                 parent = parent->parent();
             }
             
-            // Show all descendants (children)
+            // Show all descendants (children) that are loaded
             showItemAndChildren(item);
         }
         
@@ -2015,7 +3052,10 @@ void MainWindow::showItemAndChildren(QTreeWidgetItem *item)
         return;
     
     item->setHidden(false);
-    item->setExpanded(true);  // Expand to show matches
+    // Expand to show matches; stubs have no child items yet, and expanding
+    // one would page it in
+    if (item->childCount() > 0)
+        item->setExpanded(true);
     
     for (int i = 0; i < item->childCount(); ++i) {
         showItemAndChildren(item->child(i));
@@ -0,0 +1,52 @@
+// port_view_cache.cpp
+//
+// LRU cache of the PORTS tab contents
+
+#include "port_view_cache.hpp"
+#include "arxml_model.hpp"
+
+PortViewCache::PortViewCache(int capacity)
+    : m_capacity(capacity)
+{
+}
+
+const PortView* PortViewCache::find(const std::shared_ptr<ArxmlElement> &port)
+{
+    auto it = m_lookup.find(port.get());
+    if (it == m_lookup.end())
+        return nullptr;
+
+    auto entry = it->second;
+    if (entry->port.lock() != port || entry->revision != port->subtreeRevision) {
+        m_entries.erase(entry);
+        m_lookup.erase(it);
+        return nullptr;
+    }
+
+    m_entries.splice(m_entries.begin(), m_entries, entry);
+    return &entry->view;
+}
+
+const PortView& PortViewCache::insert(const std::shared_ptr<ArxmlElement> &port, PortView view)
+{
+    auto it = m_lookup.find(port.get());
+    if (it != m_lookup.end()) {
+        m_entries.erase(it->second);
+        m_lookup.erase(it);
+    }
+
+    m_entries.push_front(Entry{port.get(), port, port->subtreeRevision, std::move(view)});
+    m_lookup[port.get()] = m_entries.begin();
+
+    while (static_cast<int>(m_entries.size()) > m_capacity) {
+        m_lookup.erase(m_entries.back().key);
+        m_entries.pop_back();
+    }
+    return m_entries.front().view;
+}
+
+void PortViewCache::clear()
+{
+    m_entries.clear();
+    m_lookup.clear();
+}
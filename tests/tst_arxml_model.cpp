@@ -0,0 +1,188 @@
+// tst_arxml_model.cpp
+//
+// ArxmlModel: incremental saves against full saves, rollback of edit
+// transactions and the coalescing of takeChanges()
+
+#include "arxml_model.hpp"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace {
+
+const QString Fixture = QStringLiteral(ARXML_TEST_DATA_DIR "/components.arxml");
+
+// Element paths in the fixture
+const QList<int> ElementsPath{0, 0, 1};
+const QList<int> FirstPath{0, 0, 1, 0};
+const QList<int> SecondPath{0, 0, 1, 1};
+
+QByteArray readFile(const QString &fileName)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+// Everything the tree holds, one line per element, for comparing trees
+void describe(const ArxmlElement &elem, int depth, QString &out)
+{
+    out += QString(depth * 2, QLatin1Char(' ')) + elem.tagName;
+    for (const auto& [name, value] : elem.attributes) {
+        out += QStringLiteral(" %1=\"%2\"").arg(name, value);
+    }
+    out += QStringLiteral(" [%1]").arg(elem.text);
+    for (const ArxmlMarkup& token : elem.markup) {
+        out += QStringLiteral(" <%1:%2:%3>").arg(token.before).arg(token.text, token.data);
+    }
+    out += QLatin1Char('\n');
+    for (const auto& child : elem.children) {
+        describe(*child, depth + 1, out);
+    }
+}
+
+QString describe(const ArxmlModel &model)
+{
+    QString out;
+    describe(*model.rootElement(), 0, out);
+    return out;
+}
+
+// A new component with a SHORT-NAME, ready for insertChild()
+ArxmlModel::DetachedElement newComponent(const ArxmlModel &model, const QString &name)
+{
+    ArxmlModel::DetachedElement component = model.createElement(QStringLiteral("APPLICATION-SW-COMPONENT-TYPE"));
+    component.element->createChild(QStringLiteral("SHORT-NAME"))->text = name;
+    return component;
+}
+
+} // namespace
+
+class TestArxmlModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void fullSaveRoundTrips();
+    void incrementalSaveMatchesFullSave();
+    void rollbackRestoresTree();
+    void takeChangesCoalescesChildEdits();
+
+private:
+    QTemporaryDir m_dir;
+    // The fixture as written by a full save, so the incremental saves
+    // below start from output of the same writer
+    QString m_canonical;
+};
+
+void TestArxmlModel::init()
+{
+    QVERIFY(m_dir.isValid());
+    m_canonical = m_dir.filePath(QStringLiteral("canonical.arxml"));
+    ArxmlModel model;
+    QVERIFY2(model.loadFromFile(Fixture), qPrintable(model.lastError()));
+    QVERIFY2(model.saveToFile(m_canonical), qPrintable(model.lastError()));
+}
+
+void TestArxmlModel::fullSaveRoundTrips()
+{
+    ArxmlModel model;
+    QVERIFY2(model.loadFromFile(m_canonical), qPrintable(model.lastError()));
+    QCOMPARE(model.toByteArray(), readFile(m_canonical));
+    // The comment between SHORT-NAME and ELEMENTS is part of the tree
+    QVERIFY(readFile(m_canonical).contains("<!-- Components of the round-trip and rollback tests -->"));
+}
+
+void TestArxmlModel::incrementalSaveMatchesFullSave()
+{
+    ArxmlModel model;
+    QVERIFY2(model.loadFromFile(m_canonical), qPrintable(model.lastError()));
+
+    // Text, attribute and structural edits; the third component stays
+    // untouched and is copied from the source
+    const std::shared_ptr<ArxmlElement> elements = model.findElementByIndexPath(ElementsPath);
+    const std::shared_ptr<ArxmlElement> first = model.findElementByIndexPath(FirstPath);
+    QVERIFY(elements && first);
+    model.setText(first->children[0], QStringLiteral("Renamed"));
+    model.setAttribute(first, QStringLiteral("UUID"), QStringLiteral("a1 & <new>"));
+    ArxmlModel::DetachedElement removed;
+    QVERIFY(model.removeChild(elements, 1, removed));
+    QVERIFY(model.insertChild(elements, 0, newComponent(model, QStringLiteral("Added"))));
+
+    const QString saved = m_dir.filePath(QStringLiteral("incremental.arxml"));
+    QVERIFY2(model.saveIncremental(saved), qPrintable(model.lastError()));
+    QCOMPARE(readFile(saved), model.toByteArray());
+
+    // The saved file is the new source; a second round splices against it
+    model.setText(model.findElementByIndexPath(FirstPath)->children[0], QStringLiteral("Again"));
+    const QString savedAgain = m_dir.filePath(QStringLiteral("incremental2.arxml"));
+    QVERIFY2(model.saveIncremental(savedAgain), qPrintable(model.lastError()));
+    QCOMPARE(readFile(savedAgain), model.toByteArray());
+}
+
+void TestArxmlModel::rollbackRestoresTree()
+{
+    ArxmlModel model;
+    QVERIFY2(model.loadFromFile(m_canonical), qPrintable(model.lastError()));
+    const QString treeBefore = describe(model);
+    const QByteArray bytesBefore = model.toByteArray();
+
+    model.beginTransaction();
+    const std::shared_ptr<ArxmlElement> elements = model.findElementByIndexPath(ElementsPath);
+    const std::shared_ptr<ArxmlElement> second = model.findElementByIndexPath(SecondPath);
+    QVERIFY(elements && second);
+    model.setText(second->children[0], QStringLiteral("Changed"));
+    model.setAttribute(second, QStringLiteral("UUID"), QStringLiteral("changed"));
+    model.setAttribute(second, QStringLiteral("NEW"), QStringLiteral("added"));
+    model.removeAttribute(model.findElementByIndexPath(FirstPath), QStringLiteral("UUID"));
+    QVERIFY(model.insertChild(elements, 1, newComponent(model, QStringLiteral("Inserted"))));
+    // An edit inside the inserted subtree, and removals around it
+    model.setText(elements->children[1]->children[0], QStringLiteral("Edited"));
+    ArxmlModel::DetachedElement removed;
+    QVERIFY(model.removeChild(elements, 0, removed));
+    QVERIFY(model.removeChild(elements, static_cast<int>(elements->children.size()) - 1, removed));
+    QVERIFY(describe(model) != treeBefore);
+
+    QVERIFY2(model.rollbackTransaction(), qPrintable(model.lastError()));
+    QVERIFY(!model.inTransaction());
+    QCOMPARE(describe(model), treeBefore);
+    QCOMPARE(model.toByteArray(), bytesBefore);
+}
+
+void TestArxmlModel::takeChangesCoalescesChildEdits()
+{
+    ArxmlModel model;
+    QVERIFY2(model.loadFromFile(m_canonical), qPrintable(model.lastError()));
+    model.takeChanges();
+
+    // One insertion is reported as such
+    const std::shared_ptr<ArxmlElement> elements = model.findElementByIndexPath(ElementsPath);
+    QVERIFY(model.insertChild(elements, 3, newComponent(model, QStringLiteral("Fourth"))));
+    std::vector<ArxmlChange> changes = model.takeChanges();
+    QCOMPARE(changes.size(), size_t(1));
+    QCOMPARE(changes[0].kind, ArxmlChange::Kind::ChildInserted);
+    QCOMPARE(changes[0].path, ElementsPath);
+    QCOMPARE(changes[0].index, 3);
+
+    // Two structural edits of one list become a reset that covers the edit
+    // inside the inserted subtree; the text edit elsewhere stays
+    QVERIFY(model.insertChild(elements, 0, newComponent(model, QStringLiteral("Zeroth"))));
+    model.setText(elements->children[0]->children[0], QStringLiteral("Renamed"));
+    ArxmlModel::DetachedElement removed;
+    QVERIFY(model.removeChild(elements, 2, removed));
+    const std::shared_ptr<ArxmlElement> packageName = model.findElementByIndexPath({0, 0, 0});
+    model.setText(packageName, QStringLiteral("Package"));
+    changes = model.takeChanges();
+    QCOMPARE(changes.size(), size_t(2));
+    QCOMPARE(changes[0].kind, ArxmlChange::Kind::ChildrenReset);
+    QCOMPARE(changes[0].path, ElementsPath);
+    QCOMPARE(changes[1].kind, ArxmlChange::Kind::Content);
+    QCOMPARE(changes[1].path, QList<int>({0, 0, 0}));
+
+    QVERIFY(model.takeChanges().empty());
+}
+
+QTEST_GUILESS_MAIN(TestArxmlModel)
+#include "tst_arxml_model.moc"
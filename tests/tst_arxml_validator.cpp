@@ -0,0 +1,97 @@
+// tst_arxml_validator.cpp
+//
+// ArxmlValidator: xmllint messages of the batched validation units are
+// mapped back to the unit they belong to, with lines counted from the
+// unit's start. Skipped where xmllint is not installed.
+
+#include "arxml_model.hpp"
+#include "arxml_validator.hpp"
+
+#include <QStandardPaths>
+#include <QtTest>
+
+namespace {
+
+const QString Fixture = QStringLiteral(ARXML_TEST_DATA_DIR "/components.arxml");
+const QString Schema = QStringLiteral(ARXML_TEST_DATA_DIR "/components.xsd");
+
+const QList<int> FirstPath{0, 0, 1, 0};
+const QList<int> SecondPath{0, 0, 1, 1};
+
+} // namespace
+
+class TestArxmlValidator : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void validDocumentHasNoErrors();
+    void messagesMapToTheirUnit();
+
+private:
+    bool validate(ArxmlValidator &validator, const ArxmlModel &model,
+                  std::vector<ArxmlValidator::UnitErrors> &errors);
+};
+
+void TestArxmlValidator::initTestCase()
+{
+    if (QStandardPaths::findExecutable(QStringLiteral("xmllint")).isEmpty()) {
+        QSKIP("xmllint is not installed");
+    }
+}
+
+bool TestArxmlValidator::validate(ArxmlValidator &validator, const ArxmlModel &model,
+                                  std::vector<ArxmlValidator::UnitErrors> &errors)
+{
+    errors.clear();
+    return validator.validateIncremental(model, Schema, model.editGeneration(), errors);
+}
+
+void TestArxmlValidator::validDocumentHasNoErrors()
+{
+    ArxmlModel model;
+    QVERIFY2(model.loadFromFile(Fixture), qPrintable(model.lastError()));
+
+    ArxmlValidator validator;
+    std::vector<ArxmlValidator::UnitErrors> errors;
+    QVERIFY(validate(validator, model, errors));
+    QVERIFY2(errors.empty(), errors.empty() ? "" : qPrintable(errors.front().errors));
+}
+
+void TestArxmlValidator::messagesMapToTheirUnit()
+{
+    ArxmlModel model;
+    QVERIFY2(model.loadFromFile(Fixture), qPrintable(model.lastError()));
+    ArxmlValidator validator;
+    std::vector<ArxmlValidator::UnitErrors> errors;
+    QVERIFY(validate(validator, model, errors));
+
+    // An element the schema does not allow, on the third line of the second
+    // component, and a text edit of the first one so both are checked again
+    // in the same batch:
+    //   <APPLICATION-SW-COMPONENT-TYPE UUID="b2">
+    //     <SHORT-NAME>Second</SHORT-NAME>
+    //     <UNKNOWN-ELEMENT/>
+    const std::shared_ptr<ArxmlElement> second = model.findElementByIndexPath(SecondPath);
+    QVERIFY(second);
+    QVERIFY(model.insertChild(second, 1, model.createElement(QStringLiteral("UNKNOWN-ELEMENT"))));
+    model.setText(model.findElementByIndexPath(FirstPath)->children[0], QStringLiteral("Renamed"));
+
+    QVERIFY(validate(validator, model, errors));
+    QCOMPARE(errors.size(), size_t(1));
+    const ArxmlValidator::UnitErrors& unit = errors.front();
+    QCOMPARE(unit.indexPath, SecondPath);
+    QVERIFY2(unit.errors.startsWith(unit.label + QStringLiteral(":3:")), qPrintable(unit.errors));
+    QVERIFY2(unit.errors.contains(QStringLiteral("UNKNOWN-ELEMENT")), qPrintable(unit.errors));
+
+    // Fixed again, the unit's cached errors go
+    ArxmlModel::DetachedElement removed;
+    QVERIFY(model.removeChild(second, 1, removed));
+    QVERIFY(validate(validator, model, errors));
+    QVERIFY(errors.empty());
+}
+
+QTEST_GUILESS_MAIN(TestArxmlValidator)
+#include "tst_arxml_validator.moc"